@@ -0,0 +1,131 @@
+#include "command.h"
+
+#include <string.h>
+#include <errno.h>
+
+#include "mutex.h"
+#include "LSM303AGR.h"
+
+static const settings_t _defaults = SETTINGS_DEFAULT;
+static uint8_t _pending[CMD_MAX];
+static uint8_t _pending_len;
+static mutex_t _lock = MUTEX_INIT;
+
+static uint16_t _le16(const uint8_t* buf)
+{
+    return buf[0] | (buf[1] << 8);
+}
+
+static uint32_t _le32(const uint8_t* buf)
+{
+    return _le16(buf) | ((uint32_t)_le16(buf + 2) << 16);
+}
+
+//arguments per opcode, -1 for unknown opcodes
+static int _args(uint8_t op)
+{
+    switch (op) {
+        case CMD_INTERVAL:
+            return 5;
+        case CMD_ALERTS:
+            return 4;
+        case CMD_FALL:
+        case CMD_LIGHT:
+            return 3;
+        case CMD_GPS:
+            return 1;
+        case CMD_DEFAULTS:
+        case CMD_FLUSH:
+        case CMD_REBOOT:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+//store a write to CMD_FILE_ID until the main thread takes it
+int command_post(uint32_t offset, uint32_t size, const uint8_t* data)
+{
+    int res = 0;
+
+    if (offset != 0 || size == 0 || size > CMD_MAX) {
+        return -EINVAL;
+    }
+    mutex_lock(&_lock);
+    if (_pending_len) {
+        res = -EBUSY;
+    } else {
+        memcpy(_pending, data, size);
+        _pending_len = size;
+    }
+    mutex_unlock(&_lock);
+    return res;
+}
+
+//copy the stored write into buf (CMD_MAX bytes), returns its length
+int command_take(uint8_t* buf)
+{
+    mutex_lock(&_lock);
+    int len = _pending_len;
+    memcpy(buf, _pending, len);
+    _pending_len = 0;
+    mutex_unlock(&_lock);
+    return len;
+}
+
+//parse and check all commands of one write, nothing is applied here
+int command_run(const uint8_t* buf, uint8_t len, const settings_t* current,
+                command_result_t* res)
+{
+    settings_t* s = &res->settings;
+    uint8_t pos = 0;
+
+    *s = *current;
+    res->flush_log = false;
+    res->reboot = false;
+
+    while (pos < len) {
+        uint8_t op = buf[pos++];
+        int args = _args(op);
+        if (args < 0) {
+            return -EINVAL;
+        }
+        if (len - pos < args) {
+            return -EMSGSIZE;
+        }
+        const uint8_t* a = &buf[pos];
+        switch (op) {
+            case CMD_INTERVAL:
+                s->interval_ms = _le32(a);
+                s->send_every = a[4];
+                break;
+            case CMD_ALERTS:
+                s->temp_alert = (int16_t)_le16(a);
+                s->hum_alert = (int16_t)_le16(a + 2);
+                break;
+            case CMD_FALL:
+                s->fall_mg = _le16(a);
+                s->fall_samples = a[2];
+                break;
+            case CMD_LIGHT:
+                s->light_threshold = _le16(a);
+                s->light_persistence = a[2];
+                break;
+            case CMD_GPS:
+                s->gps_policy = a[0];
+                break;
+            case CMD_DEFAULTS:
+                *s = _defaults;
+                break;
+            case CMD_FLUSH:
+                res->flush_log = true;
+                break;
+            case CMD_REBOOT:
+                res->flush_log = true;
+                res->reboot = true;
+                break;
+        }
+        pos += args;
+    }
+    return settings_valid(s) ? 0 : -ERANGE;
+}
@@ -0,0 +1,53 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../config.h"
+#include "../settings.h"
+
+/*
+ * Commands from the backend.
+ *
+ * The backend writes commands to modem file CMD_FILE_ID, over DASH7 or in
+ * a LoRaWAN downlink. One write holds one or more commands. Each command is
+ * an opcode followed by its little endian arguments:
+ *
+ *     0x01 interval    u32 interval in ms, u8 loops per uplink
+ *     0x02 alerts      i16 temperature, i16 humidity (centi-units)
+ *     0x03 fall        u16 threshold in mg, u8 duration in samples
+ *     0x04 light       u16 threshold in clear counts, u8 persistence
+ *     0x05 gps         u8 policy, GPS_POLICY_OFF or GPS_POLICY_AUTO
+ *     0x06 defaults    settings back to SETTINGS_DEFAULT
+ *     0x07 flush       write the buffered sample log records to flash
+ *     0x08 reboot      flush the sample log and reboot
+ *
+ * A write is taken as a whole: if any command is unknown or truncated, or
+ * the resulting settings are out of range, none of it is applied.
+ *
+ * The modem callback only stores the write with command_post(). The main
+ * thread picks it up between two measurement loops with command_take() and
+ * runs it with command_run().
+ */
+#define CMD_INTERVAL        (0x01)
+#define CMD_ALERTS          (0x02)
+#define CMD_FALL            (0x03)
+#define CMD_LIGHT           (0x04)
+#define CMD_GPS             (0x05)
+#define CMD_DEFAULTS        (0x06)
+#define CMD_FLUSH           (0x07)
+#define CMD_REBOOT          (0x08)
+
+typedef struct {
+    settings_t settings;    /**< settings after the commands */
+    bool flush_log;         /**< flush the sample log */
+    bool reboot;            /**< reboot afterwards */
+} command_result_t;
+
+int command_post(uint32_t offset, uint32_t size, const uint8_t* data);
+int command_take(uint8_t* buf);
+int command_run(const uint8_t* buf, uint8_t len, const settings_t* current,
+                command_result_t* res);
+
+#endif
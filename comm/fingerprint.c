@@ -0,0 +1,254 @@
+#include "fingerprint.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "modem.h"
+#include "mutex.h"
+#include "../timebase.h"
+
+#define FP_READ_CHUNK       (64)    /* bytes per modem file read */
+
+typedef struct {
+    uint32_t dist;
+    uint8_t room;
+} fp_neighbour_t;
+
+static uint8_t _map[FP_MAP_MAX];
+static uint32_t _written;           /* bytes written from the start of the map */
+static bool _ready;
+static uint8_t _gateways;
+static uint16_t _points;
+static uint8_t _level[FP_MAX_GATEWAYS];     /* observed RSSI level per map gateway */
+static uint32_t _seen[FP_MAX_GATEWAYS];     /* local time of the observation in ms */
+static mutex_t _lock = MUTEX_INIT;
+
+static uint32_t _map_size(uint8_t gateways, uint16_t points)
+{
+    return FP_MAP_HEADER + gateways * FP_UID_SIZE + points * (1 + gateways);
+}
+
+//check the header and whether the whole map has been written
+static bool _check(void)
+{
+    if (_written < FP_MAP_HEADER ||
+        _map[0] != FP_MAP_MAGIC || _map[1] != FP_MAP_VERSION) {
+        return false;
+    }
+    uint8_t gateways = _map[2];
+    uint16_t points = _map[4] | (_map[5] << 8);
+    if (gateways == 0 || gateways > FP_MAX_GATEWAYS ||
+        points == 0 || points > FP_MAX_POINTS) {
+        return false;
+    }
+    if (_written < _map_size(gateways, points)) {
+        return false;
+    }
+    _gateways = gateways;
+    _points = points;
+    return true;
+}
+
+static void _store(uint32_t offset, uint32_t size, const uint8_t* data)
+{
+    if (offset == 0) {
+        /* a new map, the old one is partly overwritten */
+        _written = 0;
+        memset(_level, 0, sizeof(_level));
+    }
+    if (offset > _written) {
+        /* only maps written from the start without gaps are used */
+        return;
+    }
+    memcpy(&_map[offset], data, size);
+    if (offset + size > _written) {
+        _written = offset + size;
+    }
+    _ready = _check();
+}
+
+//load the map from the modem file, if there is one
+int fingerprint_init(void)
+{
+    uint8_t buf[FP_READ_CHUNK];
+    uint32_t size;
+
+    mutex_lock(&_lock);
+    _written = 0;
+    _ready = false;
+    if (modem_read_file(FP_MAP_FILE_ID, 0, FP_MAP_HEADER, buf)
+        != MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
+        mutex_unlock(&_lock);
+        puts("Fingerprint: no map file");
+        return 1;
+    }
+    _store(0, FP_MAP_HEADER, buf);
+    if (_map[0] != FP_MAP_MAGIC || _map[1] != FP_MAP_VERSION ||
+        _map[2] > FP_MAX_GATEWAYS || ((_map[4] | (_map[5] << 8)) > FP_MAX_POINTS)) {
+        mutex_unlock(&_lock);
+        puts("Fingerprint: invalid map");
+        return 1;
+    }
+    size = _map_size(_map[2], _map[4] | (_map[5] << 8));
+    for (uint32_t offset = FP_MAP_HEADER; offset < size; offset += FP_READ_CHUNK) {
+        uint32_t len = (size - offset < FP_READ_CHUNK) ? size - offset : FP_READ_CHUNK;
+        if (modem_read_file(FP_MAP_FILE_ID, offset, len, buf)
+            != MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
+            break;
+        }
+        _store(offset, len, buf);
+    }
+    mutex_unlock(&_lock);
+
+    if (!_ready) {
+        puts("Fingerprint: invalid map");
+        return 1;
+    }
+    printf("Fingerprint: map loaded (%u gateways, %u points)\n", _gateways, _points);
+    return 0;
+}
+
+//part of a new map written to FP_MAP_FILE_ID by the backend
+void fingerprint_write(uint32_t offset, uint32_t size, const uint8_t* data)
+{
+    if (offset >= FP_MAP_MAX || size > FP_MAP_MAX - offset) {
+        puts("Fingerprint: map too large");
+        return;
+    }
+    mutex_lock(&_lock);
+    _store(offset, size, data);
+    mutex_unlock(&_lock);
+    if (_ready) {
+        printf("Fingerprint: new map (%u gateways, %u points)\n", _gateways, _points);
+    }
+}
+
+//RSSI of a gateway response, gateways that are not in the map are ignored
+void fingerprint_observe(const uint8_t* uid, int16_t rssi)
+{
+    mutex_lock(&_lock);
+    for (uint8_t g = 0; _ready && g < _gateways; g++) {
+        if (memcmp(&_map[FP_MAP_HEADER + g * FP_UID_SIZE], uid, FP_UID_SIZE) == 0) {
+            int16_t level = -rssi;
+            if (level < 1) {
+                level = 1;
+            } else if (level > FP_RSSI_FLOOR) {
+                level = FP_RSSI_FLOOR;
+            }
+            _level[g] = level;
+            _seen[g] = time_now_ms();
+            break;
+        }
+    }
+    mutex_unlock(&_lock);
+}
+
+void fingerprint_clear(void)
+{
+    mutex_lock(&_lock);
+    memset(_level, 0, sizeof(_level));
+    mutex_unlock(&_lock);
+}
+
+bool fingerprint_ready(void)
+{
+    return _ready;
+}
+
+//insert into the list of nearest points, sorted by distance
+static void _insert(fp_neighbour_t* nearest, uint8_t* count, uint32_t dist, uint8_t room)
+{
+    uint8_t i = (*count < FP_K) ? (*count)++ : FP_K - 1;
+    while (i > 0 && nearest[i - 1].dist > dist) {
+        nearest[i] = nearest[i - 1];
+        i--;
+    }
+    nearest[i].dist = dist;
+    nearest[i].room = room;
+}
+
+//room ID of the current observations, -1 without a match
+static int _match(void)
+{
+    uint8_t obs[FP_MAX_GATEWAYS];
+    fp_neighbour_t nearest[FP_K];
+    uint8_t count = 0;
+    uint8_t heard = 0;
+    uint32_t now = time_now_ms();
+
+    if (!_ready) {
+        return -1;
+    }
+    for (uint8_t g = 0; g < _gateways; g++) {
+        if (_level[g] != 0 && now - _seen[g] < FP_OBS_MAX_AGE) {
+            obs[g] = _level[g];
+            heard++;
+        } else {
+            obs[g] = FP_RSSI_FLOOR;
+        }
+    }
+    if (heard == 0) {
+        return -1;
+    }
+
+    const uint8_t* p = &_map[FP_MAP_HEADER + _gateways * FP_UID_SIZE];
+    for (uint16_t n = 0; n < _points; n++, p += 1 + _gateways) {
+        /* stop adding up once the point can no longer be among the nearest */
+        uint32_t bound = (count < FP_K) ? UINT32_MAX : nearest[FP_K - 1].dist;
+        uint32_t dist = 0;
+        for (uint8_t g = 0; g < _gateways && dist < bound; g++) {
+            int16_t d = obs[g] - (p[1 + g] ? p[1 + g] : FP_RSSI_FLOOR);
+            dist += d * d;
+        }
+        if (dist < bound) {
+            _insert(nearest, &count, dist, p[0]);
+        }
+    }
+
+    if (count == 0 ||
+        nearest[0].dist > (uint32_t)FP_MAX_RMS_DB * FP_MAX_RMS_DB * _gateways) {
+        return -1;
+    }
+    /* majority vote, on a tie the room of the nearer point wins */
+    uint8_t room = nearest[0].room;
+    uint8_t best = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t votes = 0;
+        for (uint8_t j = 0; j < count; j++) {
+            votes += (nearest[j].room == nearest[i].room);
+        }
+        if (votes > best) {
+            best = votes;
+            room = nearest[i].room;
+        }
+    }
+    return room;
+}
+
+int fingerprint_match(void)
+{
+    mutex_lock(&_lock);
+    int room = _match();
+    mutex_unlock(&_lock);
+    return room;
+}
+
+static int _saul_read(const void* dev, phydat_t* res)
+{
+    (void)dev;
+    int room = fingerprint_match();
+    if (room < 0) {
+        return -ECANCELED;
+    }
+    res->val[0] = room;
+    res->unit = UNIT_NONE;
+    res->scale = 0;
+    return 1;
+}
+
+const saul_driver_t fingerprint_saul_driver = {
+    .read = _saul_read,
+    .write = saul_notsup,
+    .type = SAUL_SENSE_ANY,
+};
@@ -0,0 +1,66 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../config.h"
+#include "saul.h"
+
+/*
+ * On-device indoor fingerprinting.
+ *
+ * The RSSI of the DASH7 gateways heard in the last exchange, passed in
+ * through fingerprint_observe(), is matched against a reference map. Each reference point holds the RSSI measured at
+ * a known spot and the ID of the room it lies in. The room is decided by a
+ * vote among the FP_K nearest points (squared RSSI distance). Ties go to the
+ * room of the nearest point. No room is returned when the nearest point is
+ * more than FP_MAX_RMS_DB off per gateway.
+ *
+ * The OSS-7 modem driver does not report the responders of a D7 request nor
+ * their RX level yet, so nothing calls fingerprint_observe() in the
+ * application. main.c only loads the map and sends the room with
+ * FINGERPRINT=1; tests/bench_fingerprint exercises the matcher on its own.
+ *
+ * The map is stored in modem file FP_MAP_FILE_ID, so it survives reboots,
+ * and a copy is kept in RAM. The backend can replace it by writing the file.
+ * Those writes arrive through the modem write file callback and have to be
+ * passed to fingerprint_write(). The new map is used as soon as it has been
+ * written completely from its start.
+ *
+ * Map layout:
+ *
+ *     byte 0      magic FP_MAP_MAGIC
+ *     byte 1      version FP_MAP_VERSION
+ *     byte 2      number of gateways g, 1..FP_MAX_GATEWAYS
+ *     byte 3      reserved, 0
+ *     byte 4..5   number of reference points n, 1..FP_MAX_POINTS, little endian
+ *     then        g gateway UIDs, 8 bytes each
+ *     then        n reference points: room ID, then one RSSI level per gateway
+ *
+ * An RSSI level is the RSSI in -dBm, 0 for a gateway that was not heard.
+ * Gateways that are not heard count as -FP_RSSI_FLOOR dBm.
+ */
+#define FP_MAP_MAGIC        (0xF1)
+#define FP_MAP_VERSION      (1)
+#define FP_MAP_HEADER       (6)
+#define FP_UID_SIZE         (8)
+#define FP_MAP_MAX          (FP_MAP_HEADER + FP_MAX_GATEWAYS * FP_UID_SIZE + \
+                             FP_MAX_POINTS * (1 + FP_MAX_GATEWAYS))
+
+int fingerprint_init(void);
+void fingerprint_write(uint32_t offset, uint32_t size, const uint8_t* data);
+void fingerprint_observe(const uint8_t* uid, int16_t rssi);
+void fingerprint_clear(void);
+int fingerprint_match(void);
+bool fingerprint_ready(void);
+
+/*
+ * SAUL driver that returns the matched room ID.
+ * Registered as SAUL_SENSE_ANY. A read fails when there is no map, no
+ * recent observation or no match.
+ */
+extern const saul_driver_t fingerprint_saul_driver;
+
+#endif
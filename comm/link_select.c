@@ -0,0 +1,133 @@
+#include "link_select.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "timex.h"
+#include "../timebase.h"
+#include "tx_queue.h"
+
+#define LINK_D7             (0)
+#define LINK_LORA           (1)
+#define LINK_NUMOF          (2)
+#define LINK_COST_NONE      (UINT32_MAX)
+#define LORA_RX2_DELAY_MS   (2000)  /* class A receive windows close after RX2 */
+
+typedef struct {
+    uint8_t count;                      /* valid entries in the window */
+    uint8_t pos;                        /* next entry to overwrite */
+    bool ok[LINK_WINDOW];
+    uint16_t latency_ms[LINK_WINDOW];
+    uint32_t wasted;                    /* failed attempts since init */
+} link_history_t;
+
+static link_history_t _hist[LINK_NUMOF];
+static alp_itf_id_t _current;
+static uint32_t _probe_interval;
+static uint32_t _next_probe;
+
+static link_history_t* _history(alp_itf_id_t itf)
+{
+    return &_hist[(itf == ALP_ITF_ID_D7ASP) ? LINK_D7 : LINK_LORA];
+}
+
+void link_select_init(void)
+{
+    memset(_hist, 0, sizeof(_hist));
+    _current = ALP_ITF_ID_LORAWAN_ABP;
+    _probe_interval = LINK_PROBE_MIN_MS;
+    _next_probe = time_now_ms();
+}
+
+void link_select_report(alp_itf_id_t itf, modem_status_t status, uint32_t latency_ms)
+{
+    link_history_t* h = _history(itf);
+    bool ok = (status == MODEM_STATUS_COMMAND_COMPLETED_SUCCESS);
+
+    if (ok && itf == ALP_ITF_ID_D7ASP && _current != ALP_ITF_ID_D7ASP) {
+        /* a probe got through, the timeouts before it are from elsewhere */
+        h->count = 0;
+        h->pos = 0;
+    }
+    h->ok[h->pos] = ok;
+    h->latency_ms[h->pos] = (latency_ms > UINT16_MAX) ? UINT16_MAX : latency_ms;
+    h->pos = (h->pos + 1) % LINK_WINDOW;
+    if (h->count < LINK_WINDOW) {
+        h->count++;
+    }
+    if (!ok) {
+        h->wasted++;
+    }
+
+    if (itf == ALP_ITF_ID_D7ASP) {
+        if (ok) {
+            _probe_interval = LINK_PROBE_MIN_MS;
+        } else if (_probe_interval < LINK_PROBE_MAX_MS / 2) {
+            _probe_interval *= 2;
+        } else {
+            _probe_interval = LINK_PROBE_MAX_MS;
+        }
+        _next_probe = time_now_ms() + _probe_interval;
+    }
+}
+
+//expected modem charge per delivered byte in nC
+uint32_t link_select_cost(alp_itf_id_t itf, uint8_t len)
+{
+    link_history_t* h = _history(itf);
+    uint32_t airtime_us = tx_queue_airtime_us(itf, len);
+    uint32_t latency_sum = 0;
+    uint8_t successes = 0;
+
+    if (len == 0) {
+        return LINK_COST_NONE;
+    }
+    if (h->count == 0) {
+        /* no history: LoRaWAN is assumed to work, DASH7 has to be probed */
+        if (itf == ALP_ITF_ID_D7ASP) {
+            return LINK_COST_NONE;
+        }
+        return (airtime_us * LINK_TX_CURRENT_MA +
+                LORA_RX2_DELAY_MS * US_PER_MS * LINK_RX_CURRENT_MA) / len;
+    }
+    for (int i = 0; i < h->count; i++) {
+        latency_sum += h->latency_ms[i];
+        successes += h->ok[i];
+    }
+    if (successes == 0) {
+        return LINK_COST_NONE;
+    }
+
+    uint64_t latency_us = ((uint64_t)latency_sum * US_PER_MS) / h->count;
+    uint64_t wait_us = (latency_us > airtime_us) ? latency_us - airtime_us : 0;
+    uint64_t charge = (uint64_t)airtime_us * LINK_TX_CURRENT_MA +
+                      wait_us * LINK_RX_CURRENT_MA;
+    uint64_t cost = (charge * h->count) / ((uint64_t)successes * len);
+    return (cost >= LINK_COST_NONE) ? LINK_COST_NONE - 1 : (uint32_t)cost;
+}
+
+alp_itf_id_t link_select_choose(uint8_t d7_len, uint8_t lora_len)
+{
+    uint32_t d7 = link_select_cost(ALP_ITF_ID_D7ASP, d7_len);
+    uint32_t lora = link_select_cost(ALP_ITF_ID_LORAWAN_ABP, lora_len);
+    alp_itf_id_t best = (d7 != LINK_COST_NONE && d7 <= lora) ?
+                        ALP_ITF_ID_D7ASP : ALP_ITF_ID_LORAWAN_ABP;
+
+    if (best != _current) {
+        printf("Link: switching to %s (D7 %"PRIu32" nC/B, LoRaWAN %"PRIu32" nC/B)\n",
+               (best == ALP_ITF_ID_D7ASP) ? "DASH7" : "LoRaWAN", d7, lora);
+        _current = best;
+    }
+    return best;
+}
+
+bool link_select_probe_due(void)
+{
+    return _current != ALP_ITF_ID_D7ASP && (int32_t)(time_now_ms() - _next_probe) >= 0;
+}
+
+uint32_t link_select_wasted(alp_itf_id_t itf)
+{
+    return _history(itf)->wasted;
+}
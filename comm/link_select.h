@@ -0,0 +1,36 @@
+#ifndef LINK_SELECT_H
+#define LINK_SELECT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "modem.h"
+#include "../config.h"
+
+/*
+ * DASH7 / LoRaWAN interface selection.
+ *
+ * The outcome of every uplink attempt (success, latency) is kept in a sliding
+ * window of LINK_WINDOW attempts per interface. From that window the expected
+ * modem charge per delivered payload byte is estimated as
+ *
+ *     (airtime * I_tx + (latency - airtime) * I_rx) / (p_success * len)
+ *
+ * and the cheapest interface is used. DASH7 is only used after at least one
+ * attempt in the window succeeded. LoRaWAN is the fallback and is assumed to
+ * work when it has no history yet.
+ *
+ * While LoRaWAN is in use, DASH7 is probed again. The probe interval starts
+ * at LINK_PROBE_MIN_MS, doubles with every failed DASH7 attempt up to
+ * LINK_PROBE_MAX_MS, and resets after a successful one. A successful probe
+ * also clears the DASH7 window: the timeouts in it were recorded out of
+ * range of a gateway and would otherwise keep DASH7 off after coming back.
+ */
+void link_select_init(void);
+void link_select_report(alp_itf_id_t itf, modem_status_t status, uint32_t latency_ms);
+alp_itf_id_t link_select_choose(uint8_t d7_len, uint8_t lora_len);
+bool link_select_probe_due(void);
+uint32_t link_select_cost(alp_itf_id_t itf, uint8_t len);
+uint32_t link_select_wasted(alp_itf_id_t itf);
+
+#endif
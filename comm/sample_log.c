@@ -0,0 +1,328 @@
+#include "sample_log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FLAG_ZERO           (0x80)
+#define FLAG_CHECKPOINT     (0x40)
+#define FLAG_ALARM          (0x20)
+#define FLAG_LORA           (0x10)
+#define LEN_MASK            (0x0F)
+#define ERASED              (0xFF)
+#define WRITE_SIZE          (SAMPLE_LOG_BUFFER * SAMPLE_LOG_RECORD)
+#define CHECKPOINT_LEN      (8)
+
+static mtd_dev_t* _mtd;
+static uint32_t _base;              /* address of the first log sector */
+static uint32_t _slots;             /* records that fit in the log */
+static uint32_t _sector_slots;      /* records per sector */
+static uint32_t _head;              /* next slot written to flash */
+static uint32_t _used;              /* slots in flash before _head that hold data */
+static uint32_t _tail;              /* first slot not delivered yet */
+static uint32_t _batch_end;         /* slot after the last batch */
+static uint32_t _lost;
+static uint32_t _checkpoint;        /* number of the next checkpoint */
+static uint8_t _buf[SAMPLE_LOG_BUFFER][SAMPLE_LOG_RECORD];
+static uint8_t _buffered;
+
+//slots from a up to b, going around the log
+static uint32_t _dist(uint32_t a, uint32_t b)
+{
+    return (b + _slots - a) % _slots;
+}
+
+static uint32_t _end(void)
+{
+    return (_head + _buffered) % _slots;
+}
+
+static uint8_t _check(const uint8_t* rec)
+{
+    uint8_t check = SAMPLE_LOG_CHECK;
+    for (int i = 0; i < SAMPLE_LOG_RECORD - 1; i++) {
+        check ^= rec[i];
+    }
+    return check;
+}
+
+static bool _valid(const uint8_t* rec)
+{
+    return !(rec[0] & FLAG_ZERO) && (rec[0] & LEN_MASK) <= SAMPLE_LOG_PAYLOAD &&
+           rec[SAMPLE_LOG_RECORD - 1] == _check(rec);
+}
+
+static bool _is_checkpoint(const uint8_t* rec)
+{
+    return _valid(rec) && (rec[0] & FLAG_CHECKPOINT) &&
+           (rec[0] & LEN_MASK) == CHECKPOINT_LEN;
+}
+
+static uint32_t _get32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void _put32(uint8_t* p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+//read a record from flash, or from the buffer if it was not written yet
+static int _read(uint32_t slot, uint8_t* rec)
+{
+    uint32_t pos = _dist(_head, slot);
+    if (pos < _buffered) {
+        memcpy(rec, _buf[pos], SAMPLE_LOG_RECORD);
+        return 0;
+    }
+    return (mtd_read(_mtd, rec, _base + slot * SAMPLE_LOG_RECORD, SAMPLE_LOG_RECORD) < 0) ? -1 : 0;
+}
+
+//erase the sector that starts at _head, dropping the oldest readings if needed
+static void _erase_ahead(void)
+{
+    uint32_t keep = _slots - _sector_slots;
+    if (_used > keep) {
+        uint32_t oldest = _dist(_used, _head);  /* _head - _used */
+        uint32_t removed = _used - keep;
+        if (_dist(oldest, _tail) < removed) {
+            _lost += removed - _dist(oldest, _tail);
+            _tail = (oldest + removed) % _slots;
+        }
+        _used = keep;
+    }
+    if (mtd_erase(_mtd, _base + _head * SAMPLE_LOG_RECORD,
+                  _sector_slots * SAMPLE_LOG_RECORD) < 0) {
+        printf("Sample log: erase failed at slot %lu\n", (unsigned long)_head);
+    }
+}
+
+//write the full buffer at _head
+static void _write_buffer(void)
+{
+    if (mtd_write(_mtd, _buf, _base + _head * SAMPLE_LOG_RECORD, WRITE_SIZE) < 0) {
+        /* the slots are skipped, their records do not pass the check */
+        printf("Sample log: write failed at slot %lu\n", (unsigned long)_head);
+    }
+    _head = (_head + SAMPLE_LOG_BUFFER) % _slots;
+    _used += SAMPLE_LOG_BUFFER;
+    _buffered = 0;
+    if (_head % _sector_slots == 0) {
+        _erase_ahead();
+    }
+}
+
+static void _push(uint8_t* rec)
+{
+    rec[SAMPLE_LOG_RECORD - 1] = _check(rec);
+    memcpy(_buf[_buffered++], rec, SAMPLE_LOG_RECORD);
+    if (_buffered == SAMPLE_LOG_BUFFER) {
+        _write_buffer();
+    }
+}
+
+//use sectors sector .. sector + sectors - 1 of mtd, resume where it was left
+int sample_log_init(mtd_dev_t* mtd, uint32_t sector, uint32_t sectors)
+{
+    uint8_t rec[SAMPLE_LOG_RECORD];
+    uint32_t sector_size;
+
+    if (mtd_init(mtd) < 0) {
+        puts("Sample log: no flash");
+        return 1;
+    }
+    sector_size = mtd->pages_per_sector * mtd->page_size;
+    if (sectors < 2 || sector + sectors > mtd->sector_count ||
+        sector_size % WRITE_SIZE != 0 ||
+        (WRITE_SIZE < mtd->page_size && mtd->page_size % WRITE_SIZE != 0)) {
+        puts("Sample log: flash layout not supported");
+        return 1;
+    }
+    _mtd = mtd;
+    _base = sector * sector_size;
+    _sector_slots = sector_size / SAMPLE_LOG_RECORD;
+    _slots = sectors * _sector_slots;
+    _buffered = 0;
+    _lost = 0;
+    _checkpoint = 0;
+
+    /* the newest checkpoint and the erased slot after the newest record */
+    bool any_erased = false;
+    bool prev_erased;
+    bool checkpoint = false;
+    uint32_t newest = 0;
+    _read(_slots - 1, rec);
+    prev_erased = (rec[0] == ERASED);
+    _head = 0;
+    _used = 0;
+    for (uint32_t i = 0; i < _slots; i++) {
+        _read(i, rec);
+        bool erased = (rec[0] == ERASED);
+        if (erased && !prev_erased) {
+            _head = i;
+            _used = 1;
+        }
+        any_erased |= erased;
+        prev_erased = erased;
+        if (_is_checkpoint(rec) &&
+            (!checkpoint || (int32_t)(_get32(&rec[5]) - _checkpoint) >= 0)) {
+            checkpoint = true;
+            newest = i;
+            _checkpoint = _get32(&rec[5]) + 1;
+        }
+    }
+    if (checkpoint && any_erased) {
+        /* the records after the newest checkpoint run up to the head, other
+         * erased slots are left by failed writes or erases */
+        _head = (newest + 1) % _slots;
+        while (_read(_head, rec) == 0 && rec[0] != ERASED) {
+            _head = (_head + 1) % _slots;
+        }
+        _used = 1;
+    }
+    if (!any_erased) {
+        /* no free slot, nothing can be trusted */
+        for (uint32_t s = 0; s < sectors; s++) {
+            mtd_erase(mtd, _base + s * sector_size, sector_size);
+        }
+    }
+    else if (_used) {
+        /* the oldest record is the first written slot after the head */
+        uint32_t oldest = _head;
+        do {
+            _read(oldest, rec);
+            oldest = (oldest + 1) % _slots;
+        } while (rec[0] == ERASED && oldest != _head);
+        oldest = (oldest + _slots - 1) % _slots;
+        _used = _dist(oldest, _head);
+        _tail = oldest;
+
+        /* resume after the last checkpoint */
+        for (uint32_t n = 1; n <= _used; n++) {
+            uint32_t slot = _dist(n, _head);    /* _head - n */
+            if (_read(slot, rec) == 0 && _is_checkpoint(rec)) {
+                uint32_t t = _get32(&rec[1]);
+                /* a checkpoint always points back, otherwise its slot was erased */
+                if (t < _slots && _dist(oldest, t) <= _dist(oldest, slot)) {
+                    _tail = t;
+                }
+                break;
+            }
+        }
+
+        /* a write that was cut short leaves the head unaligned */
+        if (_head % SAMPLE_LOG_BUFFER) {
+            uint32_t skip = SAMPLE_LOG_BUFFER - _head % SAMPLE_LOG_BUFFER;
+            _head = (_head + skip) % _slots;
+            _used += skip;
+            if (_head % _sector_slots == 0) {
+                _erase_ahead();
+            }
+        }
+    }
+    if (!_used) {
+        _head = 0;
+        _tail = 0;
+    }
+    _batch_end = _tail;
+    printf("Sample log: %lu of %lu slots used, %lu to send\n", (unsigned long)_used,
+           (unsigned long)_slots, (unsigned long)_dist(_tail, _head));
+    return 0;
+}
+
+int sample_log_append(const uint8_t* data, uint8_t len, bool lora, bool alarm)
+{
+    uint8_t rec[SAMPLE_LOG_RECORD] = { 0 };
+
+    if (!_mtd || len == 0 || len > SAMPLE_LOG_PAYLOAD) {
+        return -1;
+    }
+    rec[0] = (alarm ? FLAG_ALARM : 0) | (lora ? FLAG_LORA : 0) | len;
+    memcpy(&rec[1], data, len);
+    _push(rec);
+    return 0;
+}
+
+//write the buffered records now, padding the rest of the buffer
+int sample_log_flush(void)
+{
+    uint8_t rec[SAMPLE_LOG_RECORD] = { 0 };
+
+    if (!_mtd || _buffered == 0) {
+        return 0;
+    }
+    while (_buffered) {
+        _push(rec);
+    }
+    return 1;
+}
+
+//next records to replay, returns the uplink length or 0 if there are none
+uint8_t sample_log_batch(uint8_t* buf, uint8_t max)
+{
+    uint8_t rec[SAMPLE_LOG_RECORD];
+    uint32_t end = _end();
+    uint32_t slot = _tail;
+    uint8_t count = 0;
+    uint8_t pos = 1;
+
+    if (!_mtd) {
+        return 0;
+    }
+    while (slot != end && count < 0x7F) {
+        if (_read(slot, rec) == 0 && _valid(rec) && !(rec[0] & FLAG_CHECKPOINT)) {
+            uint8_t len = rec[0] & LEN_MASK;
+            if (len && pos + 1 + len > max) {
+                break;
+            }
+            if (len) {
+                buf[pos] = rec[0];
+                memcpy(&buf[pos + 1], &rec[1], len);
+                pos += 1 + len;
+                count++;
+            }
+        }
+        slot = (slot + 1) % _slots;
+    }
+    _batch_end = slot;
+    if (count == 0) {
+        if (slot == end) {
+            /* only padding, checkpoints or broken records left */
+            _tail = slot;
+        }
+        return 0;
+    }
+    buf[0] = SAMPLE_LOG_BATCH | count;
+    return pos;
+}
+
+//the last batch was delivered
+void sample_log_ack(void)
+{
+    uint8_t rec[SAMPLE_LOG_RECORD] = { 0 };
+
+    if (!_mtd || _dist(_tail, _batch_end) > _dist(_tail, _end())) {
+        /* the batch was erased meanwhile */
+        return;
+    }
+    _tail = _batch_end;
+    rec[0] = FLAG_CHECKPOINT | CHECKPOINT_LEN;
+    _put32(&rec[1], _tail);
+    _put32(&rec[5], _checkpoint++);
+    _push(rec);
+}
+
+//slots not delivered yet, including padding and checkpoints
+uint32_t sample_log_pending(void)
+{
+    return _mtd ? _dist(_tail, _end()) : 0;
+}
+
+//readings erased before they were delivered
+uint32_t sample_log_lost(void)
+{
+    return _lost;
+}
@@ -0,0 +1,59 @@
+#ifndef SAMPLE_LOG_H
+#define SAMPLE_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../config.h"
+#include "mtd.h"
+
+/*
+ * Store-and-forward log for readings that could not be delivered.
+ *
+ * Readings the uplink queue gives up on are appended to a circular log in
+ * flash (the internal flash through mtd_flashpage, or the file backed MTD
+ * of the native board). Once an uplink succeeds again, the log is replayed
+ * in batches of as many records as fit in one uplink.
+ *
+ * Flash is only written in whole buffers of SAMPLE_LOG_BUFFER records,
+ * aligned to the buffer size, and every record is written exactly once.
+ * A sector is erased when the log runs into it, so the erase cycles are
+ * spread evenly over the log sectors. When the log is full, the oldest
+ * sector is erased and its readings are lost.
+ *
+ * Delivered batches are recorded by appending a checkpoint record, so the
+ * log never rewrites a record. Checkpoints are numbered. After a reboot,
+ * the log continues at the first erased slot after the checkpoint with the
+ * highest number, and replay continues where that checkpoint points. Only
+ * without any checkpoint in flash is the head taken from where written
+ * slots turn into erased ones. Checkpoints that were still buffered are
+ * lost, so a few readings may be sent twice.
+ *
+ * Record layout (SAMPLE_LOG_RECORD bytes):
+ *
+ *     byte 0      bit 7 always 0, bit 6 checkpoint, bit 5 alarm,
+ *                 bit 4 sent over LoRaWAN, bit 3..0 payload length
+ *                 (0 for padding)
+ *     byte 1..14  payload, for checkpoints the slot to resume at and
+ *                 the checkpoint number (both 4 bytes, little endian)
+ *     byte 15     XOR of bytes 0..14 and SAMPLE_LOG_CHECK
+ *
+ * Replay uplink layout:
+ *
+ *     byte 0      0x80 | number of records
+ *     then        per record byte 0 and the payload
+ */
+#define SAMPLE_LOG_RECORD       (16)
+#define SAMPLE_LOG_PAYLOAD      (14)
+#define SAMPLE_LOG_CHECK        (0x5A)
+#define SAMPLE_LOG_BATCH        (0x80)
+
+int sample_log_init(mtd_dev_t* mtd, uint32_t sector, uint32_t sectors);
+int sample_log_append(const uint8_t* data, uint8_t len, bool lora, bool alarm);
+int sample_log_flush(void);
+uint8_t sample_log_batch(uint8_t* buf, uint8_t max);
+void sample_log_ack(void);
+uint32_t sample_log_pending(void);
+uint32_t sample_log_lost(void);
+
+#endif
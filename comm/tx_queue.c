@@ -0,0 +1,399 @@
+#include "tx_queue.h"
+#include "link_select.h"
+#include "sample_log.h"
+#include "../power.h"
+#include "../timebase.h"
+#include "../energy.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "thread.h"
+
+#define LORAWAN_OVERHEAD    (13)    /* MHDR, FHDR, FPort and MIC bytes */
+#define D7_OVERHEAD         (25)    /* D7A frame and ALP header bytes */
+#define D7_US_PER_BYTE      (144)   /* 55.555 kbps normal rate */
+#define BUDGET_WINDOW_MS    (3600000U)
+
+#if TXQ_LORA_SF < 7 || TXQ_LORA_SF > 12
+#error "TXQ_LORA_SF has to be 7 to 12"
+#endif
+
+typedef struct {
+    bool used;
+    bool alarm;
+    bool probe;
+    bool replay;
+    uint8_t len;
+    uint8_t retries;
+    alp_itf_id_t itf;
+    void* itf_cfg;
+    uint32_t seq;
+    uint32_t not_before;
+    tx_done_cb_t done;
+    uint8_t data[TXQ_PAYLOAD_MAX];
+} tx_entry_t;
+
+/* duty-cycle limit per sub-band in units of 0.1% */
+static const uint8_t _duty[EU868_SUBBAND_NUMOF] = { 10, 1, 100, 10 };
+
+/* EU868 maximum application payload at SF7 .. SF12 (DR5 .. DR0) */
+static const uint8_t _lora_max[] = { 222, 222, 115, 51, 51, 51 };
+
+static tx_entry_t _queue[TXQ_SIZE];
+static uint32_t _budget_us[EU868_SUBBAND_NUMOF];
+static uint32_t _budget_time;
+static uint32_t _seq;
+static tx_entry_t* _inflight;
+static uint32_t _inflight_start;
+static kernel_pid_t _owner_pid;
+static kernel_pid_t _tx_pid;
+static alp_itf_id_t _link_itf;
+static void* _link_cfg;
+static bool _link_set;
+/* the thread prints the completion time */
+static char _tx_stack[THREAD_STACKSIZE_DEFAULT + THREAD_EXTRA_STACKSIZE_PRINTF];
+
+static eu868_subband_t _subband(alp_itf_id_t itf)
+{
+    return (itf == ALP_ITF_ID_D7ASP) ? TXQ_D7_SUBBAND : TXQ_LORA_SUBBAND;
+}
+
+//token bucket: every ms of elapsed time earns duty * 1 us of airtime
+static void _update_budget(void)
+{
+    uint32_t now = time_now_ms();
+    uint32_t elapsed = now - _budget_time;
+    _budget_time = now;
+    if (elapsed > BUDGET_WINDOW_MS) {
+        elapsed = BUDGET_WINDOW_MS;
+    }
+    for (int i = 0; i < EU868_SUBBAND_NUMOF; i++) {
+        uint32_t max = BUDGET_WINDOW_MS * _duty[i];
+        _budget_us[i] += elapsed * _duty[i];
+        if (_budget_us[i] > max) {
+            _budget_us[i] = max;
+        }
+    }
+}
+
+//LoRa time on air (SX1276 datasheet) at BW125, CR 4/5, explicit header, CRC
+uint32_t tx_queue_airtime_us(alp_itf_id_t itf, uint8_t len)
+{
+    if (itf == ALP_ITF_ID_D7ASP) {
+        return (len + D7_OVERHEAD) * D7_US_PER_BYTE;
+    }
+    int sf = TXQ_LORA_SF;
+    int de = (sf >= 11) ? 1 : 0;
+    int num = 8 * (len + LORAWAN_OVERHEAD) - 4 * sf + 28 + 16;
+    int den = 4 * (sf - 2 * de);
+    int symbols = 8 + ((num > 0) ? ((num + den - 1) / den) * 5 : 0);
+    uint32_t tsym_us = (1UL << sf) * 8;
+    /* preamble of 8 + 4.25 symbols, in quarter symbols */
+    return ((49 + 4 * symbols) * tsym_us) / 4;
+}
+
+//largest uplink the interface carries, at TXQ_LORA_SF for LoRaWAN
+uint8_t tx_queue_payload_max(alp_itf_id_t itf)
+{
+    if (itf == ALP_ITF_ID_D7ASP || _lora_max[TXQ_LORA_SF - 7] > TXQ_PAYLOAD_MAX) {
+        return TXQ_PAYLOAD_MAX;
+    }
+    return _lora_max[TXQ_LORA_SF - 7];
+}
+
+//a reading that will not be sent from the queue goes to the sample log
+static void _drop(tx_entry_t* e)
+{
+    if (e->used && !e->probe && !e->replay) {
+        sample_log_append(e->data, e->len, e->itf != ALP_ITF_ID_D7ASP, e->alarm);
+    }
+    e->used = false;
+}
+
+//queue the next batch of logged readings on a link that just worked
+static void _replay(alp_itf_id_t itf, void* itf_cfg)
+{
+    tx_entry_t* slot = NULL;
+
+    for (int i = 0; i < TXQ_SIZE; i++) {
+        if (_queue[i].used && _queue[i].replay) {
+            return;     /* one batch at a time */
+        }
+        if (!_queue[i].used && !slot) {
+            slot = &_queue[i];
+        }
+    }
+    if (!slot || sample_log_pending() == 0) {
+        return;
+    }
+    uint8_t len = sample_log_batch(slot->data, tx_queue_payload_max(itf));
+    if (len == 0) {
+        return;
+    }
+    slot->len = len;
+    slot->itf = itf;
+    slot->itf_cfg = itf_cfg;
+    slot->alarm = false;
+    slot->probe = false;
+    slot->replay = true;
+    slot->done = NULL;
+    slot->retries = 0;
+    slot->seq = _seq++;
+    slot->not_before = time_now_ms();
+    slot->used = true;
+    printf("Replaying %d logged readings\n", slot->data[0] & ~SAMPLE_LOG_BATCH);
+}
+
+//TX thread: runs the blocking modem call and reports the status to the owner
+static void* _tx_thread(void* arg)
+{
+    (void)arg;
+    msg_t msg;
+    while (1) {
+        msg_receive(&msg);
+        tx_entry_t* e = msg.content.ptr;
+        uint32_t start = time_now_ms();
+        modem_status_t status = modem_send_unsolicited_response(0x40, 0, e->len, e->data, e->itf, e->itf_cfg);
+        printf("Command completed in %"PRIu32" ms\n", time_now_ms() - start);
+        msg.type = MSG_TYPE_TX_DONE;
+        msg.content.value = status;
+        msg_send(&msg, _owner_pid);
+    }
+    return NULL;
+}
+
+void tx_queue_init(void)
+{
+    memset(_queue, 0, sizeof(_queue));
+    _inflight = NULL;
+    _link_set = false;
+    _budget_time = time_now_ms();
+    for (int i = 0; i < EU868_SUBBAND_NUMOF; i++) {
+        _budget_us[i] = BUDGET_WINDOW_MS * _duty[i];
+    }
+    _owner_pid = thread_getpid();
+    _tx_pid = thread_create(_tx_stack, sizeof(_tx_stack), THREAD_PRIORITY_MAIN - 1,
+                            THREAD_CREATE_STACKTEST, _tx_thread, NULL, "modem_tx");
+}
+
+int tx_queue_push(const uint8_t* data, uint8_t len, alp_itf_id_t itf,
+                  void* itf_cfg, bool alarm)
+{
+    tx_entry_t* slot = NULL;
+
+    if (len > tx_queue_payload_max(itf)) {
+        return -1;
+    }
+    for (int i = 0; i < TXQ_SIZE; i++) {
+        tx_entry_t* e = &_queue[i];
+        /* coalesce: a newer routine reading supersedes a queued one */
+        if (e->used && e != _inflight && !alarm && !e->alarm && !e->probe &&
+            !e->replay && e->itf == itf) {
+            slot = e;
+            break;
+        }
+        if (!e->used && !slot) {
+            slot = e;
+        }
+    }
+    if (!slot) {
+        /* full: an alarm evicts a probe, or else the oldest routine reading
+         * to the log */
+        for (int i = 0; alarm && i < TXQ_SIZE; i++) {
+            tx_entry_t* e = &_queue[i];
+            if (e->alarm || e == _inflight || (slot && slot->probe)) {
+                continue;
+            }
+            if (!slot || e->probe || e->seq < slot->seq) {
+                slot = e;
+            }
+        }
+        if (!slot) {
+            printf("TX queue full, reading logged\n");
+            sample_log_append(data, len, itf != ALP_ITF_ID_D7ASP, alarm);
+            return -1;
+        }
+    }
+    _drop(slot);
+
+    memcpy(slot->data, data, len);
+    slot->len = len;
+    slot->itf = itf;
+    slot->itf_cfg = itf_cfg;
+    slot->alarm = alarm;
+    slot->probe = false;
+    slot->replay = false;
+    slot->done = NULL;
+    slot->retries = 0;
+    slot->seq = _seq++;
+    slot->not_before = time_now_ms();
+    slot->used = true;
+    return 0;
+}
+
+//single attempt without retries, in a free slot after queued readings
+int tx_queue_probe(const uint8_t* data, uint8_t len, alp_itf_id_t itf,
+                   void* itf_cfg, tx_done_cb_t done)
+{
+    tx_entry_t* slot = NULL;
+
+    if (len > tx_queue_payload_max(itf)) {
+        return -1;
+    }
+    for (int i = 0; i < TXQ_SIZE; i++) {
+        if (_queue[i].used && _queue[i].probe) {
+            return -1;  /* one probe at a time */
+        }
+        if (!_queue[i].used && !slot) {
+            slot = &_queue[i];
+        }
+    }
+    if (!slot) {
+        return -1;      /* never at the cost of a reading */
+    }
+    memcpy(slot->data, data, len);
+    slot->len = len;
+    slot->itf = itf;
+    slot->itf_cfg = itf_cfg;
+    slot->alarm = false;
+    slot->probe = true;
+    slot->replay = false;
+    slot->done = done;
+    slot->retries = 0;
+    slot->seq = _seq++;
+    slot->not_before = time_now_ms();
+    slot->used = true;
+    return 0;
+}
+
+//retries are sent on the link in use, right away when it changed
+void tx_queue_set_link(alp_itf_id_t itf, void* itf_cfg)
+{
+    _link_itf = itf;
+    _link_cfg = itf_cfg;
+    _link_set = true;
+    for (int i = 0; i < TXQ_SIZE; i++) {
+        tx_entry_t* e = &_queue[i];
+        if (e->used && e->retries && !e->probe && e != _inflight && e->itf != itf) {
+            e->itf = itf;
+            e->itf_cfg = itf_cfg;
+            e->not_before = time_now_ms();
+        }
+    }
+}
+
+static tx_entry_t* _next(uint32_t now)
+{
+    tx_entry_t* next = NULL;
+    for (int i = 0; i < TXQ_SIZE; i++) {
+        tx_entry_t* e = &_queue[i];
+        if (!e->used || (int32_t)(now - e->not_before) < 0 ||
+            _budget_us[_subband(e->itf)] < tx_queue_airtime_us(e->itf, e->len)) {
+            continue;
+        }
+        if (!next || (!e->probe && next->probe) ||
+            (e->probe == next->probe && e->alarm && !next->alarm) ||
+            (e->probe == next->probe && e->alarm == next->alarm &&
+             e->seq < next->seq)) {
+            next = e;
+        }
+    }
+    return next;
+}
+
+//hand the next due uplink to the TX thread, returns 1 if one was started
+int tx_queue_process(void)
+{
+    if (_inflight) {
+        return 0;
+    }
+    _update_budget();
+    tx_entry_t* e = _next(time_now_ms());
+    if (!e) {
+        return 0;
+    }
+    _budget_us[_subband(e->itf)] -= tx_queue_airtime_us(e->itf, e->len);
+    _inflight = e;
+    _inflight_start = time_now_ms();
+    /* the UART stops in STOP2 */
+    power_block(POWER_MODEM);
+    energy_set(ENERGY_MODEM, LINK_RX_CURRENT_MA * 1000);
+    energy_add(ENERGY_MODEM, (uint64_t)tx_queue_airtime_us(e->itf, e->len) *
+                             (LINK_TX_CURRENT_MA - LINK_RX_CURRENT_MA));
+
+    msg_t msg;
+    msg.content.ptr = e;
+    msg_send(&msg, _tx_pid);
+    return 1;
+}
+
+//handle MSG_TYPE_TX_DONE from the TX thread
+void tx_queue_done(msg_t* msg)
+{
+    tx_entry_t* e = _inflight;
+    modem_status_t status = (modem_status_t)msg->content.value;
+
+    _inflight = NULL;
+    power_unblock(POWER_MODEM);
+    energy_set(ENERGY_MODEM, ENERGY_MODEM_IDLE_UA);
+    if (!e) {
+        return;
+    }
+    if (status == MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
+        printf("Command completed successfully\n");
+    } else if (status == MODEM_STATUS_COMMAND_COMPLETED_ERROR) {
+        printf("Command completed with error\n");
+    } else if (status == MODEM_STATUS_COMMAND_TIMEOUT) {
+        printf("Command timed out\n");
+    }
+    link_select_report(e->itf, status, time_now_ms() - _inflight_start);
+
+    if (e->probe || e->replay || status == MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
+        e->used = false;
+        if (e->replay && status == MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
+            sample_log_ack();
+        }
+        if (e->done) {
+            e->done(status);
+        }
+        if (status == MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
+            _replay(e->itf, e->itf_cfg);
+        }
+        return;
+    }
+    if (++e->retries >= TXQ_MAX_RETRIES) {
+        printf("Uplink logged after %d attempts\n", e->retries);
+        _drop(e);
+        return;
+    }
+    if (_link_set && e->itf != _link_itf) {
+        /* the link changed while this uplink was in flight */
+        e->itf = _link_itf;
+        e->itf_cfg = _link_cfg;
+        e->not_before = time_now_ms();
+        printf("Uplink retry %d on the new link\n", e->retries);
+        return;
+    }
+    uint32_t backoff = TXQ_BACKOFF_BASE_MS << (e->retries - 1);
+    if (backoff > TXQ_BACKOFF_MAX_MS) {
+        backoff = TXQ_BACKOFF_MAX_MS;
+    }
+    e->not_before = time_now_ms() + backoff;
+    printf("Uplink retry %d in %"PRIu32" ms\n", e->retries, backoff);
+}
+
+bool tx_queue_busy(void)
+{
+    return _inflight != NULL;
+}
+
+uint8_t tx_queue_pending(void)
+{
+    uint8_t pending = 0;
+    for (int i = 0; i < TXQ_SIZE; i++) {
+        pending += _queue[i].used;
+    }
+    return pending;
+}
@@ -0,0 +1,68 @@
+#ifndef TX_QUEUE_H
+#define TX_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "modem.h"
+#include "msg.h"
+
+/*
+ * EU868 sub-bands with their duty-cycle limit in units of 0.1%
+ * (ETSI EN 300 220, as used by LoRaWAN).
+ */
+typedef enum {
+    EU868_SUBBAND_G = 0,    /* 868.0 - 868.6 MHz, 1%   */
+    EU868_SUBBAND_G1,       /* 868.7 - 869.2 MHz, 0.1% */
+    EU868_SUBBAND_G2,       /* 869.4 - 869.65 MHz, 10% */
+    EU868_SUBBAND_G3,       /* 869.7 - 870.0 MHz, 1%   */
+    EU868_SUBBAND_NUMOF
+} eu868_subband_t;
+
+#include "../config.h"
+
+/*
+ * Uplink queue in front of the modem API.
+ *
+ * Readings are queued and sent by tx_queue_process(). A failed uplink stays
+ * queued and is retried with exponential backoff. A newer routine reading
+ * replaces a queued routine reading for the same interface. Alarms are sent
+ * before routine readings and are never replaced. An uplink is only sent
+ * when its estimated airtime fits the remaining duty-cycle budget of its
+ * sub-band.
+ *
+ * The blocking modem call runs on a separate TX thread, one uplink at a time.
+ * tx_queue_process() only hands the next uplink to that thread and returns.
+ * When the modem command completes, the thread that called tx_queue_init()
+ * receives a MSG_TYPE_TX_DONE message and passes it to tx_queue_done().
+ * Probes are single attempts sent after the queued readings, their result is
+ * reported through the given callback. A probe only takes a free slot and is
+ * the first to make room for an alarm.
+ *
+ * tx_queue_set_link() tells the queue which interface is in use. Uplinks that
+ * failed are retried on that interface, right away when it changed since.
+ *
+ * Readings that are given up on (retries exhausted, superseded, evicted or
+ * not queued at all) go to the sample log. Every successful uplink queues
+ * the next batch of logged readings on the same interface, see sample_log.h.
+ * A batch is cut to what one uplink on that interface carries: on LoRaWAN
+ * the EU868 limit at TXQ_LORA_SF, 51 bytes at SF10 to SF12.
+ */
+#define MSG_TYPE_TX_DONE        (0x7001)
+
+typedef void (*tx_done_cb_t)(modem_status_t status);
+
+void tx_queue_init(void);
+int tx_queue_push(const uint8_t* data, uint8_t len, alp_itf_id_t itf,
+                  void* itf_cfg, bool alarm);
+int tx_queue_probe(const uint8_t* data, uint8_t len, alp_itf_id_t itf,
+                   void* itf_cfg, tx_done_cb_t done);
+void tx_queue_set_link(alp_itf_id_t itf, void* itf_cfg);
+int tx_queue_process(void);
+void tx_queue_done(msg_t* msg);
+bool tx_queue_busy(void);
+uint8_t tx_queue_pending(void);
+uint32_t tx_queue_airtime_us(alp_itf_id_t itf, uint8_t len);
+uint8_t tx_queue_payload_max(alp_itf_id_t itf);
+
+#endif
@@ -6,10 +6,247 @@
 #ifndef SHT3X_PARAM_REPEAT
 #define SHT3X_PARAM_REPEAT      (sht3x_low)
 #endif
+/* TCS34725 INT wired to PB14 of the octa (see README), open drain, active low */
+#if defined(BOARD_OCTA) && !defined(TCS34725_PARAM_INT_PIN)
+#define TCS34725_PARAM_INT_PIN  GPIO_PIN(PORT_B, 14)
+#endif
 
 #ifndef GPS
 #define GPS                     (0)
 #endif
 #ifndef FINGERPRINTING
 #define FINGERPRINTING          (1)
-#endif
\ No newline at end of file
+#endif
+#ifndef GPS_POLICY_OFF
+#define GPS_POLICY_OFF          (0)     /* never use the GPS */
+#endif
+#ifndef GPS_POLICY_AUTO
+#define GPS_POLICY_AUTO         (1)     /* fixes while on LoRaWAN */
+#endif
+
+// ------------------------------
+// Application settings, defaults of settings_t (settings.h)
+// ------------------------------
+#ifndef MEASURE_INTERVAL_MS
+#define MEASURE_INTERVAL_MS     (20000U) /* time between measurement loops */
+#endif
+#ifndef SEND_EVERY
+#define SEND_EVERY              (4)     /* loops per routine uplink */
+#endif
+#ifndef TEMP_ALERT
+#define TEMP_ALERT              (3000)  /* centi-degrees Celsius, alert at or above */
+#endif
+#ifndef HUM_ALERT
+#define HUM_ALERT               (3000)  /* centi-percent RH, alert at or above */
+#endif
+#ifndef FALL_THRESHOLD_MG
+#define FALL_THRESHOLD_MG       (350)   /* free fall when all axes stay below this */
+#endif
+#ifndef FALL_SAMPLES
+#define FALL_SAMPLES            (1)     /* for this many samples at 10 Hz, 2 for 40 cm, 3 for 90 cm drops */
+#endif
+#ifndef GPS_POLICY
+#define GPS_POLICY              (GPS_POLICY_AUTO)
+#endif
+#ifndef LIGHT_INT_THRESHOLD
+#define LIGHT_INT_THRESHOLD     (1000)  /* clear counts at the initial 4x range, enclosure opened */
+#endif
+#ifndef LIGHT_INT_PERSISTENCE
+#define LIGHT_INT_PERSISTENCE   (2)     /* APERS field, cycles above threshold */
+#endif
+#ifndef LIGHT_DARK_LUX
+#define LIGHT_DARK_LUX          (5)     /* re-arm light alert below this level */
+#endif
+#ifndef LIGHT_WAIT_TIME
+#define LIGHT_WAIT_TIME         (5000000U) /* us between cycles while armed */
+#endif
+#ifndef LIGHT_CALIB_FILE_ID
+#define LIGHT_CALIB_FILE_ID     (0x41)  /* modem user file with tcs34725 calibration */
+#endif
+
+/* settings at boot, checked at compile time in settings.c */
+#define SETTINGS_DEFAULT {                                          \
+        .interval_ms = MEASURE_INTERVAL_MS,                         \
+        .send_every = SEND_EVERY,                                   \
+        .temp_alert = TEMP_ALERT,                                   \
+        .hum_alert = HUM_ALERT,                                     \
+        .fall_mg = FALL_THRESHOLD_MG,                               \
+        .fall_samples = FALL_SAMPLES,                               \
+        .light_threshold = LIGHT_INT_THRESHOLD,                     \
+        .light_persistence = LIGHT_INT_PERSISTENCE,                 \
+        .gps_policy = GPS_POLICY,                                   \
+        .fall_ths = LSM303AGR_FREEFALL_THS(FALL_THRESHOLD_MG),      \
+}
+
+// ------------------------------
+// Uplink queue
+// ------------------------------
+#ifndef TXQ_SIZE
+#define TXQ_SIZE                (8)     /* queued uplinks */
+#endif
+#ifndef TXQ_PAYLOAD_MAX
+#define TXQ_PAYLOAD_MAX         (64)    /* bytes per uplink, LoRaWAN less at SF10 and up */
+#endif
+#ifndef TXQ_MAX_RETRIES
+#define TXQ_MAX_RETRIES         (5)     /* attempts before a reading is dropped */
+#endif
+#ifndef TXQ_BACKOFF_BASE_MS
+#define TXQ_BACKOFF_BASE_MS     (10000U) /* first retry delay, doubled per retry */
+#endif
+#ifndef TXQ_BACKOFF_MAX_MS
+#define TXQ_BACKOFF_MAX_MS      (600000U)
+#endif
+#ifndef TXQ_LORA_SF
+#define TXQ_LORA_SF             (9)     /* spreading factor for airtime and payload size */
+#endif
+#ifndef TXQ_LORA_SUBBAND
+#define TXQ_LORA_SUBBAND        (EU868_SUBBAND_G)
+#endif
+#ifndef TXQ_D7_SUBBAND
+#define TXQ_D7_SUBBAND          (EU868_SUBBAND_G)
+#endif
+#ifndef SAMPLE_LOG_SECTORS
+#define SAMPLE_LOG_SECTORS      (16)    /* last flash sectors used for undelivered readings */
+#endif
+#ifndef SAMPLE_LOG_BUFFER
+#define SAMPLE_LOG_BUFFER       (8)     /* records written to flash at once */
+#endif
+
+// ------------------------------
+// Link selection
+// ------------------------------
+#ifndef LINK_WINDOW
+#define LINK_WINDOW             (8)     /* remembered outcomes per interface */
+#endif
+#ifndef LINK_PROBE_MIN_MS
+#define LINK_PROBE_MIN_MS       (20000U) /* first D7 probe interval, doubled per failure */
+#endif
+#ifndef LINK_PROBE_MAX_MS
+#define LINK_PROBE_MAX_MS       (1800000U)
+#endif
+#ifndef LINK_TX_CURRENT_MA
+#define LINK_TX_CURRENT_MA      (29)    /* modem current while transmitting */
+#endif
+#ifndef LINK_RX_CURRENT_MA
+#define LINK_RX_CURRENT_MA      (12)    /* modem current while waiting for a response */
+#endif
+
+// ------------------------------
+// GPS fix cache
+// ------------------------------
+#ifndef GPS_FIX_REUSE_MS
+#define GPS_FIX_REUSE_MS        (60000U)  /* do not read the GPS for a younger fix */
+#endif
+#ifndef GPS_FIX_STALE_MS
+#define GPS_FIX_STALE_MS        (600000U) /* older fixes are flagged stale */
+#endif
+#ifndef GPS_MIN_SATS
+#define GPS_MIN_SATS            (4)     /* satellites used in the fix */
+#endif
+#ifndef GPS_MAX_HDOP
+#define GPS_MAX_HDOP            (500)   /* in 0.01, i.e. HDOP 5.0 */
+#endif
+#ifndef GPS_POLL_MS
+#define GPS_POLL_MS             (1000U) /* NMEA read interval while acquiring */
+#endif
+#ifndef GPS_FIX_TIMEOUT_MS
+#define GPS_FIX_TIMEOUT_MS      (60000U) /* back to standby without a fix after this */
+#endif
+#ifndef GPS_PERIODIC_RUN_MS
+#define GPS_PERIODIC_RUN_MS     (10000U) /* tracking time per cycle in periodic mode */
+#endif
+#ifndef GPS_PERIODIC_MAX_MS
+#define GPS_PERIODIC_MAX_MS     (900000U) /* longer fix intervals use standby instead */
+#endif
+#ifndef GPS_MOVING_DIST
+#define GPS_MOVING_DIST         (50U)   /* m between fixes to count as moving */
+#endif
+#ifndef GPS_SEED_MAX_AGE
+#define GPS_SEED_MAX_AGE        (7200000U) /* last fix used to seed time and position */
+#endif
+#ifndef GPS_ATTEMPT_LOG
+#define GPS_ATTEMPT_LOG         (16)    /* fix attempts kept for TTFF statistics */
+#endif
+
+// ------------------------------
+// Sensor sample cache
+// ------------------------------
+#ifndef SENSOR_TTL_MS
+#define SENSOR_TTL_MS           (2000U) /* readings younger than this are not read again */
+#endif
+
+// ------------------------------
+// Indoor fingerprinting
+// ------------------------------
+#ifndef FINGERPRINT
+#define FINGERPRINT             (0)     /* match the room on the device, needs gateway RSSI */
+#endif
+#ifndef FP_MAP_FILE_ID
+#define FP_MAP_FILE_ID          (0x42)  /* modem user file with the reference map */
+#endif
+#ifndef FP_MAX_GATEWAYS
+#define FP_MAX_GATEWAYS         (8)     /* gateways in the reference map */
+#endif
+#ifndef FP_MAX_POINTS
+#define FP_MAX_POINTS           (1000)  /* reference points in the map */
+#endif
+#ifndef FP_K
+#define FP_K                    (3)     /* nearest points that vote for a room */
+#endif
+#ifndef FP_RSSI_FLOOR
+#define FP_RSSI_FLOOR           (120)   /* -dBm assumed for gateways not heard */
+#endif
+#ifndef FP_MAX_RMS_DB
+#define FP_MAX_RMS_DB           (15)    /* no room if the nearest point is further off */
+#endif
+#ifndef FP_OBS_MAX_AGE
+#define FP_OBS_MAX_AGE          (60000U) /* ms a gateway RSSI is used for matching */
+#endif
+
+// ------------------------------
+// Downlink commands
+// ------------------------------
+#ifndef CMD_FILE_ID
+#define CMD_FILE_ID             (0x43)  /* modem user file the backend writes commands to */
+#endif
+#ifndef CMD_MAX
+#define CMD_MAX                 (64)    /* bytes of commands per write */
+#endif
+
+// ------------------------------
+// Low power idle and time base
+// ------------------------------
+#ifndef POWER_TRACE
+#define POWER_TRACE             (0)     /* print the idle mode on every change */
+#endif
+#ifndef VIRTUAL_TIME
+#define VIRTUAL_TIME            (0)     /* native only: the clock is provided by a test */
+#endif
+
+// ------------------------------
+// Charge estimate, currents per part and state
+// ------------------------------
+#ifndef ENERGY_MCU_RUN_UA
+#define ENERGY_MCU_RUN_UA       (7300)  /* 80 MHz, handling an event */
+#endif
+#ifndef ENERGY_MCU_SLEEP_UA
+#define ENERGY_MCU_SLEEP_UA     (2000)  /* sleep mode, uplink in flight */
+#endif
+#ifndef ENERGY_MCU_STOP_UA
+#define ENERGY_MCU_STOP_UA      (3)     /* STOP2 with LPTIM1 on LSE */
+#endif
+#ifndef ENERGY_MODEM_IDLE_UA
+#define ENERGY_MODEM_IDLE_UA    (1500)  /* modem idle, the driver keeps its LED on */
+#endif
+#ifndef ENERGY_GPS_FIX_UA
+#define ENERGY_GPS_FIX_UA       (20000) /* GPS fix attempt */
+#endif
+#ifndef ENERGY_GPS_STANDBY_UA
+#define ENERGY_GPS_STANDBY_UA   (200)
+#endif
+#ifndef ENERGY_SENSORS_UA
+#define ENERGY_SENSORS_UA       (80)    /* LSM303AGR at 10 Hz, TCS34725 waiting, SHT3x idle */
+#endif
+#ifndef ENERGY_BATTERY_MAH
+#define ENERGY_BATTERY_MAH      (2600)  /* capacity used for the battery life projection */
+#endif
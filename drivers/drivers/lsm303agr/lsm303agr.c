@@ -186,7 +186,7 @@ int LSM303AGR_read_temp(const LSM303AGR_t *dev, int16_t *value)
     return 0;
 }
 
-int LSM303AGR_enable_interrupt(const LSM303AGR_t *dev, int cm)
+int LSM303AGR_enable_interrupt(const LSM303AGR_t *dev, uint8_t ths, uint8_t dur)
 {
 	int res = 0;
 	uint8_t tmp;
@@ -220,21 +220,9 @@ int LSM303AGR_enable_interrupt(const LSM303AGR_t *dev, int cm)
 	//res += i2c_write_reg(DEV_I2C, DEV_ACC_ADDR,
     //                    LSM303AGR_REG_CTRL5_A ,0x08, 0); //Interrupt latched
 	res += i2c_write_reg(DEV_I2C, DEV_ACC_ADDR,
-                        LSM303AGR_REG_INT1_THS_A ,0x16, 0); //Set free fall threshold = 350mg (*16mg for 2G)
-	switch (cm){
-		case 40:
-		res += i2c_write_reg(DEV_I2C, DEV_ACC_ADDR,
-                        LSM303AGR_REG_INT1_DURATION_A ,0x02, 0); //Set minimum event duration (/ODR (default 10Hz)) max = 0x7F
-		break;
-		case 90:
-		res += i2c_write_reg(DEV_I2C, DEV_ACC_ADDR,
-                        LSM303AGR_REG_INT1_DURATION_A ,0x03, 0); 
-		break;
-		default:
-		res += i2c_write_reg(DEV_I2C, DEV_ACC_ADDR,
-                        LSM303AGR_REG_INT1_DURATION_A ,0x01, 0); 
-		break;
-	}
+                        LSM303AGR_REG_INT1_THS_A ,ths & 0x7F, 0); //Set free fall threshold (*16mg for 2G)
+	res += i2c_write_reg(DEV_I2C, DEV_ACC_ADDR,
+                        LSM303AGR_REG_INT1_DURATION_A ,dur & 0x7F, 0); //Set minimum event duration (/ODR (default 10Hz)) max = 0x7F
 	tmp = (LSM303AGR_INT1_XLIE
 				  | LSM303AGR_INT1_YLIE
 				  | LSM303AGR_INT1_ZLIE
@@ -247,6 +235,20 @@ int LSM303AGR_enable_interrupt(const LSM303AGR_t *dev, int cm)
 	return (res < 0) ? -1 : 0;
 }
 
+int LSM303AGR_set_freefall(const LSM303AGR_t *dev, uint8_t ths, uint8_t dur)
+{
+	int res = 0;
+
+	i2c_acquire(DEV_I2C);
+	res += i2c_write_reg(DEV_I2C, DEV_ACC_ADDR,
+                        LSM303AGR_REG_INT1_THS_A ,ths & 0x7F, 0);
+	res += i2c_write_reg(DEV_I2C, DEV_ACC_ADDR,
+                        LSM303AGR_REG_INT1_DURATION_A ,dur & 0x7F, 0);
+	i2c_release(DEV_I2C);
+
+	return (res < 0) ? -1 : 0;
+}
+
 int LSM303AGR_clear_int(const LSM303AGR_t *dev, int8_t *value)
 {
 	int res;
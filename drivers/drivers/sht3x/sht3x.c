@@ -17,7 +17,7 @@
 #include <errno.h>
 #include <string.h>
 #include "sht3x.h"
-#include "xtimer.h"
+#include "ztimer.h"
 #define ASSERT_PARAM(cond) \
     if (!(cond)) { \
         DEBUG("[sht3x] %s: %s\n", \
@@ -40,14 +40,14 @@
 #define SHT3X_STATUS_REG_MASK   (0xbc13)
 #define SHT3X_STATUS_REG_CRC    (1 << 0)
 #define SHT3X_STATUS_REG_CMD    (1 << 1)
-/** SHT3x measurement period times in us */
+/** SHT3x measurement period times in ms */
 uint32_t SHT3X_MEASURE_PERIOD[] = {
-          0,   /* [SINGLE_SHOT] */
-    2000000,   /* [PERIODIC_05] */
-    1000000,   /* [PERIODIC_1 ] */
-     500000,   /* [PERIODIC_2 ] */
-     250000,   /* [PERIODIC_4 ] */
-     100000    /* [PERIODIC_10] */
+       0,   /* [SINGLE_SHOT] */
+    2000,   /* [PERIODIC_05] */
+    1000,   /* [PERIODIC_1 ] */
+     500,   /* [PERIODIC_2 ] */
+     250,   /* [PERIODIC_4 ] */
+     100    /* [PERIODIC_10] */
 };
 /** SHT3x measurement command sequences */
 const uint16_t SHT3X_MEASURE_CMD[6][3] = {
@@ -63,10 +63,12 @@ const uint16_t SHT3X_MEASURE_CMD[6][3] = {
 #define SHT3X_MEAS_DURATION_REP_MEDIUM 7
 #define SHT3X_MEAS_DURATION_REP_LOW    5
 #define SHT3X_RAW_DATA_SIZE 6
-/** measurement durations in us */
-const uint16_t SHT3X_MEAS_DURATION_US[3] = { SHT3X_MEAS_DURATION_REP_HIGH   * 1000,
-                                             SHT3X_MEAS_DURATION_REP_MEDIUM * 1000,
-                                             SHT3X_MEAS_DURATION_REP_LOW    * 1000 };
+/** the ms clock truncates the start time, waits are 1 ms longer to cover it */
+#define SHT3X_MSEC_ROUNDING 1
+/** measurement durations in ms */
+const uint16_t SHT3X_MEAS_DURATION_MS[3] = { SHT3X_MEAS_DURATION_REP_HIGH,
+                                             SHT3X_MEAS_DURATION_REP_MEDIUM,
+                                             SHT3X_MEAS_DURATION_REP_LOW };
 /** functions for internal use */
 static int _get_raw_data(sht3x_dev_t* dev, uint8_t* raw_data);
 static int _compute_values (uint8_t* raw_data, int16_t* temp, int16_t* hum);
@@ -94,6 +96,7 @@ int sht3x_init (sht3x_dev_t *dev, const sht3x_params_t *params)
     dev->meas_start_time = 0;
     dev->meas_duration = 0;
     dev->meas_started = false;
+    dev->saul_valid = false;
     /* try to reset the sensor */
     if ((res = _reset(dev)) != SHT3X_OK) {
         return res;
@@ -193,7 +196,7 @@ static int _start_measurement (sht3x_dev_t* dev)
      */
     if (dev->mode != sht3x_single_shot) {
         /* sensor needs up to 250 us to process the measurement command */
-        xtimer_usleep (1000);
+        ztimer_sleep(ZTIMER_USEC, 1000);
         uint16_t status;
         int res;
         /* read the status after start measurement command */
@@ -206,8 +209,8 @@ static int _start_measurement (sht3x_dev_t* dev)
             return SHT3X_ERROR_MEASURE_CMD_INV;
         }
     }
-    dev->meas_start_time = xtimer_now_usec();
-    dev->meas_duration = SHT3X_MEAS_DURATION_US[dev->repeat];
+    dev->meas_start_time = ztimer_now(ZTIMER_MSEC);
+    dev->meas_duration = SHT3X_MEAS_DURATION_MS[dev->repeat] + SHT3X_MSEC_ROUNDING;
     dev->meas_started = true;
     return SHT3X_OK;
 }
@@ -220,10 +223,10 @@ static int _get_raw_data(sht3x_dev_t* dev, uint8_t* raw_data)
         return res;
     }
     /* determine the time elapsed since the start of current measurement cycle */
-    uint32_t elapsed = xtimer_now_usec() - dev->meas_start_time;
+    uint32_t elapsed = ztimer_now(ZTIMER_MSEC) - dev->meas_start_time;
     if (elapsed < dev->meas_duration) {
         /* if necessary, wait until the measurement results become available */
-        xtimer_usleep(dev->meas_duration - elapsed);
+        ztimer_sleep(ZTIMER_MSEC, dev->meas_duration - elapsed);
     }
     /* send fetch command in any periodic mode (mode > 0) before read raw data */
     if (dev->mode != sht3x_single_shot &&
@@ -242,8 +245,8 @@ static int _get_raw_data(sht3x_dev_t* dev, uint8_t* raw_data)
     }
     /* start next measurement cycle in periodic modes */
     else {
-        dev->meas_start_time = xtimer_now_usec();
-        dev->meas_duration = SHT3X_MEASURE_PERIOD[dev->mode];
+        dev->meas_start_time = ztimer_now(ZTIMER_MSEC);
+        dev->meas_duration = SHT3X_MEASURE_PERIOD[dev->mode] + SHT3X_MSEC_ROUNDING;
     }
     /* check temperature crc */
     if (_crc8(raw_data,2) != raw_data[2]) {
@@ -352,21 +355,21 @@ static int _reset (sht3x_dev_t* dev)
      * at this moment.
      */
     _send_command(dev, SHT3X_MEASURE_CMD[sht3x_single_shot][sht3x_low]);
-    xtimer_usleep (3000);
+    ztimer_sleep(ZTIMER_MSEC, 3);
     /* send the soft-reset command */
     if (_send_command(dev, SHT3X_RESET_CMD) != SHT3X_OK) {
         DEBUG_DEV("reset failed, could not send SHT3X_RESET_CMD", dev);
         return -SHT3X_ERROR_I2C;
     }
     /* wait for 2 ms, the time needed to restart (according to datasheet 0.5 ms) */
-    xtimer_usleep (2000);
+    ztimer_sleep(ZTIMER_MSEC, 2);
     /* send reset command */
     if (_send_command(dev, SHT3X_CLEAR_STATUS_CMD) != SHT3X_OK) {
         DEBUG_DEV("reset failed, could not send SHT3X_CLEAR_STATUS_CMD", dev);
         return -SHT3X_ERROR_I2C;
     }
     /* sensor needs some time to process the command */
-    xtimer_usleep (500);
+    ztimer_sleep(ZTIMER_USEC, 500);
     uint16_t status;
     int res = SHT3X_OK;
     /* read the status after reset */
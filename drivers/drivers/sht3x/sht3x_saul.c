@@ -17,36 +17,35 @@
 #include "phydat.h"
 #include "saul.h"
 #include "sht3x.h"
+#include "ztimer.h"
 /**
  * Humidity and temperature sensor values are fetched by separate saul
  * functions. To avoid double waiting for the sensor and readout of the
- * sensor values, we read both sensor values once, if necessary, and
- * store them in local variables to provide them in the separate saul
- * read functions.
+ * sensor values, both are read in one measurement and stored with its time
+ * in the device descriptor. Both saul read functions hand out that pair
+ * until it is SHT3X_SAUL_TTL_MS old.
  */
-static bool _temp_valid = false;
-static bool _hum_valid = false;
-static int16_t _temp;
-static int16_t _hum;
-static int read(const sht3x_dev_t *dev)
+static int read(sht3x_dev_t *dev)
 {
+    uint32_t now = ztimer_now(ZTIMER_MSEC);
+    if (dev->saul_valid && now - dev->saul_time < SHT3X_SAUL_TTL_MS) {
+        return SHT3X_OK;
+    }
     /* read both sensor values */
-    int res = sht3x_read((sht3x_dev_t *)dev, &_temp, &_hum);
+    int res = sht3x_read(dev, &dev->temp, &dev->hum);
     if (res != SHT3X_OK) {
+        dev->saul_valid = false;
         return res;
     }
-    /* mark both sensor values as valid */
-    _temp_valid = true;
-    _hum_valid = true;
+    dev->saul_valid = true;
+    dev->saul_time = now;
     return SHT3X_OK;
 }
 static int read_temp(const void *dev, phydat_t *data)
 {
-    /* either local variable is valid or fetching it was successful */
-    if (_temp_valid || read(dev) == SHT3X_OK) {
-        /* mark local variable as invalid */
-        _temp_valid = false;
-        data->val[0] = _temp;
+    sht3x_dev_t *sht3x = (sht3x_dev_t *)dev;
+    if (read(sht3x) == SHT3X_OK) {
+        data->val[0] = sht3x->temp;
         data->unit = UNIT_TEMP_C;
         data->scale = -2;
         return 1;
@@ -55,11 +54,9 @@ static int read_temp(const void *dev, phydat_t *data)
 }
 static int read_hum(const void *dev, phydat_t *data)
 {
-    /* either local variable is valid or fetching it was successful */
-    if (_hum_valid || read(dev) == SHT3X_OK) {
-        /* mark local variable as invalid */
-        _hum_valid = false;
-        data->val[0] = _hum;
+    sht3x_dev_t *sht3x = (sht3x_dev_t *)dev;
+    if (read(sht3x) == SHT3X_OK) {
+        data->val[0] = sht3x->hum;
         data->unit = UNIT_PERCENT;
         data->scale = -2;
         return 1;
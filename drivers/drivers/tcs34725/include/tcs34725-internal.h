@@ -30,8 +30,20 @@ extern "C"
 #define TCS34725_AG_THRESHOLD_LOW       200
 #endif
 
-#ifndef TCS34725_AG_THRESHOLD_HIGH
-#define TCS34725_AG_THRESHOLD_HIGH      (65535 - TCS34725_AG_THRESHOLD_LOW)
+#ifndef TCS34725_AG_SATURATION_PCT
+#define TCS34725_AG_SATURATION_PCT      90  /* % of max count treated as saturated */
+#endif
+
+#ifndef TCS34725_AG_TARGET_PCT
+#define TCS34725_AG_TARGET_PCT          50  /* % of max count aimed for on re-range */
+#endif
+
+#ifndef TCS34725_AG_STEP_MARGIN
+#define TCS34725_AG_STEP_MARGIN         2   /* x dark limit kept on a saturated step down */
+#endif
+
+#ifndef TCS34725_AG_MAX_READS
+#define TCS34725_AG_MAX_READS           2   /* one-shot reads until a valid value */
 #endif
 
 /**
@@ -123,6 +135,28 @@ extern "C"
 #define TCS34725_ENABLE_PON         (1 << 0) /**< Power ON */
 /** @} */
 
+/**
+ * @name    Status Register
+ * @{
+ */
+#define TCS34725_STATUS_AINT        (1 << 4) /**< Clear channel interrupt */
+#define TCS34725_STATUS_AVALID      (1 << 0) /**< RGBC integration cycle completed */
+/** @} */
+
+/**
+ * @name    Configuration Register
+ * @{
+ */
+#define TCS34725_CONFIG_WLONG       (1 << 1) /**< Wait time is increased by 12x */
+/** @} */
+
+/**
+ * @name    Persistence Register
+ * @{
+ */
+#define TCS34725_PERS_APERS_MASK    0x0F /**< Clear channel persistence mask */
+/** @} */
+
 /**
  * @name    Control Register
  * @{
@@ -156,12 +190,37 @@ extern "C"
 
 #define TCS34725_ATIME_TO_REG(val)  (256 - (uint8_t)((val) / 2400))
 #define TCS34725_ATIME_TO_US(reg)   ((256 - (uint8_t)(reg)) * 2400)
+#define TCS34725_MAX_COUNT(cycles)  (((cycles) >= 64) ? 65535 : ((cycles) * 1024))
+/** @} */
+
+/**
+ * @brief   Fixed-point shift of the precomputed 1/CPL multiplier
+ */
+#define TCS34725_RECIP_SHIFT        24
+
+/**
+ * @name    Predefined WTIME register values.
+ * @{
+ */
+#define TCS34725_WTIME_MAX          614400  /* 614ms wait time without WLONG */
+#define TCS34725_WTIME_LONG_MAX     7372800 /* 7.4s wait time with WLONG */
+
+#define TCS34725_WTIME_TO_REG(val)  (256 - (uint8_t)((val) / 2400))
+/** @} */
+
+/**
+ * @name    Power sequencing
+ * @{
+ */
+#define TCS34725_PON_DELAY          2400    /* oscillator warm-up after PON in us */
+#define TCS34725_AVALID_RETRIES     3       /* extra 2.4ms polls for AVALID */
 /** @} */
 
 /**
  * @name    Coefficients for Lux and CT Equations (DN40)
  *
- * @note    Coefficients in integer format, multiplied by 1000.
+ * @note    Coefficients in integer format, multiplied by 1000. These are the
+ *          defaults of the calibration record, see ::tcs34725_set_calib.
  * @{
  */
 #define DGF_IF                      310
@@ -41,10 +41,15 @@ extern "C" {
 #define TCS34725_PARAM_ATIME        (TCS34725_ATIME_DEFAULT)
 #endif
 
+#ifndef TCS34725_PARAM_INT_PIN
+#define TCS34725_PARAM_INT_PIN      (GPIO_UNDEF)
+#endif
+
 #ifndef TCS34725_PARAMS
-#define TCS34725_PARAMS             { .i2c   = TCS34725_PARAM_I2C,  \
-                                      .addr  = TCS34725_PARAM_ADDR, \
-                                      .atime = TCS34725_PARAM_ATIME }
+#define TCS34725_PARAMS             { .i2c     = TCS34725_PARAM_I2C,  \
+                                      .addr    = TCS34725_PARAM_ADDR, \
+                                      .atime   = TCS34725_PARAM_ATIME, \
+                                      .int_pin = TCS34725_PARAM_INT_PIN }
 #endif
 #ifndef TCS34725_SAUL_INFO
 #define TCS34725_SAUL_INFO          { .name = "tcs34725" }
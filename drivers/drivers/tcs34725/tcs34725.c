@@ -26,6 +26,7 @@
 
 #include "log.h"
 #include "assert.h"
+#include "ztimer.h"
 
 #include "tcs34725.h"
 #include "tcs34725-internal.h"
@@ -45,6 +46,23 @@ int tcs34725_init(tcs34725_t *dev, const tcs34725_params_t *params)
 
     /* initialize the device descriptor */
     memcpy(&dev->p, params, sizeof(tcs34725_params_t));
+    dev->again = 4;
+    dev->int_low = 0;
+    dev->int_high = 0;
+    dev->int_sens = dev->again * (dev->p.atime / TCS34725_ATIME_MIN);
+    tcs34725_calib_t calib = {
+        .ga = TCS34725_CALIB_ONE,
+        .gain = { TCS34725_CALIB_ONE, TCS34725_CALIB_ONE,
+                  TCS34725_CALIB_ONE, TCS34725_CALIB_ONE },
+        .dark = { 0, 0, 0, 0 },
+        .dgf = DGF_IF,
+        .r_coef = R_COEF_IF,
+        .g_coef = G_COEF_IF,
+        .b_coef = B_COEF_IF,
+        .ct_coef = CT_COEF_IF,
+        .ct_offset = CT_OFFSET_IF,
+    };
+    tcs34725_set_calib(dev, &calib);
 
     /* setup the I2C bus */
     i2c_acquire(BUS);
@@ -61,7 +79,6 @@ int tcs34725_init(tcs34725_t *dev, const tcs34725_params_t *params)
     i2c_write_reg(BUS, ADR, TCS34725_ATIME,
                   TCS34725_ATIME_TO_REG(dev->p.atime), 0);
     i2c_write_reg(BUS, ADR, TCS34725_CONTROL, TCS34725_CONTROL_AGAIN_4, 0);
-    dev->again = 4;
 
     /* enable the device */
     tmp = (TCS34725_ENABLE_AEN | TCS34725_ENABLE_PON);
@@ -72,6 +89,34 @@ int tcs34725_init(tcs34725_t *dev, const tcs34725_params_t *params)
     return TCS34725_OK;
 }
 
+/**
+ * Precompute everything tcs34725_read() would otherwise divide by. Only
+ * called when calibration, gain or integration time change.
+ */
+static void tcs34725_update_scale(tcs34725_t *dev)
+{
+    uint32_t cycles = dev->p.atime / TCS34725_ATIME_MIN;
+
+    /* DN40: CPL = (ATIME_ms * AGAINx) / (GA * DF), stored as 1/CPL */
+    uint64_t cpl_recip = ((uint64_t)dev->dgf_ga << TCS34725_RECIP_SHIFT) /
+                         ((uint32_t)dev->p.atime * dev->again);
+    dev->cpl_recip = (cpl_recip > UINT32_MAX) ? UINT32_MAX : cpl_recip;
+    dev->sat_count = (TCS34725_MAX_COUNT(cycles) / 100) *
+                     TCS34725_AG_SATURATION_PCT;
+}
+
+void tcs34725_set_calib(tcs34725_t *dev, const tcs34725_calib_t *calib)
+{
+    assert(dev && calib && calib->ga && calib->dgf);
+
+    dev->calib = *calib;
+    dev->dgf_ga = ((int32_t)calib->dgf * calib->ga) >> TCS34725_CALIB_SHIFT;
+    if (dev->dgf_ga == 0) {
+        dev->dgf_ga = 1;
+    }
+    tcs34725_update_scale(dev);
+}
+
 void tcs34725_set_rgbc_active(const tcs34725_t *dev)
 {
     uint8_t reg;
@@ -101,56 +146,82 @@ void tcs34725_set_rgbc_standby(const tcs34725_t *dev)
     i2c_release(BUS);
 }
 
-static uint8_t tcs34725_trim_gain(tcs34725_t *dev, int32_t rawc)
+/**
+ * Auto-range table ordered by sensitivity (gain x integration cycles of
+ * 2.4 ms). Neighbouring entries are at most 16x apart, so the count of an
+ * unsaturated reading predicts the best entry for the next reading.
+ */
+static const struct {
+    uint8_t again_reg;
+    uint8_t again;
+    uint16_t cycles;
+} _ranges[] = {
+    { TCS34725_CONTROL_AGAIN_1,   1,   1 },
+    { TCS34725_CONTROL_AGAIN_1,   1,  10 },
+    { TCS34725_CONTROL_AGAIN_1,   1,  64 },
+    { TCS34725_CONTROL_AGAIN_4,   4,  64 },
+    { TCS34725_CONTROL_AGAIN_16, 16,  64 },
+    { TCS34725_CONTROL_AGAIN_60, 60,  64 },
+    { TCS34725_CONTROL_AGAIN_60, 60, 256 },
+};
+
+#define RANGES_NUMOF    (sizeof(_ranges) / sizeof(_ranges[0]))
+
+#define RANGE_SENS(idx) ((uint32_t)_ranges[idx].again * _ranges[idx].cycles)
+
+/**
+ * Interrupt threshold for the present range, thresholds are given in counts
+ * at the range of tcs34725_init().
+ */
+static uint16_t tcs34725_int_count(const tcs34725_t *dev, uint16_t count)
 {
-    uint8_t reg_again = 0;
-    int val_again = dev->again;
+    uint32_t cycles = dev->p.atime / TCS34725_ATIME_MIN;
+    uint64_t scaled = ((uint64_t)count * dev->again * cycles) / dev->int_sens;
 
-    if (rawc < TCS34725_AG_THRESHOLD_LOW) {
-        switch (val_again) {
-            case 1:
-                reg_again = TCS34725_CONTROL_AGAIN_4;
-                val_again = 4;
-                break;
+    return (scaled > TCS34725_MAX_COUNT(cycles)) ? TCS34725_MAX_COUNT(cycles) : scaled;
+}
 
-            case 4:
-                reg_again = TCS34725_CONTROL_AGAIN_16;
-                val_again = 16;
-                break;
+static int tcs34725_write_int_counts(const tcs34725_t *dev)
+{
+    uint16_t low = tcs34725_int_count(dev, dev->int_low);
+    uint16_t high = tcs34725_int_count(dev, dev->int_high);
+    uint8_t buf[4] = { low & 0xff, low >> 8, high & 0xff, high >> 8 };
 
-            case 16:
-                reg_again = TCS34725_CONTROL_AGAIN_60;
-                val_again = 60;
-                break;
+    return i2c_write_regs(BUS, ADR, (TCS34725_INC_TRANS | TCS34725_AILTL),
+                          buf, 4, 0);
+}
 
-            case 60:
-            default:
-                return -1;
+static int tcs34725_autorange(tcs34725_t *dev, uint32_t rawc, bool saturated)
+{
+    uint32_t cycles = dev->p.atime / TCS34725_ATIME_MIN;
+    uint32_t sens = dev->again * cycles;
+    unsigned idx;
+
+    if (saturated) {
+        /* A saturated count is only a lower bound. Step down as far as this
+         * bound stays clear of the dark limit, so the next reading is not
+         * rejected as dark in moderately bright light. */
+        for (idx = 0; idx < RANGES_NUMOF - 1; idx++) {
+            uint32_t pred = ((uint64_t)dev->sat_count * RANGE_SENS(idx)) / sens;
+            if (pred >= TCS34725_AG_THRESHOLD_LOW * TCS34725_AG_STEP_MARGIN) {
+                break;
+            }
+        }
+        while ((idx > 0) && (RANGE_SENS(idx) >= sens)) {
+            idx--;
         }
     }
-    else if (rawc > TCS34725_AG_THRESHOLD_HIGH) {
-        switch (val_again) {
-            case 60:
-                reg_again = TCS34725_CONTROL_AGAIN_16;
-                val_again = 16;
-                break;
-
-            case 16:
-                reg_again = TCS34725_CONTROL_AGAIN_4;
-                val_again = 4;
-                break;
-
-            case 4:
-                reg_again = TCS34725_CONTROL_AGAIN_1;
-                val_again = 1;
+    else {
+        for (idx = RANGES_NUMOF - 1; idx > 0; idx--) {
+            uint32_t pred = (rawc * RANGE_SENS(idx)) / sens;
+            if (pred <= (TCS34725_MAX_COUNT(_ranges[idx].cycles) / 100) *
+                        TCS34725_AG_TARGET_PCT) {
                 break;
-
-            case 1:
-            default:
-                return -1;
+            }
         }
     }
-    else {
+
+    if ((_ranges[idx].again == dev->again) && (_ranges[idx].cycles == cycles)) {
         return 0;
     }
 
@@ -158,34 +229,79 @@ static uint8_t tcs34725_trim_gain(tcs34725_t *dev, int32_t rawc)
     uint8_t reg = 0;
     if (i2c_read_reg(BUS, ADR, TCS34725_CONTROL, &reg, 0) < 0) {
         i2c_release(BUS);
-        return -2;
+        return TCS34725_NOBUS;
     }
     reg &= ~TCS34725_CONTROL_AGAIN_MASK;
-    reg |= reg_again;
-    if (i2c_write_reg(BUS, ADR, TCS34725_CONTROL, reg, 0) < 0) {
+    reg |= _ranges[idx].again_reg;
+    if ((i2c_write_reg(BUS, ADR, TCS34725_CONTROL, reg, 0) < 0) ||
+        (i2c_write_reg(BUS, ADR, TCS34725_ATIME,
+                       (uint8_t)(256 - _ranges[idx].cycles), 0) < 0)) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    dev->again = _ranges[idx].again;
+    dev->p.atime = _ranges[idx].cycles * TCS34725_ATIME_MIN;
+    tcs34725_update_scale(dev);
+
+    /* the interrupt compares raw counts, keep its light level */
+    if (dev->int_high && (tcs34725_write_int_counts(dev) < 0)) {
         i2c_release(BUS);
-        return -2;
+        return TCS34725_NOBUS;
     }
     i2c_release(BUS);
-    dev->again = val_again;
+    DEBUG("[tcs34725] autorange: gain %dx atime %"PRIu32" us\n",
+          dev->again, dev->p.atime);
 
-    return 0;
+    return 1;
 }
 
-void tcs34725_read(const tcs34725_t *dev, tcs34725_data_t *data)
+static inline int32_t _trim(int32_t raw, uint16_t dark, uint16_t gain)
+{
+    /* dark offset and channel gain, a multiply and shift only */
+    raw = (raw > dark) ? (raw - dark) : 0;
+    return (int32_t)(((uint32_t)raw * gain) >> TCS34725_CALIB_SHIFT);
+}
+
+static inline int32_t _scale(int64_t val, uint32_t recip)
+{
+    /* val / CPL as multiply with the precomputed reciprocal */
+    return (int32_t)((val * recip) >> TCS34725_RECIP_SHIFT);
+}
+
+int tcs34725_read(tcs34725_t *dev, tcs34725_data_t *data)
 {
     uint8_t buf[8];
+    uint8_t status;
 
     assert(dev && data);
 
     i2c_acquire(BUS);
-    i2c_read_regs(BUS, ADR, (TCS34725_INC_TRANS | TCS34725_CDATA), buf, 8, 0);
+    if (i2c_read_reg(BUS, ADR, TCS34725_STATUS, &status, 0) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    if (!(status & TCS34725_STATUS_AVALID)) {
+        i2c_release(BUS);
+        DEBUG("[tcs34725] read: no valid RGBC data\n");
+        return TCS34725_NODATA;
+    }
+    if (i2c_read_regs(BUS, ADR, (TCS34725_INC_TRANS | TCS34725_CDATA),
+                      buf, 8, 0) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
     i2c_release(BUS);
 
-    int32_t tmpc = ((uint16_t)buf[1] << 8) | buf[0];
-    int32_t tmpr = ((uint16_t)buf[3] << 8) | buf[2];
-    int32_t tmpg = ((uint16_t)buf[5] << 8) | buf[4];
-    int32_t tmpb = ((uint16_t)buf[7] << 8) | buf[6];
+    const tcs34725_calib_t *cal = &dev->calib;
+    uint32_t cpl_recip = dev->cpl_recip;
+    int32_t rawc = ((uint16_t)buf[1] << 8) | buf[0];
+    int32_t tmpc = _trim(rawc, cal->dark[0], cal->gain[0]);
+    int32_t tmpr = _trim(((uint16_t)buf[3] << 8) | buf[2],
+                         cal->dark[1], cal->gain[1]);
+    int32_t tmpg = _trim(((uint16_t)buf[5] << 8) | buf[4],
+                         cal->dark[2], cal->gain[2]);
+    int32_t tmpb = _trim(((uint16_t)buf[7] << 8) | buf[6],
+                         cal->dark[3], cal->gain[3]);
     DEBUG("rawr: %"PRIi32" rawg %"PRIi32" rawb %"PRIi32" rawc %"PRIi32"\n",
           tmpr, tmpg, tmpb, tmpc);
 
@@ -195,22 +311,234 @@ void tcs34725_read(const tcs34725_t *dev, tcs34725_data_t *data)
     tmpg -= ir;
     tmpb -= ir;
 
-    /* Color temperature calculation as described in the DN40. */
-    int32_t ct = (CT_COEF_IF * tmpb) / tmpr + CT_OFFSET_IF;
+    /* Color temperature calculation as described in the DN40, the only
+     * division left. Without red light after IR removal CT is undefined. */
+    int32_t ct = (tmpr > 0) ? (cal->ct_coef * tmpb) / tmpr + cal->ct_offset : 0;
+
+    /* Lux calculation as described in the DN40, GA is part of cpl_recip,
+     * in deci-lux so dim light keeps its first decimal */
+    int32_t gi = cal->r_coef * tmpr + cal->g_coef * tmpg + cal->b_coef * tmpb;
+    int32_t dlux = _scale((int64_t)gi * 10, cpl_recip);
+
+    /* Validity of this reading and range for the next one */
+    bool saturated = (uint32_t)rawc > dev->sat_count;
+    bool dark = (rawc < TCS34725_AG_THRESHOLD_LOW) &&
+                (dev->again < 60 || dev->p.atime < TCS34725_ATIME_MAX);
+    data->valid = !saturated && !dark;
+    if (!data->valid) {
+        tcs34725_autorange(dev, rawc, saturated);
+    }
+
+    /* channels are scaled with the CPL of the reading, not the new range */
+    data->red = (tmpr < 0) ? 0 : _scale((int64_t)tmpr * 1000, cpl_recip);
+    data->green = (tmpg < 0) ? 0 : _scale((int64_t)tmpg * 1000, cpl_recip);
+    data->blue = (tmpb < 0) ? 0 : _scale((int64_t)tmpb * 1000, cpl_recip);
+    data->clear = _scale((int64_t)tmpc * 1000, cpl_recip);
+    data->dlux = (dlux < 0) ? 0 : dlux;
+    data->lux = data->dlux / 10;
+    data->ct = (ct < 0) ? 0 : ct;
 
-    /* Lux calculation as described in the DN40.  */
-    int32_t gi = R_COEF_IF * tmpr + G_COEF_IF * tmpg + B_COEF_IF * tmpb;
-    /* TODO: add Glass Attenuation Factor GA compensation */
-    int32_t cpl = (dev->p.atime * dev->again) / DGF_IF;
-    int32_t lux = gi / cpl;
+    return TCS34725_OK;
+}
 
-    /* Autogain */
-    tcs34725_trim_gain((tcs34725_t *)dev, tmpc);
+static int tcs34725_measure(tcs34725_t *dev, uint8_t en,
+                            tcs34725_data_t *data)
+{
+    uint8_t status = 0;
 
-    data->red = (tmpr < 0) ? 0 : (tmpr * 1000) / cpl;
-    data->green = (tmpg < 0) ? 0 : (tmpg * 1000) / cpl;
-    data->blue = (tmpb < 0) ? 0 : (tmpb * 1000) / cpl;
-    data->clear = (tmpb < 0) ? 0 : (tmpc * 1000) / cpl;
-    data->lux = (lux < 0) ? 0 : lux;
-    data->ct = (ct < 0) ? 0 : ct;
+    /* toggle AEN to restart integration, so gain changes take effect */
+    i2c_acquire(BUS);
+    if ((i2c_write_reg(BUS, ADR, TCS34725_ENABLE,
+                       (en | TCS34725_ENABLE_PON) & ~TCS34725_ENABLE_AEN, 0) < 0) ||
+        (i2c_write_reg(BUS, ADR, TCS34725_ENABLE,
+                       (en | TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN), 0) < 0)) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    i2c_release(BUS);
+
+    ztimer_sleep(ZTIMER_MSEC, (dev->p.atime + TCS34725_PON_DELAY + 999) / 1000);
+    for (int i = 0; i <= TCS34725_AVALID_RETRIES; i++) {
+        i2c_acquire(BUS);
+        int res = i2c_read_reg(BUS, ADR, TCS34725_STATUS, &status, 0);
+        i2c_release(BUS);
+        if (res < 0) {
+            return TCS34725_NOBUS;
+        }
+        if (status & TCS34725_STATUS_AVALID) {
+            break;
+        }
+        ztimer_sleep(ZTIMER_MSEC, (TCS34725_ATIME_MIN + 999) / 1000);
+    }
+
+    return tcs34725_read(dev, data);
+}
+
+int tcs34725_read_oneshot(tcs34725_t *dev, tcs34725_data_t *data)
+{
+    uint8_t en;
+    int res;
+
+    assert(dev && data);
+
+    i2c_acquire(BUS);
+    if (i2c_read_reg(BUS, ADR, TCS34725_ENABLE, &en, 0) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    if (!(en & TCS34725_ENABLE_PON)) {
+        if (i2c_write_reg(BUS, ADR, TCS34725_ENABLE, TCS34725_ENABLE_PON, 0) < 0) {
+            i2c_release(BUS);
+            return TCS34725_NOBUS;
+        }
+        i2c_release(BUS);
+        ztimer_sleep(ZTIMER_USEC, TCS34725_PON_DELAY);
+        i2c_acquire(BUS);
+    }
+    i2c_release(BUS);
+
+    /* repeat once the auto-range picked a better gain and integration time */
+    for (int i = 0; i < TCS34725_AG_MAX_READS; i++) {
+        int again = dev->again;
+        uint32_t atime = dev->p.atime;
+        res = tcs34725_measure(dev, en, data);
+        if ((res != TCS34725_OK) || data->valid ||
+            ((again == dev->again) && (atime == dev->p.atime))) {
+            break;
+        }
+    }
+
+    /* restore the previous state, which powers a sensor in standby down */
+    i2c_acquire(BUS);
+    if (i2c_write_reg(BUS, ADR, TCS34725_ENABLE, en, 0) < 0) {
+        res = TCS34725_NOBUS;
+    }
+    i2c_release(BUS);
+
+    return res;
+}
+
+int tcs34725_set_wait(const tcs34725_t *dev, uint32_t wtime)
+{
+    uint8_t en;
+    uint8_t cfg = 0;
+
+    assert(dev && (wtime <= TCS34725_WTIME_LONG_MAX));
+
+    if (wtime > TCS34725_WTIME_MAX) {
+        cfg = TCS34725_CONFIG_WLONG;
+        wtime /= 12;
+    }
+
+    i2c_acquire(BUS);
+    if (i2c_read_reg(BUS, ADR, TCS34725_ENABLE, &en, 0) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    if (wtime < TCS34725_ATIME_MIN) {
+        en &= ~TCS34725_ENABLE_WEN;
+    }
+    else {
+        i2c_write_reg(BUS, ADR, TCS34725_WTIME,
+                      TCS34725_WTIME_TO_REG(wtime), 0);
+        i2c_write_reg(BUS, ADR, TCS34725_CONFIG, cfg, 0);
+        en |= TCS34725_ENABLE_WEN;
+    }
+    if (i2c_write_reg(BUS, ADR, TCS34725_ENABLE, en, 0) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    i2c_release(BUS);
+
+    return TCS34725_OK;
+}
+
+int tcs34725_set_threshold(tcs34725_t *dev, uint16_t low, uint16_t high,
+                           uint8_t pers)
+{
+    assert(dev && (low <= high));
+
+    dev->int_low = low;
+    dev->int_high = high;
+
+    i2c_acquire(BUS);
+    if (tcs34725_write_int_counts(dev) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    if (i2c_write_reg(BUS, ADR, TCS34725_PERS,
+                      (pers & TCS34725_PERS_APERS_MASK), 0) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    i2c_release(BUS);
+
+    return TCS34725_OK;
+}
+
+int tcs34725_enable_int(const tcs34725_t *dev, gpio_cb_t cb, void *arg)
+{
+    uint8_t reg;
+
+    assert(dev);
+
+    i2c_acquire(BUS);
+    /* drop a stale interrupt so the first edge belongs to the new window */
+    if ((i2c_write_byte(BUS, ADR, TCS34725_SF_CICLR, 0) < 0) ||
+        (i2c_read_reg(BUS, ADR, TCS34725_ENABLE, &reg, 0) < 0)) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    reg |= TCS34725_ENABLE_AIEN;
+    if (i2c_write_reg(BUS, ADR, TCS34725_ENABLE, reg, 0) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    i2c_release(BUS);
+
+    if (dev->p.int_pin != GPIO_UNDEF && cb) {
+        gpio_init_int(dev->p.int_pin, GPIO_IN_PU, GPIO_FALLING, cb, arg);
+        gpio_irq_enable(dev->p.int_pin);
+    }
+
+    return TCS34725_OK;
+}
+
+int tcs34725_disable_int(const tcs34725_t *dev)
+{
+    uint8_t reg;
+
+    assert(dev);
+
+    if (dev->p.int_pin != GPIO_UNDEF) {
+        gpio_irq_disable(dev->p.int_pin);
+    }
+
+    i2c_acquire(BUS);
+    if (i2c_read_reg(BUS, ADR, TCS34725_ENABLE, &reg, 0) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    reg &= ~TCS34725_ENABLE_AIEN;
+    if ((i2c_write_reg(BUS, ADR, TCS34725_ENABLE, reg, 0) < 0) ||
+        (i2c_write_byte(BUS, ADR, TCS34725_SF_CICLR, 0) < 0)) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    i2c_release(BUS);
+
+    return TCS34725_OK;
+}
+
+int tcs34725_clear_int(const tcs34725_t *dev)
+{
+    int res;
+
+    assert(dev);
+
+    i2c_acquire(BUS);
+    res = i2c_write_byte(BUS, ADR, TCS34725_SF_CICLR, 0);
+    i2c_release(BUS);
+
+    return (res < 0) ? TCS34725_NOBUS : TCS34725_OK;
 }
@@ -18,16 +18,25 @@
  * @}
  */
 
+#include <errno.h>
 #include <string.h>
 
 #include "saul.h"
 #include "tcs34725.h"
 
+/* a read updates the range of the device, the SAUL signature is const */
+static inline tcs34725_t *_dev(const void *dev)
+{
+    return (tcs34725_t *)dev;
+}
+
 static int read(const void *dev, phydat_t *res)
 {
     tcs34725_data_t val;
 
-    tcs34725_read((const tcs34725_t *)dev, &val);
+    if (tcs34725_read(_dev(dev), &val) != TCS34725_OK) {
+        return -ECANCELED;
+    }
 
     res->val[0] = (int16_t)val.red;
     res->val[1] = (int16_t)val.green;
@@ -38,8 +47,34 @@ static int read(const void *dev, phydat_t *res)
     return 3;
 }
 
+static int read_light(const void *dev, phydat_t *res)
+{
+    tcs34725_data_t val;
+
+    if (tcs34725_read_oneshot(_dev(dev), &val) != TCS34725_OK) {
+        return -ECANCELED;
+    }
+
+    /* deci-lux, daylight exceeds the 16 bit range */
+    res->scale = -1;
+    while (val.dlux > INT16_MAX) {
+        val.dlux /= 10;
+        res->scale++;
+    }
+    res->val[0] = (int16_t)val.dlux;
+    res->unit = UNIT_LUX;
+
+    return 1;
+}
+
 const saul_driver_t tcs34725_saul_driver = {
     .read = read,
     .write = saul_notsup,
     .type = SAUL_SENSE_COLOR,
 };
+
+const saul_driver_t tcs34725_saul_driver_light = {
+    .read = read_light,
+    .write = saul_notsup,
+    .type = SAUL_SENSE_LIGHT,
+};
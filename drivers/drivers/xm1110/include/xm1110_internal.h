@@ -31,6 +31,34 @@ extern "C" {
 // #define XM1110_I2C_ADDRESS              (0x10)
 // #define XM1110_I2C_REG_ADDRESS_R        (0x21)
 // #define XM1110_I2C_REG_ADDRESS_W        (0x20)
+/** @} */
+
+/**
+ * @name PMTK responses
+ * @{
+ */
+#define XM1110_PMTK_ACK                 "$PMTK001,"
+#define XM1110_ACK_RETRIES              (10)
+#define XM1110_ACK_DELAY                (100U)  /**< ms between reads for the response */
+/** @} */
+
+/**
+ * @name PMTK225 interval limits in ms
+ * @{
+ */
+#define XM1110_PERIODIC_MIN             (1000U)
+#define XM1110_PERIODIC_MAX             (518400000U)
+/** @} */
+
+/**
+ * @name PMTK framing and wake up
+ * @{
+ */
+#define XM1110_CMD_MAX                  (80)    /**< "$" body "*XX\r\n" and '\0' */
+#define XM1110_WAKE_BYTE                ('$')   /**< any byte on the bus wakes the module */
+#define XM1110_WAKE_RETRIES             (3)
+#define XM1110_WAKE_DELAY               (300U)  /**< ms until NMEA output resumes */
+/** @} */
 
 
 #ifdef __cplusplus
@@ -10,12 +10,11 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <stdio.h>
-
-#include "debug.h"
+#include <stdbool.h>
 
 #define ENABLE_DEBUG    (0)
 #include "debug.h"
-#include "xtimer.h"
+#include "ztimer.h"
 
 #define BUS         (dev->p.i2c_bus)
 #define ADDR        (dev->p.i2c_addr)
@@ -34,57 +33,253 @@ int xm1110_init(xm1110_t *dev, const xm1110_params_t *params) {
     return XM1110_OK;
 }
 
-void xm1110_set_gps_active(const xm1110_t *dev) {
-    assert(dev);
-    char randomByte = '%';
-    
+static uint8_t _checksum(const char *cmd)
+{
+    uint8_t cs = 0;
+    while (*cmd) {
+        cs ^= (uint8_t)*cmd++;
+    }
+    return cs;
+}
+
+int xm1110_send_command(const xm1110_t *dev, const char *cmd) {
+    assert(dev && cmd);
+    char frame[XM1110_CMD_MAX];
+    int len = snprintf(frame, sizeof(frame), "$%s*%02X\r\n", cmd, _checksum(cmd));
+    if (len < 0 || len >= (int)sizeof(frame)) {
+        return -EINVAL;
+    }
+
     i2c_acquire(BUS);
-    // In theory, any byte can be used to wake up GNSS module (but not working)
-    i2c_write_byte(BUS, ADDR, randomByte, 0);
-    i2c_write_reg(BUS, ADDR, REG_W, randomByte, 0);
+    int res = i2c_write_bytes(BUS, ADDR, frame, len, 0);
     i2c_release(BUS);
 
-    printf("\n(GPS) active.");
+    DEBUG("[xm1110] sent %s", frame);
+    return res;
+}
+
+int xm1110_parse_ack(const char *data, size_t len, xm1110_pmtk_t type) {
+    const size_t hdr = sizeof(XM1110_PMTK_ACK) - 1;
+
+    for (size_t i = 0; i + hdr < len; i++) {
+        if (data[i] != '$' || memcmp(&data[i], XM1110_PMTK_ACK, hdr) != 0) {
+            continue;
+        }
+        /* $PMTK001,<type>,<flag>*<checksum> */
+        size_t pos = i + hdr;
+        unsigned cmd = 0;
+        while (pos < len && data[pos] >= '0' && data[pos] <= '9') {
+            cmd = cmd * 10 + (data[pos++] - '0');
+        }
+        if (cmd == (unsigned)type && pos + 1 < len && data[pos] == ',' &&
+            data[pos + 1] >= '0' && data[pos + 1] <= '3') {
+            return data[pos + 1] - '0';
+        }
+    }
+    return -1;
+}
+
+int xm1110_command(const xm1110_t *dev, xm1110_pmtk_t type, const char *args) {
+    assert(dev);
+    char cmd[XM1110_CMD_MAX];
+    xm1110_data_t buf;
+
+    if (args) {
+        snprintf(cmd, sizeof(cmd), "PMTK%03u,%s", (unsigned)type, args);
+    } else {
+        snprintf(cmd, sizeof(cmd), "PMTK%03u", (unsigned)type);
+    }
+    int res = xm1110_send_command(dev, cmd);
+    if (res != 0) {
+        return res;
+    }
+
+    for (int i = 0; i < XM1110_ACK_RETRIES; i++) {
+        ztimer_sleep(ZTIMER_MSEC, XM1110_ACK_DELAY);
+        xm1110_read(dev, &buf);
+        int flag = xm1110_parse_ack(buf.data, buf.len, type);
+        if (flag >= 0) {
+            DEBUG("[xm1110] PMTK%03u acknowledged: %d\n", (unsigned)type, flag);
+        }
+        switch (flag) {
+            case XM1110_ACK_OK:
+                return XM1110_OK;
+            case XM1110_ACK_INVALID:
+                return -EINVAL;
+            case XM1110_ACK_UNSUPPORTED:
+                return -ENOTSUP;
+            case XM1110_ACK_FAILED:
+                return -EIO;
+        }
+    }
+    DEBUG("[xm1110] no acknowledge for PMTK%03u\n", (unsigned)type);
+    return -ETIMEDOUT;
+}
+
+int xm1110_set_update_rate(const xm1110_t *dev, uint16_t interval_ms) {
+    char args[8];
+    snprintf(args, sizeof(args), "%u", interval_ms);
+    return xm1110_command(dev, XM1110_PMTK_SET_NMEA_UPDATERATE, args);
+}
+
+int xm1110_set_nmea_output(const xm1110_t *dev, uint8_t rmc, uint8_t gga) {
+    char args[48];
+    /* GLL, RMC, VTG, GGA, GSA, GSV, 11 reserved fields, ZDA, MCHN */
+    snprintf(args, sizeof(args), "0,%u,0,%u,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0", rmc, gga);
+    return xm1110_command(dev, XM1110_PMTK_API_SET_NMEA_OUTPUT, args);
+}
+
+int xm1110_set_periodic(const xm1110_t *dev, uint32_t run_ms, uint32_t sleep_ms) {
+    char args[48];
+    if (run_ms < XM1110_PERIODIC_MIN || sleep_ms < XM1110_PERIODIC_MIN ||
+        run_ms > XM1110_PERIODIC_MAX / 3 || sleep_ms > XM1110_PERIODIC_MAX) {
+        return -EINVAL;
+    }
+    /* <mode>,<run>,<sleep>,<second run>,<second sleep> */
+    snprintf(args, sizeof(args), "%u,%lu,%lu,%lu,%lu", XM1110_MODE_PERIODIC,
+             (unsigned long)run_ms, (unsigned long)sleep_ms,
+             (unsigned long)run_ms * 3, (unsigned long)sleep_ms);
+    return xm1110_command(dev, XM1110_PMTK_SET_PERIODIC_MODE, args);
+}
+
+int xm1110_set_alwayslocate(const xm1110_t *dev) {
+    char args[4];
+    snprintf(args, sizeof(args), "%u", XM1110_MODE_ALWAYSLOCATE);
+    return xm1110_command(dev, XM1110_PMTK_SET_PERIODIC_MODE, args);
+}
+
+int xm1110_set_normal(const xm1110_t *dev) {
+    char args[4];
+    snprintf(args, sizeof(args), "%u", XM1110_MODE_NORMAL);
+    return xm1110_command(dev, XM1110_PMTK_SET_PERIODIC_MODE, args);
+}
+
+static int _format_time(char *buf, size_t len, const xm1110_time_t *time) {
+    return snprintf(buf, len, "%u,%u,%u,%u,%u,%u", time->year, time->month,
+                    time->day, time->hour, time->minute, time->second);
+}
+
+static int _format_degrees(char *buf, size_t len, int32_t value) {
+    uint32_t abs = (value < 0) ? -value : value;
+    return snprintf(buf, len, "%s%lu.%05lu,", (value < 0) ? "-" : "",
+                    (unsigned long)(abs / 100000), (unsigned long)(abs % 100000));
+}
+
+int xm1110_set_time(const xm1110_t *dev, const xm1110_time_t *time) {
+    assert(time);
+    char args[32];
+    _format_time(args, sizeof(args), time);
+    return xm1110_command(dev, XM1110_PMTK_DT_UTC, args);
+}
+
+int xm1110_set_ref_position(const xm1110_t *dev, int32_t latitude, int32_t longitude,
+                            int16_t altitude, const xm1110_time_t *time) {
+    assert(time);
+    char args[72];
+    int len = 0;
+    /* <lat>,<lon>,<alt>,<year>,<month>,<day>,<hour>,<minute>,<second> */
+    len += _format_degrees(&args[len], sizeof(args) - len, latitude);
+    len += _format_degrees(&args[len], sizeof(args) - len, longitude);
+    len += snprintf(&args[len], sizeof(args) - len, "%d,", altitude);
+    _format_time(&args[len], sizeof(args) - len, time);
+    return xm1110_command(dev, XM1110_PMTK_DT_POS, args);
+}
+
+int xm1110_get_epo_sets(const xm1110_t *dev) {
+    char cmd[8];
+    char resp[12];
+    xm1110_data_t buf;
+
+    /* the answer is a $PMTK707 data sentence instead of a $PMTK001 */
+    snprintf(cmd, sizeof(cmd), "PMTK%03u", XM1110_PMTK_Q_EPO_INFO);
+    snprintf(resp, sizeof(resp), "$PMTK%03u,", XM1110_PMTK_DT_EPO_INFO);
+    int res = xm1110_send_command(dev, cmd);
+    if (res != 0) {
+        return res;
+    }
+    for (int i = 0; i < XM1110_ACK_RETRIES; i++) {
+        ztimer_sleep(ZTIMER_MSEC, XM1110_ACK_DELAY);
+        xm1110_read(dev, &buf);
+        size_t rlen = strlen(resp);
+        for (size_t j = 0; j + rlen < buf.len; j++) {
+            if (memcmp(&buf.data[j], resp, rlen) == 0) {
+                /* $PMTK707,<sets>,<first week>,... */
+                int sets = 0;
+                for (size_t k = j + rlen; k < buf.len &&
+                     buf.data[k] >= '0' && buf.data[k] <= '9'; k++) {
+                    sets = sets * 10 + (buf.data[k] - '0');
+                }
+                return sets;
+            }
+        }
+    }
+    return -ETIMEDOUT;
+}
+
+static bool _has_nmea(const xm1110_t *dev) {
+    xm1110_data_t buf;
+    xm1110_read(dev, &buf);
+    return memchr(buf.data, '$', buf.len) != NULL;
+}
+
+int xm1110_set_gps_active(const xm1110_t *dev) {
+    assert(dev);
+
+    // Any byte wakes the module, but it only answers once it is running again:
+    // repeat the wake byte until NMEA output can be read back.
+    for (int i = 0; i < XM1110_WAKE_RETRIES; i++) {
+        i2c_acquire(BUS);
+        i2c_write_byte(BUS, ADDR, XM1110_WAKE_BYTE, 0);
+        i2c_release(BUS);
+        ztimer_sleep(ZTIMER_MSEC, XM1110_WAKE_DELAY);
+        if (_has_nmea(dev)) {
+            printf("\n(GPS) active.\n");
+            return XM1110_OK;
+        }
+    }
+    printf("\n(GPS) wake up failed.\n");
+    return -ETIMEDOUT;
 }
 
 void xm1110_set_gps_standby(const xm1110_t *dev) {
     assert(dev);
     // Send the folllowing command to put the GNSS module in standby
-    char standby_command[21] = "$PMTK161,0*28\r\n";
-
-    i2c_acquire(BUS);
-    for(int i = 0; i<21; i++) {
-        i2c_write_byte(BUS, ADDR, standby_command[i], 0);
+    if (xm1110_command(dev, XM1110_PMTK_CMD_STANDBY, "0") != XM1110_OK) {
+        printf("\n(GPS) standby not acknowledged.\n");
+        return;
     }
-    i2c_release(BUS);
     printf("\n(GPS) standby.\n");
 }
 
 void xm1110_glp_mode(const xm1110_t *dev) {
     assert(dev);
     // Send the folllowing command to put the GNSS module in GLP mode (GNSS Low Power)
-    char glp_command[21] = "$PMTK262,3*2B\r\n";
-
-    i2c_acquire(BUS);
-    // i2c_write_regs(BUS, ADDR, REG_W, &glp_command, 21, 0);
-    for(int i = 0; i<21; i++) {
-        i2c_write_byte(BUS, ADDR, glp_command[i], 0);
+    if (xm1110_command(dev, XM1110_PMTK_SET_GLP, "3") != XM1110_OK) {
+        printf("\n(GPS) GLP not acknowledged.\n");
+        return;
     }
-    i2c_release(BUS);
-
     printf("\n(GPS) GLP activated.\n");
 }
 
 int xm1110_read(const xm1110_t *dev, xm1110_data_t *xmdata) {
 
     assert(dev && xmdata);
-    int res;
+    int res = 0;
+    size_t i;
     i2c_acquire(BUS);
-    for(int i = 0; i<255; i++) {
+    for(i = 0; i < XM1110_BUFFER_SIZE && res == 0; i++) {
         res = i2c_read_byte(BUS, ADDR, &xmdata->data[i], 0);
     }
     i2c_release(BUS);
 
+    // An empty buffer reads as XM1110_NO_DATA, only the bytes before that
+    // padding are valid (keeping the '\n' that ends the last sentence).
+    xmdata->len = (res == 0) ? i : 0;
+    while (xmdata->len > 0 && xmdata->data[xmdata->len - 1] == XM1110_NO_DATA &&
+           (xmdata->len < 2 || xmdata->data[xmdata->len - 2] != '\r')) {
+        xmdata->len--;
+    }
+
     // check error message
     if( res==-EIO ){
         printf("EIO \n");
@@ -102,5 +297,5 @@ int xm1110_read(const xm1110_t *dev, xm1110_data_t *xmdata) {
         printf("\n\nError int: %d\n", res);
     }
 
-    return 0;
+    return res;
 }
\ No newline at end of file
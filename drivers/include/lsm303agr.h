@@ -191,7 +191,37 @@ int LSM303AGR_read_mag(const LSM303AGR_t *dev, LSM303AGR_3d_data_t *data);
  */
 int LSM303AGR_read_temp(const LSM303AGR_t *dev, int16_t *value);
 
-int LSM303AGR_enable_interrupt(const LSM303AGR_t *dev, int cm);
+/**
+ * @brief   Free fall threshold register value at +-2 g (16 mg per LSB)
+ */
+#define LSM303AGR_FREEFALL_THS(mg)  ((uint8_t)(((mg) + 8) / 16))
+
+/**
+ * @brief   Enable free fall detection on INT1
+ *
+ * A free fall is reported when all axes stay below @p ths for @p dur samples
+ * (10 Hz).
+ *
+ * @param[in] dev       device descriptor of an LSM303AGR device
+ * @param[in] ths       threshold, see LSM303AGR_FREEFALL_THS (max 0x7F)
+ * @param[in] dur       minimum duration in samples (max 0x7F)
+ *
+ * @return              0 on success
+ * @return              -1 on error
+ */
+int LSM303AGR_enable_interrupt(const LSM303AGR_t *dev, uint8_t ths, uint8_t dur);
+
+/**
+ * @brief   Change the free fall threshold and duration
+ *
+ * @param[in] dev       device descriptor of an LSM303AGR device
+ * @param[in] ths       threshold, see LSM303AGR_FREEFALL_THS (max 0x7F)
+ * @param[in] dur       minimum duration in samples (max 0x7F)
+ *
+ * @return              0 on success
+ * @return              -1 on error
+ */
+int LSM303AGR_set_freefall(const LSM303AGR_t *dev, uint8_t ths, uint8_t dur);
 int LSM303AGR_clear_int(const LSM303AGR_t *dev, int8_t *value);
 
 /**
@@ -22,6 +22,16 @@ extern "C" {
 /** possible I2C slave addresses */
 #define SHT3X_I2C_ADDR_1    (0x44)  /**< ADDR pin connected to GND/VSS */
 #define SHT3X_I2C_ADDR_2    (0x45)  /**< ADDR pin connected to VDD */
+/**
+ * @brief   Age in ms up to which the SAUL driver hands out a measurement again
+ *
+ * Temperature and humidity are read by separate SAUL calls. Both are taken
+ * from the same measurement while it is younger than this, the first call
+ * after that measures again. 0 measures on every call.
+ */
+#ifndef SHT3X_SAUL_TTL_MS
+#define SHT3X_SAUL_TTL_MS   (2000U)
+#endif
 /**
  * @brief   Driver error codes (returned as negative values)
  */
@@ -84,9 +94,13 @@ typedef struct {
     sht3x_mode_t    mode;            /**< measurement mode used    */
     sht3x_repeat_t  repeat;          /**< repeatability level used */
     bool            meas_started;    /**< indicates whether measurement is started */
-    uint32_t        meas_start_time; /**< start time of current measurement in us */
-    uint32_t        meas_duration;   /**< time in us until the results of the
+    uint32_t        meas_start_time; /**< start time of current measurement in ms */
+    uint32_t        meas_duration;   /**< time in ms until the results of the
                                           current measurement become available */
+    bool            saul_valid;      /**< SAUL: temp and hum hold a measurement */
+    uint32_t        saul_time;       /**< SAUL: time of that measurement in ms */
+    int16_t         temp;            /**< SAUL: temperature of the last measurement */
+    int16_t         hum;             /**< SAUL: humidity of the last measurement */
 } sht3x_dev_t;
 /**
  * @brief	Initialize the SHT3x sensor device
@@ -141,6 +155,20 @@ int sht3x_init (sht3x_dev_t *dev, const sht3x_params_t *params);
  * @return  0 on success or negative error code, see #sht3x_error_codes
  */
 int sht3x_read (sht3x_dev_t* dev, int16_t* temp, int16_t* hum);
+/**
+ * @brief   Alert limit word for a humidity and temperature
+ *
+ * The 7 most significant bits of the raw humidity followed by the 9 most
+ * significant bits of the raw temperature, as written with
+ * ::sht3x_alertmode_write.
+ *
+ * @param[in]   hum     Relative Humidity in hundredths of a percent
+ * @param[in]   temp    Temperature in hundredths of a degree Celsius
+ */
+#define SHT3X_LIMIT(hum, temp) \
+    ((uint16_t)((((uint32_t)(hum) * 65535U / 10000U) & 0xFE00U) | \
+                (((uint32_t)((temp) + 4500) * 65535U / 17500U) >> 7)))
+
 int sht3x_alertmode_read(sht3x_dev_t* dev, uint8_t* result, int limit);
 int sht3x_alertmode_write(sht3x_dev_t* dev, int limit, uint16_t data, uint8_t crc);
 #ifdef __cplusplus
@@ -28,8 +28,10 @@
 #define TCS34725_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "periph/i2c.h"
+#include "periph/gpio.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -53,7 +55,9 @@ typedef struct {
     uint32_t blue;          /**< IR compensated channels blue */
     uint32_t clear;         /**< channels clear */
     uint32_t lux;           /**< Lux */
+    uint32_t dlux;          /**< Lux in 0.1 lux steps */
     uint32_t ct;            /**< Color temperature */
+    bool valid;             /**< neither saturated nor underexposed */
 } tcs34725_data_t;
 
 /**
@@ -63,14 +67,48 @@ typedef struct {
     i2c_t i2c;              /**< I2C bus the sensor is connected to */
     uint8_t addr;           /**< the sensors address on the I2C bus */
     uint32_t atime;         /**< conversion time in microseconds */
+    gpio_t int_pin;         /**< INT pin (open drain, active low), may be
+                                 GPIO_UNDEF */
 } tcs34725_params_t;
 
+/**
+ * @brief   Per device calibration record
+ *
+ * Gains and the glass attenuation factor are fixed-point values with
+ * TCS34725_CALIB_ONE representing 1.0. The lux and CT coefficients follow
+ * the DN40 integer format (multiplied by 1000).
+ */
+typedef struct {
+    uint16_t ga;            /**< glass attenuation factor */
+    uint16_t gain[4];       /**< clear, red, green, blue channel gain */
+    uint16_t dark[4];       /**< clear, red, green, blue dark offset in counts */
+    int16_t dgf;            /**< device and glass factor */
+    int16_t r_coef;         /**< red lux coefficient */
+    int16_t g_coef;         /**< green lux coefficient */
+    int16_t b_coef;         /**< blue lux coefficient */
+    int16_t ct_coef;        /**< color temperature coefficient */
+    int16_t ct_offset;      /**< color temperature offset */
+} tcs34725_calib_t;
+
+/**
+ * @brief   Fixed-point representation of 1.0 in ::tcs34725_calib_t
+ */
+#define TCS34725_CALIB_SHIFT    (10)
+#define TCS34725_CALIB_ONE      (1 << TCS34725_CALIB_SHIFT)
+
 /**
  * @brief   Device descriptor for TCS34725 sensors
  */
 typedef struct {
     tcs34725_params_t p;    /**< device configuration */
     int again;              /**< amount of gain */
+    tcs34725_calib_t calib; /**< calibration record */
+    int32_t dgf_ga;         /**< DGF including glass attenuation */
+    uint32_t cpl_recip;     /**< 1/CPL for current gain and atime, fixed-point */
+    uint32_t sat_count;     /**< clear count treated as saturated */
+    uint16_t int_low;       /**< interrupt thresholds at the initial range */
+    uint16_t int_high;      /**< 0 while no threshold is set */
+    uint32_t int_sens;      /**< gain x cycles of the initial range */
 } tcs34725_t;
 
 /**
@@ -79,19 +117,20 @@ typedef struct {
 enum {
     TCS34725_OK     =  0,   /**< everything worked as expected */
     TCS34725_NOBUS  = -1,   /**< access to the configured I2C bus failed */
-    TCS34725_NODEV  = -2    /**< no TCS34725 device found on the bus */
+    TCS34725_NODEV  = -2,   /**< no TCS34725 device found on the bus */
+    TCS34725_NODATA = -3    /**< no completed integration cycle available */
 };
 
 /**
  * @brief   Initialize the given TCS34725 sensor
  *
  * The sensor is initialized in RGBC only mode with proximity detection turned
- * off.
+ * off. Periodic RGBC measurements are enabled, call
+ * ::tcs34725_set_rgbc_standby to power the sensor down and use
+ * ::tcs34725_read_oneshot for sporadic measurements.
  *
- * The gain will be initially set to 4x, but it will be adjusted
- *
- * The gain value will be initially set to 4x, but it will be automatically
- * adjusted during runtime.
+ * The gain value will be initially set to 4x, but gain and integration time
+ * will be automatically adjusted during runtime.
  *
  * @param[out] dev          device descriptor of sensor to initialize
  * @param[in]  params       static configuration parameters
@@ -102,6 +141,18 @@ enum {
  */
 int tcs34725_init(tcs34725_t *dev, const tcs34725_params_t *params);
 
+/**
+ * @brief   Apply a calibration record
+ *
+ * Intended to be called once after ::tcs34725_init, which loads the DN40
+ * defaults. Derived multipliers are computed here, so calibrated reads
+ * need no additional divisions.
+ *
+ * @param[out] dev          device descriptor of sensor
+ * @param[in]  calib        calibration record, ga and dgf MUST not be 0
+ */
+void tcs34725_set_calib(tcs34725_t *dev, const tcs34725_calib_t *calib);
+
 /**
  * @brief   Set RGBC enable, this activates periodic RGBC measurements.
  *
@@ -121,14 +172,118 @@ void tcs34725_set_rgbc_standby(const tcs34725_t *dev);
 /**
  * @brief   Read sensor's data
  *
- * Besides an Autogain routine is called. If a maximum or minimum threshold
- * value of the channel clear is reached, then the gain will be changed
- * correspond to max or min threshold.
+ * Besides an auto-range routine is called. If the clear channel is saturated
+ * or below TCS34725_AG_THRESHOLD_LOW, the reading is marked invalid and gain
+ * and integration time for the next reading are picked from a lookup table
+ * of saturation limits, so the next reading is in range. A saturated reading
+ * steps down only as far as its count stays clear of the dark limit. On a
+ * change of range, the interrupt thresholds are rewritten for the new range.
  *
- * @param[in]  dev         device descriptor of sensor
+ * The data is only read when the AVALID status flag signals a completed
+ * integration cycle.
+ *
+ * @param[in,out] dev      device descriptor of sensor, takes the new range
+ * @param[out] data        device sensor data, MUST not be NULL
+ *
+ * @return                  TCS34725_OK on success
+ * @return                  TCS34725_NOBUS if the I2C transfer fails
+ * @return                  TCS34725_NODATA if no integration cycle completed
+ */
+int tcs34725_read(tcs34725_t *dev, tcs34725_data_t *data);
+
+/**
+ * @brief   Perform a single measurement and return to the previous state
+ *
+ * The sensor is powered on if necessary, a new integration cycle is started
+ * and the calling thread sleeps for one integration time until AVALID is set.
+ * An invalid reading is repeated once with the gain and integration time
+ * chosen by the auto-range routine. Afterwards the enable register is
+ * restored, i.e. a sensor in standby is powered down again.
+ *
+ * @param[in,out] dev      device descriptor of sensor, takes the new range
  * @param[out] data        device sensor data, MUST not be NULL
+ *
+ * @return                  TCS34725_OK on success
+ * @return                  TCS34725_NOBUS if the I2C transfer fails
+ * @return                  TCS34725_NODATA if no integration cycle completed
+ */
+int tcs34725_read_oneshot(tcs34725_t *dev, tcs34725_data_t *data);
+
+/**
+ * @brief   Set the wait time between periodic RGBC measurements
+ *
+ * The sensor idles in the low power wait state between integration cycles,
+ * which reduces the average current in periodic and interrupt modes. Wait
+ * times above 614 ms use the WLONG multiplier and are limited to 7.4 s.
+ *
+ * @param[in]  dev          device descriptor of sensor
+ * @param[in]  wtime        wait time in microseconds, 0 disables waiting
+ *
+ * @return                  TCS34725_OK on success
+ * @return                  TCS34725_NOBUS if the I2C transfer fails
+ */
+int tcs34725_set_wait(const tcs34725_t *dev, uint32_t wtime);
+
+/**
+ * @brief   Set the clear channel interrupt thresholds
+ *
+ * An interrupt is asserted when the raw clear channel count drops below
+ * @p low or rises above @p high for @p pers consecutive integration cycles.
+ * The thresholds are given in counts at the gain and integration time set by
+ * ::tcs34725_init. They are scaled to the present range and rewritten by the
+ * auto-range routine, so they keep their light level.
+ * @p pers is the APERS field of the persistence register: 0 interrupts on
+ * every cycle, 1..3 after that many cycles and 4..15 after 5, 10, ... 60
+ * cycles (steps of 5).
+ *
+ * @param[in]  dev          device descriptor of sensor
+ * @param[in]  low          low threshold in clear counts at the initial range
+ * @param[in]  high         high threshold in clear counts at the initial range
+ * @param[in]  pers         persistence filter (APERS field, 0..15)
+ *
+ * @return                  TCS34725_OK on success
+ * @return                  TCS34725_NOBUS if the I2C transfer fails
+ */
+int tcs34725_set_threshold(tcs34725_t *dev, uint16_t low, uint16_t high,
+                           uint8_t pers);
+
+/**
+ * @brief   Enable the clear channel interrupt
+ *
+ * Any pending interrupt is cleared first. If the INT pin is configured, it is
+ * set up as falling edge interrupt calling @p cb in interrupt context.
+ *
+ * The INT line stays asserted until ::tcs34725_clear_int is called, so no
+ * further edges are seen while the light condition persists.
+ *
+ * @param[in]  dev          device descriptor of sensor
+ * @param[in]  cb           callback on INT assertion, may be NULL
+ * @param[in]  arg          argument passed to @p cb
+ *
+ * @return                  TCS34725_OK on success
+ * @return                  TCS34725_NOBUS if the I2C transfer fails
+ */
+int tcs34725_enable_int(const tcs34725_t *dev, gpio_cb_t cb, void *arg);
+
+/**
+ * @brief   Disable the clear channel interrupt
+ *
+ * @param[in]  dev          device descriptor of sensor
+ *
+ * @return                  TCS34725_OK on success
+ * @return                  TCS34725_NOBUS if the I2C transfer fails
+ */
+int tcs34725_disable_int(const tcs34725_t *dev);
+
+/**
+ * @brief   Clear a pending clear channel interrupt and release the INT line
+ *
+ * @param[in]  dev          device descriptor of sensor
+ *
+ * @return                  TCS34725_OK on success
+ * @return                  TCS34725_NOBUS if the I2C transfer fails
  */
-void tcs34725_read(const tcs34725_t *dev, tcs34725_data_t *data);
+int tcs34725_clear_int(const tcs34725_t *dev);
 
 #ifdef __cplusplus
 }
@@ -2,6 +2,7 @@
 #define XM1110_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include "periph/i2c.h"
 #include "periph/uart.h"
@@ -35,10 +36,70 @@ extern "C"
 #define XM1110_NO_DATA          0x0A    /**< Value when I2C buffer has no data */
 #endif
 
+#ifndef XM1110_BUFFER_SIZE
+#define XM1110_BUFFER_SIZE      255     /**< I2C output buffer of the module */
+#endif
+
+/**
+ * @brief   Caller owned read buffer
+ *
+ * Only the first @p len bytes are valid. The data is not NUL terminated and
+ * may end in the middle of a sentence.
+ */
 typedef struct {
-    char data[255];
+    char data[XM1110_BUFFER_SIZE];
+    size_t len;                 /**< number of valid bytes in data */
 } xm1110_data_t;
 
+/**
+ * @brief   Result flag of a $PMTK001 acknowledge
+ */
+typedef enum {
+    XM1110_ACK_INVALID = 0,     /**< invalid command */
+    XM1110_ACK_UNSUPPORTED = 1, /**< unsupported command */
+    XM1110_ACK_FAILED = 2,      /**< valid command, but action failed */
+    XM1110_ACK_OK = 3,          /**< valid command, action succeeded */
+} xm1110_ack_t;
+
+/**
+ * @brief   Power modes of PMTK225
+ *
+ * Only the standby variants are used: in backup mode the module can only be
+ * woken through its FORCE_ON pin, not over I2C.
+ */
+typedef enum {
+    XM1110_MODE_NORMAL = 0,         /**< continuous tracking */
+    XM1110_MODE_PERIODIC = 2,       /**< periodic run / standby */
+    XM1110_MODE_ALWAYSLOCATE = 8,   /**< AlwaysLocate with standby */
+} xm1110_power_mode_t;
+
+/**
+ * @brief   PMTK command types
+ */
+typedef enum {
+    XM1110_PMTK_CMD_STANDBY = 161,
+    XM1110_PMTK_SET_NMEA_UPDATERATE = 220,
+    XM1110_PMTK_SET_PERIODIC_MODE = 225,
+    XM1110_PMTK_SET_GLP = 262,
+    XM1110_PMTK_API_SET_NMEA_OUTPUT = 314,
+    XM1110_PMTK_Q_EPO_INFO = 607,
+    XM1110_PMTK_DT_EPO_INFO = 707,
+    XM1110_PMTK_DT_UTC = 740,
+    XM1110_PMTK_DT_POS = 741,
+} xm1110_pmtk_t;
+
+/**
+ * @brief   UTC date and time for assisted start
+ */
+typedef struct {
+    uint16_t year;          /**< e.g. 2019 */
+    uint8_t month;          /**< 1 - 12 */
+    uint8_t day;            /**< 1 - 31 */
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+} xm1110_time_t;
+
 typedef struct {
     i2c_t i2c_bus;              /**< I2C bus the sensor is connected to     */
     uint8_t i2c_addr;           /**< slave address */
@@ -56,14 +117,113 @@ typedef struct {
 
 int xm1110_init(xm1110_t *dev, const xm1110_params_t *params);
 
-void xm1110_set_gps_active(const xm1110_t *dev);
+/**
+ * @brief   Wake the module from standby and check that it outputs NMEA again
+ *
+ * @return  XM1110_OK, or -ETIMEDOUT if no NMEA data was read back
+ */
+int xm1110_set_gps_active(const xm1110_t *dev);
 
 void xm1110_set_gps_standby(const xm1110_t *dev);
 
 void xm1110_glp_mode(const xm1110_t *dev);
 
+/**
+ * @brief   Read the module's output buffer
+ *
+ * @return  0 on success, the I2C error otherwise (xmdata->len is then 0)
+ */
 int xm1110_read(const xm1110_t *dev, xm1110_data_t *xmdata);
 
+/**
+ * @brief   Send a PMTK command, framed as "$<cmd>*<checksum>\r\n"
+ *
+ * @param[in] cmd   command without '$' and checksum, e.g. "PMTK161,0"
+ */
+int xm1110_send_command(const xm1110_t *dev, const char *cmd);
+
+/**
+ * @brief   Send PMTK command @p type with arguments and wait for its $PMTK001
+ *
+ * @param[in] args  comma separated arguments, NULL if there are none
+ *
+ * @return  XM1110_OK if acknowledged with XM1110_ACK_OK
+ * @return  -EINVAL, -ENOTSUP or -EIO if acknowledged as invalid, unsupported
+ *          or failed
+ * @return  -ETIMEDOUT if no acknowledge was read back
+ * @return  the I2C error if the command could not be written
+ */
+int xm1110_command(const xm1110_t *dev, xm1110_pmtk_t type, const char *args);
+
+/**
+ * @brief   Find the $PMTK001 acknowledge of command @p type in read data
+ *
+ * @return  the xm1110_ack_t flag, or -1 if there is none
+ */
+int xm1110_parse_ack(const char *data, size_t len, xm1110_pmtk_t type);
+
+/**
+ * @brief   Set the NMEA output interval (PMTK220), 100 ms to 10 s
+ */
+int xm1110_set_update_rate(const xm1110_t *dev, uint16_t interval_ms);
+
+/**
+ * @brief   Select the NMEA sentences to output (PMTK314)
+ *
+ * @param[in] rmc   output RMC every @p rmc fixes, 0 to disable
+ * @param[in] gga   output GGA every @p gga fixes, 0 to disable
+ */
+int xm1110_set_nmea_output(const xm1110_t *dev, uint8_t rmc, uint8_t gga);
+
+/**
+ * @brief   Enter periodic mode (PMTK225,2)
+ *
+ * The module tracks for @p run_ms and then stays in standby for @p sleep_ms.
+ * When no fix was obtained in a run, the next run is extended to
+ * 3 * @p run_ms. Run times are 1 s to 518400 s, sleep times 1 s to 518400 s.
+ *
+ * @return  -EINVAL for times out of range, as xm1110_command() otherwise
+ */
+int xm1110_set_periodic(const xm1110_t *dev, uint32_t run_ms, uint32_t sleep_ms);
+
+/**
+ * @brief   Enter AlwaysLocate mode (PMTK225,8)
+ *
+ * The module adapts its run / standby cycle to its own motion.
+ */
+int xm1110_set_alwayslocate(const xm1110_t *dev);
+
+/**
+ * @brief   Back to continuous tracking (PMTK225,0)
+ */
+int xm1110_set_normal(const xm1110_t *dev);
+
+/**
+ * @brief   Inject the current UTC time (PMTK740)
+ */
+int xm1110_set_time(const xm1110_t *dev, const xm1110_time_t *time);
+
+/**
+ * @brief   Inject a reference position and the current UTC time (PMTK741)
+ *
+ * Together with PMTK740 this lets the module predict the visible satellites
+ * instead of searching for them, which shortens the time to first fix.
+ *
+ * @param[in] latitude      degrees * 100000, north positive
+ * @param[in] longitude     degrees * 100000, east positive
+ * @param[in] altitude      meters above mean sea level
+ */
+int xm1110_set_ref_position(const xm1110_t *dev, int32_t latitude, int32_t longitude,
+                            int16_t altitude, const xm1110_time_t *time);
+
+/**
+ * @brief   Query the number of valid EPO (extended ephemeris) sets (PMTK607)
+ *
+ * @return  number of sets, -ETIMEDOUT if no answer was read back, or the I2C
+ *          error if the query could not be written
+ */
+int xm1110_get_epo_sets(const xm1110_t *dev);
+
 #ifdef __cplusplus
 }
 #endif
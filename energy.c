@@ -0,0 +1,94 @@
+#include "energy.h"
+
+#include <stdio.h>
+
+#include "irq.h"
+
+#include "timebase.h"
+
+static const char* const _names[ENERGY_PART_NUMOF] = { "mcu", "modem", "gps", "sensors" };
+static uint32_t _ua[ENERGY_PART_NUMOF];         /* present current per part */
+static uint64_t _charge[ENERGY_PART_NUMOF];     /* uA * ms since energy_init() */
+static uint64_t _elapsed;                       /* ms since energy_init() */
+static uint32_t _last;
+
+//integrate the present currents up to now
+static void _update(void)
+{
+    uint32_t now = time_now_ms();
+    uint32_t dt = now - _last;
+    _last = now;
+    _elapsed += dt;
+    for (int i = 0; i < ENERGY_PART_NUMOF; i++) {
+        _charge[i] += (uint64_t)_ua[i] * dt;
+    }
+}
+
+void energy_init(void)
+{
+    _last = time_now_ms();
+    _elapsed = 0;
+    _ua[ENERGY_MCU] = ENERGY_MCU_RUN_UA;
+    _ua[ENERGY_MODEM] = ENERGY_MODEM_IDLE_UA;
+    _ua[ENERGY_GPS] = ENERGY_GPS_STANDBY_UA;
+    _ua[ENERGY_SENSORS] = ENERGY_SENSORS_UA;
+    for (int i = 0; i < ENERGY_PART_NUMOF; i++) {
+        _charge[i] = 0;
+    }
+}
+
+void energy_set(energy_part_t part, uint32_t ua)
+{
+    unsigned state = irq_disable();
+    _update();
+    _ua[part] = ua;
+    irq_restore(state);
+}
+
+void energy_add(energy_part_t part, uint64_t ua_ms)
+{
+    unsigned state = irq_disable();
+    _charge[part] += ua_ms;
+    irq_restore(state);
+}
+
+//charge per part in uA * ms since energy_init(), returns the ms since then
+uint64_t energy_charge(uint64_t* charge)
+{
+    unsigned state = irq_disable();
+    _update();
+    uint64_t elapsed = _elapsed;
+    for (int i = 0; i < ENERGY_PART_NUMOF; i++) {
+        charge[i] = _charge[i];
+    }
+    irq_restore(state);
+    return elapsed;
+}
+
+//average current per part and in total, charge per day and battery life
+void energy_print(void)
+{
+    uint64_t charge[ENERGY_PART_NUMOF];
+    uint64_t total = 0;
+    uint64_t elapsed = energy_charge(charge);
+
+    if (elapsed == 0) {
+        return;
+    }
+    printf("Charge over %lu s:", (unsigned long)(elapsed / 1000));
+    for (int i = 0; i < ENERGY_PART_NUMOF; i++) {
+        uint32_t na = (charge[i] * 1000) / elapsed;
+        printf(" %s %lu.%lu uA", _names[i], (unsigned long)(na / 1000),
+               (unsigned long)((na % 1000) / 100));
+        total += charge[i];
+    }
+    uint32_t na = (total * 1000) / elapsed;
+    uint32_t uah_day = ((uint64_t)na * 24) / 1000;
+    printf(", %lu.%03lu mAh/day", (unsigned long)(uah_day / 1000),
+           (unsigned long)(uah_day % 1000));
+    if (na) {
+        printf(", battery life %lu days",
+               (unsigned long)(((uint64_t)ENERGY_BATTERY_MAH * 1000000) / ((uint64_t)na * 24)));
+    }
+    printf("\n");
+}
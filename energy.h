@@ -0,0 +1,36 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ * Charge estimate.
+ *
+ * Each part below draws a constant current in its present state (ENERGY_*_UA
+ * in config.h). The code that changes the state reports the new current with
+ * energy_set(). Short bursts that are not worth a state, like the modem
+ * transmitting, are added as a charge with energy_add(). Charges are in
+ * uA * ms, integrated over time_now_ms().
+ *
+ * energy_print() shows the average current per part, the charge per day and
+ * the projected battery life. energy_charge() hands out the charge per part
+ * and the time it was integrated over. With VIRTUAL_TIME on the native
+ * board, a month of operation is estimated in seconds (see tests/sim_battery).
+ */
+typedef enum {
+    ENERGY_MCU,         /**< run, sleep or STOP2, set by power.c */
+    ENERGY_MODEM,       /**< idle or uplink in flight */
+    ENERGY_GPS,         /**< standby or fix attempt */
+    ENERGY_SENSORS,     /**< constant */
+    ENERGY_PART_NUMOF
+} energy_part_t;
+
+void energy_init(void);
+void energy_set(energy_part_t part, uint32_t ua);
+void energy_add(energy_part_t part, uint64_t ua_ms);
+uint64_t energy_charge(uint64_t* charge);
+void energy_print(void);
+
+#endif
@@ -8,57 +8,115 @@ An unsolicited message will be transmitted periodically using the DASH7 interfac
 #include <stdlib.h>
 
 #include "keys.h"
+#include "config.h"
+#include "settings.h"
+#include "power.h"
+#include "timebase.h"
+#include "energy.h"
 
 #include "thread.h"
+#include "msg.h"
 #include "shell.h"
 #include "shell_commands.h"
-#include "xtimer.h"
 #include "errors.h"
 
 #include "xm1110.h"
 #include "xm1110_params.h"
-#include "minmea.h"
 
 #include "tcs34725.h"
 #include "tcs34725_params.h"
 
 #include "sensors/sensor_sht3x.h"
 #include "sensors/sensor_lsm303agr.h"
+#include "sensors/sensor_tcs34725.h"
+#include "sensors/sensor_xm1110.h"
+#include "sensors/sensor_table.h"
 
 #include "modem.h"
-
-#define INTERVAL (20U * US_PER_SEC)
+#include "comm/tx_queue.h"
+#include "comm/link_select.h"
+#include "comm/fingerprint.h"
+#include "comm/sample_log.h"
+#include "comm/command.h"
+#include "periph/pm.h"
+
+#include "mtd.h"
+#ifdef MTD_0
+#define LOG_MTD MTD_0 // file backed flash of the native board
+#else
+#include "mtd_flashpage.h"
+static mtd_dev_t flash_mtd = MTD_FLASHPAGE_INIT_VAL(1);
+#define LOG_MTD (&flash_mtd) // internal flash
+#endif
+
+#define MAIN_QUEUE_SIZE (8)
+#define MSG_TYPE_FALL  (0x7101)
+#define MSG_TYPE_LIGHT (0x7102)
+#define MSG_TYPE_GPS   (0x7103)
+#define MSG_TYPE_CMD   (0x7104)
+#define MSG_TYPE_TICK  (0x7105)
+
+// Uplink payload: flags, temperature, humidity and light level, followed by
+// the position on LoRaWAN, or the room on DASH7 with FINGERPRINT
+#define PAYLOAD_TAIL_OFFSET (6)
+#define PAYLOAD_GPS_LEN     (8)
+#define PAYLOAD_ROOM_LEN    (FINGERPRINT ? 1 : 0)
+#define PAYLOAD_LEN_D7      (PAYLOAD_TAIL_OFFSET + PAYLOAD_ROOM_LEN)
+#define PAYLOAD_LEN_LORAWAN (PAYLOAD_TAIL_OFFSET + PAYLOAD_GPS_LEN)
 
 uint8_t localization = GPS;
-uint8_t data[14];
+uint8_t data[PAYLOAD_LEN_LORAWAN];
 int16_t temp;
 int16_t hum;
 bool tempAlert;
-bool buttonOverride = true;
-uint32_t start;
+bool lightAlert;
+bool buttonOverride = false;
 sht3x_dev_t dev_sht3x;
 LSM303AGR_t lsm;
 tcs34725_t dev_tcs;
 xm1110_t dev_xm1110;
-tcs34725_data_t data_tcs;
 xm1110_data_t xmdata;
-uint8_t payload[8];
-xtimer_ticks32_t last_wakeup;
 uint8_t loopCounter;
+kernel_pid_t main_pid;
+static msg_t main_msg_queue[MAIN_QUEUE_SIZE];
+ztimer_t gps_timer;
+msg_t gps_msg = { .type = MSG_TYPE_GPS };
 
 void on_modem_command_completed_callback(bool with_error)
 {
   printf("modem command completed (success = %i)\n", !with_error);
 }
 
+// Commands from the backend are run by the main thread between two
+// measurement loops, see handleCommand()
+void on_command_file(uint8_t file_id, uint32_t offset, uint32_t size, uint8_t* buffer)
+{
+  if(file_id != CMD_FILE_ID){
+    return;
+  }
+  if(command_post(offset, size, buffer) != 0){
+    printf("Command ignored\n");
+    return;
+  }
+  msg_t msg = { .type = MSG_TYPE_CMD };
+  msg_try_send(&msg, main_pid);
+}
+
 void on_modem_return_file_data_callback(uint8_t file_id, uint32_t offset, uint32_t size, uint8_t* output_buffer)
 {
-  printf("modem return file data file %i offset %li size %li buffer %p\n", file_id, offset, size, output_buffer);
+  printf("modem return file data file %i offset %"PRIu32" size %"PRIu32" buffer %p\n", file_id, offset, size, output_buffer);
+  on_command_file(file_id, offset, size, output_buffer);
 }
 
 void on_modem_write_file_data_callback(uint8_t file_id, uint32_t offset, uint32_t size, uint8_t* output_buffer)
 {
-  printf("modem write file data file %i offset %li size %li buffer %p\n", file_id, offset, size, output_buffer);
+  printf("modem write file data file %i offset %"PRIu32" size %"PRIu32" buffer %p\n", file_id, offset, size, output_buffer);
+#if FINGERPRINT
+  if(file_id == FP_MAP_FILE_ID){
+    fingerprint_write(offset, size, output_buffer);
+  }
+#endif
+  on_command_file(file_id, offset, size, output_buffer);
 }
 
 static d7ap_session_config_t d7_session_config = {
@@ -87,50 +145,21 @@ static lorawan_session_config_abp_t lorawan_session_config = {
 };
 
 
-void readGPS(xm1110_t* dev, xm1110_data_t* xmdata, uint8_t* payload) {
-  // 
-  char* token;
-  struct minmea_sentence_rmc frame;
-
-  uint32_t latitude_int = 0;
-  uint32_t longitude_int = 0;
-
-  int res = 0;
-  // VB: char* test = "$GNRMC,105824.000,A,5110.577055,N,00420.844651,E,0.42,285.58,080119,,,A*73";
-
-  // Read GPS coordinates and store them in payload
-  res = xm1110_read(dev, xmdata);
-  if ( res != 0 ) {
-    printf("GPS result != 0, something failed?");
+// Wakes the GPS for a fix attempt, polled from the main loop until it is back in standby
+void startGPS(void) {
+  if (start_fix_xm1110(&dev_xm1110) == 0) {
+    energy_set(ENERGY_GPS, ENERGY_GPS_FIX_UA);
+    time_set_msg(&gps_timer, GPS_POLL_MS, &gps_msg, main_pid);
   }
+}
 
-  
-  token = strtok (xmdata->data,"\n");
-  while (token != NULL) {
-    char *token2 = (char *) calloc(strlen(token),sizeof(char));
-    strncpy(token2,token,strlen(token)-1); // Split off last character
-
-    switch (minmea_sentence_id(token2, false)) {
-      case MINMEA_SENTENCE_RMC: { //$GNRMC  
-        if (minmea_parse_rmc(&frame, token2)) { // If correct RMC sentence (including checksum)
-          printf("$RMC fixed-point coordinates and speed scaled to three decimal places: (%ld,%ld) %ld\n",
-                  minmea_rescale(&frame.latitude, 100000),
-                  minmea_rescale(&frame.longitude, 100000),
-                  frame.speed.value);
-
-          latitude_int = minmea_rescale(&frame.latitude, 100000);
-          longitude_int = minmea_rescale(&frame.longitude, 100000);
-        }
-      } break;
-
-      default: {
-        //do nothing
-      }
-    }
-    free(token2);
-    
-    token = strtok (NULL, "\n");
-  }
+// Puts the cached fix in the payload (1e-5 degrees), nothing without a fix
+int packGPS(sensor_entry_t* s, uint8_t* data) {
+  const gps_fix_t* fix = get_fix_xm1110();
+  uint8_t* payload = &data[s->offset];
+
+  uint32_t latitude_int = fix->latitude / 10;
+  uint32_t longitude_int = fix->longitude / 10;
 
   payload[0] = (latitude_int & 0xFF000000) >> 24;
   payload[1] = (latitude_int & 0x00FF0000) >> 16;
@@ -142,28 +171,95 @@ void readGPS(xm1110_t* dev, xm1110_data_t* xmdata, uint8_t* payload) {
   payload[6] = (longitude_int & 0x0000FF00) >> 8;
   payload[7] = (longitude_int & 0x000000FF);
 
+  if(fix_age_xm1110() > GPS_FIX_STALE_MS){
+    data[0] = data[0] | 32;
+    printf("GPS fix is stale\n");
+  }
+  return PAYLOAD_GPS_LEN;
+}
 
+#if FINGERPRINT
+// Puts the room matched from the DASH7 gateway RSSI in the payload
+int packRoom(sensor_entry_t* s, uint8_t* data) {
+  data[s->offset] = s->value.val[0];
+  printf("Room: %d\n", data[s->offset]);
+  return PAYLOAD_ROOM_LEN;
 }
+#endif
 
-void readLightSensor(tcs34725_t* dev_tcs, tcs34725_data_t* data_tcs, uint8_t* payload) {
-  tcs34725_read(dev_tcs, data_tcs);
-  //printf("R: %5"PRIu32" G: %5"PRIu32" B: %5"PRIu32" C: %5"PRIu32"\r\n",
-  //    data_tcs->red, data_tcs->green, data_tcs->blue, data_tcs->clear);
-  //printf("CT : %5"PRIu32" Lux: %6"PRIu32" AGAIN: %2d ATIME %"PRIu32"\r\n",
-  //    data_tcs->ct, data_tcs->lux, dev_tcs->again, dev_tcs->p.atime);
-  payload[3] = (data_tcs->lux & 0xFF000000) >> 24;
-  payload[2] = (data_tcs->lux & 0x00FF0000) >> 16;
-  payload[1] = (data_tcs->lux & 0x0000FF00) >> 8;
-  payload[0] = (data_tcs->lux & 0x000000FF);
-
-  if(payload[3] != 0 || payload[2] != 0 || payload[1] != 0){
-    payload[0] = 255;
-  }
-  printf("Total light strength: Lux: %6"PRIu32"\n", data_tcs->lux);
-  printf("Data to sent from light sensor: %d Lux\n", payload[0]);
+// Puts the log-scale light level in the payload
+int packLight(sensor_entry_t* s, uint8_t* data) {
+  uint32_t dlux = s->value.val[0]; // deci-lux, scale -1 or more in daylight
+  for (int i = -1; i < s->value.scale; i++) {
+    dlux *= 10;
+  }
+  data[s->offset] = encode_lux(dlux);
+  printf("Total light strength: Lux: %6"PRIu32".%"PRIu32"\n", dlux / 10, dlux % 10);
+  printf("Data to sent from light sensor: %d (%"PRIu32" dLux)\n", data[s->offset], decode_lux(data[s->offset]));
+
+  // Keep the INT line latched while it stays bright, re-arm once dark again
+  if(dlux < LIGHT_DARK_LUX * 10){
+    tcs34725_clear_int(&dev_tcs);
+  }
+  return 1;
 }
 
+extern const saul_driver_t sht3x_saul_driver_temperature;
+extern const saul_driver_t sht3x_saul_driver_humidity;
+extern const saul_driver_t tcs34725_saul_driver_light;
+
+// Sensors read by the measurement loop, temperature and humidity come from
+// one SHT3x measurement. Light and position are read every send loop and on
+// alerts, the position while on LoRaWAN and, with FINGERPRINT, the room
+// matched from the DASH7 gateway RSSI otherwise. Readings are cached for
+// SENSOR_TTL_MS so a fall right after a period or a shell `saul read` does
+// not measure again; the position is cached by the GPS module itself.
+enum { SENSOR_TEMP, SENSOR_HUM, SENSOR_LIGHT, SENSOR_GPS,
+#if FINGERPRINT
+       SENSOR_ROOM,
+#endif
+       SENSOR_NUMOF };
+sensor_entry_t sensors[SENSOR_NUMOF] = {
+  [SENSOR_TEMP] = {
+    .reg = { .name = "sht3x", .dev = &dev_sht3x, .driver = &sht3x_saul_driver_temperature },
+    .period = 1, .offset = 1, .pack = sensor_pack_int16, .ttl = SENSOR_TTL_MS },
+  [SENSOR_HUM] = {
+    .reg = { .name = "sht3x", .dev = &dev_sht3x, .driver = &sht3x_saul_driver_humidity },
+    .period = 1, .offset = 3, .pack = sensor_pack_int16, .ttl = SENSOR_TTL_MS },
+  [SENSOR_LIGHT] = {
+    .reg = { .name = "tcs34725", .dev = &dev_tcs, .driver = &tcs34725_saul_driver_light },
+    .period = SEND_EVERY, .on_alert = true, .offset = 5, .pack = packLight, .ttl = SENSOR_TTL_MS },
+  [SENSOR_GPS] = {
+    .reg = { .name = "xm1110", .dev = &dev_xm1110, .driver = &xm1110_saul_driver },
+    .period = SEND_EVERY, .on_alert = true, .offset = PAYLOAD_TAIL_OFFSET, .pack = packGPS },
+#if FINGERPRINT
+  [SENSOR_ROOM] = {
+    .reg = { .name = "fingerprint", .dev = NULL, .driver = &fingerprint_saul_driver },
+    .period = SEND_EVERY, .on_alert = true, .offset = PAYLOAD_TAIL_OFFSET, .pack = packRoom },
+#endif
+};
 
+// The cost per byte is compared for the full uplink of each link
+void selectLink(void)
+{
+  if(link_select_choose(PAYLOAD_LEN_D7, PAYLOAD_LEN_LORAWAN) == ALP_ITF_ID_D7ASP){
+    localization = FINGERPRINTING;
+  } else {
+    localization = GPS;
+  }
+}
+
+void on_poll_done(modem_status_t status)
+{
+  if(status == MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
+    printf("Poll packet received\n");
+  } else {
+    printf("Poll packet failed\n");
+  }
+  if(!buttonOverride){
+    selectLink();
+  }
+}
 
 void measurementLoop(int loopCounter){
   // ------------------------------
@@ -173,89 +269,95 @@ void measurementLoop(int loopCounter){
   tempAlert = false;
   printf("entered measurement loop, loopCounter = %d \n",loopCounter);
 
-
+  // DASH7 (indoor, fingerprinting) or LoRaWAN (outdoor, GPS), whichever
+  // costs least per delivered byte, unless overridden with BTN1
+  if(!buttonOverride){
+    selectLink();
+  }
+  // Failed uplinks are retried on the link in use
+  if(localization == GPS){
+    tx_queue_set_link(ALP_ITF_ID_LORAWAN_ABP, &lorawan_session_config);
+  } else {
+    tx_queue_set_link(ALP_ITF_ID_D7ASP, &d7_session_config);
+  }
+  sensors[SENSOR_GPS].disabled = (localization != GPS || settings.gps_policy == GPS_POLICY_OFF);
+#if FINGERPRINT
+  sensors[SENSOR_ROOM].disabled = (localization != FINGERPRINTING);
+#endif
 
   // ------------------------------
-  // Periodic temperature measurement
+  // Periodic measurements
   // ------------------------------
-  read_sht3x(&dev_sht3x, &temp, &hum);
-  data[1] = temp & 0xFF;
-  data[2] = temp >> 8;
-  data[3] = hum & 0xFF;
-  data[4] = hum >> 8;
+  sensors_begin(sensors, SENSOR_NUMOF);
+  sensors_sample(sensors, SENSOR_NUMOF, loopCounter, false, data);
+  temp = sensors[SENSOR_TEMP].value.val[0];
+  hum = sensors[SENSOR_HUM].value.val[0];
+  printf("Temperature [°C]: %d.%d\n"
+         "Relative Humidity [%%]: %d.%d\n",
+         temp / 100, temp % 100, hum / 100, hum % 100);
   if(loopCounter == 255){
     data[0] = data[0] | 0b11;
     printf("FALL ALLERT\n");
   }
-  if(temp / 100 > 29){
+  if(temp >= settings.temp_alert){
     tempAlert = true;
     data[0] = data[0] | 5; 
     printf("TEMP ALERT\n");
   }
-  if(hum / 100 > 29){
+  if(hum >= settings.hum_alert){
     tempAlert = true;
     data[0] = data[0] | 9; 
     printf("HUM ALERT\n");
   }
+  if(lightAlert){
+    data[0] = data[0] | 17;
+    printf("LIGHT ALERT\n");
+  }
+
+  // A fix is needed every send loop while on LoRaWAN, the GPS power mode
+  // follows that and whether the last fixes show movement
+  set_fix_interval_xm1110(&dev_xm1110,
+                          (localization == GPS && settings.gps_policy != GPS_POLICY_OFF) ?
+                          settings.send_every * settings.interval_ms : 0,
+                          get_fix_xm1110()->moving);
+
+  // Start a fix attempt one period before the position is sent, or right away
+  // on a fall so the following uplinks carry a fresh position
+  if(localization == GPS && settings.gps_policy != GPS_POLICY_OFF &&
+     ((loopCounter + 2) % settings.send_every == 0 || loopCounter == 255)){
+    startGPS();
+  }
     
   // ------------------------------
   // Perform Measurements
   // ------------------------------
-  if(loopCounter == 3 || tempAlert || loopCounter == 255){
-    readLightSensor(&dev_tcs, &data_tcs, payload);
-    //add payload to data to send here
-    data[5] = payload[0];
-    if(localization == GPS){
-      readGPS(&dev_xm1110, &xmdata, payload);
-      data[6] = payload[0];
-      data[7] = payload[1];
-      data[8] = payload[2];
-      data[9] = payload[3];
-      data[10] = payload[4];
-      data[11] = payload[5];
-      data[12] = payload[6];
-      data[13] = payload[7];
-    }
+  if(loopCounter == settings.send_every - 1 || tempAlert || loopCounter == 255 || lightAlert){
+    sensors_sample(sensors, SENSOR_NUMOF, loopCounter, true, data);
 
     // ------------------------------
     // Transmit Data
     // ------------------------------
-    if(!buttonOverride){
-      modem_status_t status = modem_send_unsolicited_response(0x40, 0, 1, &data[0], ALP_ITF_ID_D7ASP, &d7_session_config);
-      if(status == MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
-        printf("Poll packet received, using fingerprinting\n");
-        localization = FINGERPRINTING;
-      } else {
-        printf("Poll packet failed, using GPS\n");
-        localization = GPS;
-      }
+    if(!buttonOverride && link_select_probe_due()){
+      tx_queue_probe(&data[0], 1, ALP_ITF_ID_D7ASP, &d7_session_config, on_poll_done);
     }
 
 
+    // Queue the reading, alarms are sent before routine readings
+    bool alarm = (data[0] & 1);
+    uint8_t len = sensors_payload_len(sensors, SENSOR_NUMOF);
     if(localization == GPS){
-      modem_status_t status = modem_send_unsolicited_response(0x40, 0, 14, &data[0], ALP_ITF_ID_LORAWAN_ABP, &lorawan_session_config);
-      uint32_t duration_usec = xtimer_now_usec() - start;
-      printf("Command completed in %li ms\n", duration_usec / 1000);
-      if(status == MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
-        printf("Command completed successfully\n");
-      } else if(status == MODEM_STATUS_COMMAND_COMPLETED_ERROR) {
-        printf("Command completed with error\n");
-      } else if(status == MODEM_STATUS_COMMAND_TIMEOUT) {
-        printf("Command timed out\n");
-      }
+      tx_queue_push(&data[0], len, ALP_ITF_ID_LORAWAN_ABP, &lorawan_session_config, alarm);
     } else {
-      modem_status_t status = modem_send_unsolicited_response(0x40, 0, 6, &data[0], ALP_ITF_ID_D7ASP, &d7_session_config);
-      uint32_t duration_usec = xtimer_now_usec() - start;
-      printf("Command completed in %li ms\n", duration_usec / 1000);
-      if(status == MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
-        printf("Command completed successfully\n");
-      } else if(status == MODEM_STATUS_COMMAND_COMPLETED_ERROR) {
-        printf("Command completed with error\n");
-      } else if(status == MODEM_STATUS_COMMAND_TIMEOUT) {
-        printf("Command timed out\n");
-      }
+      tx_queue_push(&data[0], len, ALP_ITF_ID_D7ASP, &d7_session_config, alarm);
     }
+
+    // One alert uplink per exposure, the latched INT fires again only after
+    // it has been dark
+    lightAlert = false;
   }
+
+  // Send queued and retried uplinks within the duty-cycle budget
+  tx_queue_process();
 }
 
 void cb_lsm303agr(void *arg)
@@ -264,7 +366,19 @@ void cb_lsm303agr(void *arg)
   }
 
   printf("Fall Detected\n");
-  loopCounter = 255;
+  msg_t msg = { .type = MSG_TYPE_FALL };
+  msg_send(&msg, main_pid);
+}
+
+void cb_tcs34725(void *arg)
+{
+  if (arg != NULL) {
+  }
+
+  printf("Light Exposure Detected\n");
+  lightAlert = true;
+  msg_t msg = { .type = MSG_TYPE_LIGHT };
+  msg_send(&msg, main_pid);
 }
 
 void cb_btn1(void *arg)
@@ -272,6 +386,7 @@ void cb_btn1(void *arg)
   if (arg != NULL) {
   }
 
+  buttonOverride = true;
   if(localization == GPS){
     printf("Switching to Fingerprinting\n");
     localization = FINGERPRINTING;
@@ -286,15 +401,103 @@ void Configure_Interrupt_lsm303agr(void) {
   gpio_irq_enable(GPIO_PIN(PORT_B, 13));
 }
 
+void Configure_Interrupt_tcs34725(void) {
+  tcs34725_set_threshold(&dev_tcs, 0, settings.light_threshold, settings.light_persistence);
+  tcs34725_set_wait(&dev_tcs, LIGHT_WAIT_TIME); //mostly idle in the wait state
+  tcs34725_enable_int(&dev_tcs, cb_tcs34725, (void*) 0); //INT from tcs34725
+}
+
 void Configure_Interrupt_btn1(void) {
   gpio_init_int(GPIO_PIN(PORT_G, 0),GPIO_IN,GPIO_RISING, cb_btn1, (void*) 0); 
   gpio_irq_enable(GPIO_PIN(PORT_G, 0));
 }
 
+// Take over new settings between two measurement loops and configure the
+// sensors for them, returns -1 if they are out of range
+int applySettings(const settings_t* s)
+{
+  if(settings_apply(s) != 0){
+    return -1;
+  }
+  LSM303AGR_set_freefall(&lsm, settings.fall_ths, settings.fall_samples);
+  if(tcs34725_params[0].int_pin != GPIO_UNDEF){
+    tcs34725_set_threshold(&dev_tcs, 0, settings.light_threshold, settings.light_persistence);
+  }
+  sensors[SENSOR_LIGHT].period = settings.send_every;
+  sensors[SENSOR_GPS].period = settings.send_every;
+#if FINGERPRINT
+  sensors[SENSOR_ROOM].period = settings.send_every;
+#endif
+  if(loopCounter >= settings.send_every){
+    loopCounter = 0;
+  }
+  return 0;
+}
+
+void handleCommand(void)
+{
+  uint8_t buf[CMD_MAX];
+  command_result_t res;
+  int len = command_take(buf);
+  if(len <= 0){
+    return;
+  }
+  int err = command_run(buf, len, &settings, &res);
+  if(err != 0 || applySettings(&res.settings) != 0){
+    printf("Command rejected (%d)\n", err);
+    return;
+  }
+  printf("Settings: interval %"PRIu32" ms, uplink every %d, alerts %d/%d, fall %d mg/%d, light %d/%d, GPS %d\n",
+         settings.interval_ms, settings.send_every, settings.temp_alert, settings.hum_alert,
+         settings.fall_mg, settings.fall_samples, settings.light_threshold,
+         settings.light_persistence, settings.gps_policy);
+  if(res.flush_log){
+    sample_log_flush();
+  }
+  if(res.reboot){
+    printf("Rebooting\n");
+    pm_reboot();
+  }
+}
+
+void handleMessage(msg_t* msg)
+{
+  switch (msg->type) {
+    case MSG_TYPE_TX_DONE:
+      tx_queue_done(msg);
+      tx_queue_process();
+      break;
+    case MSG_TYPE_FALL:
+      measurementLoop(255);
+      break;
+    case MSG_TYPE_LIGHT:
+      measurementLoop(loopCounter);
+      break;
+    case MSG_TYPE_CMD:
+      handleCommand();
+      break;
+    case MSG_TYPE_GPS:
+      if (poll_fix_xm1110(&dev_xm1110, &xmdata) == 0) {
+        time_set_msg(&gps_timer, GPS_POLL_MS, &gps_msg, main_pid);
+      } else {
+        energy_set(ENERGY_GPS, ENERGY_GPS_STANDBY_UA);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
 int main(void)
 {
   
   printf("+------------Initializing------------+\n");
+  // events from interrupts and the modem TX thread wake up the main loop
+  main_pid = thread_getpid();
+  msg_init_queue(main_msg_queue, MAIN_QUEUE_SIZE);
+  energy_init();
+  power_init(main_pid, MSG_TYPE_TICK);
+
   // ------------------------------
   // Initialize SHT3x
   // Initialize LSM303AGR
@@ -302,7 +505,7 @@ int main(void)
   // Initialize Light Sensor
   // ------------------------------
   init_sht3x(&dev_sht3x); 
-  init_lsm303agr(&lsm, 1);
+  init_lsm303agr(&lsm, settings.fall_ths, settings.fall_samples);
   Configure_Interrupt_lsm303agr();
   Configure_Interrupt_btn1();
   int res;
@@ -313,8 +516,14 @@ int main(void)
   else {
       puts("GPS: Initialization successful\n");
   }
+  init_gps_xm1110(&dev_xm1110); //standby until a fix is needed
   if (tcs34725_init(&dev_tcs, &tcs34725_params[0]) == TCS34725_OK) {
     puts("Light sensor: Initialization succesful\n");
+    if (tcs34725_params[0].int_pin != GPIO_UNDEF) {
+      Configure_Interrupt_tcs34725();
+    } else {
+      tcs34725_set_rgbc_standby(&dev_tcs); //only powered during one-shot reads
+    }
   }
   else {
     puts("Light sensor: Initialization failed\n");
@@ -331,30 +540,46 @@ int main(void)
   };
 
   modem_init(UART_DEV(1), &modem_callbacks);
+  tx_queue_init();
+  link_select_init();
+  // undelivered readings are kept in the last flash sectors
+  sample_log_init(LOG_MTD, LOG_MTD->sector_count - SAMPLE_LOG_SECTORS, SAMPLE_LOG_SECTORS);
 
   uint8_t uid[D7A_FILE_UID_SIZE];
   modem_read_file(D7A_FILE_UID_FILE_ID, 0, D7A_FILE_UID_SIZE, uid);
   printf("modem UID: %02X%02X%02X%02X%02X%02X%02X%02X\n", uid[0], uid[1], uid[2], uid[3], uid[4], uid[5], uid[6], uid[7]);
+  load_calib_tcs34725(&dev_tcs);
+#if FINGERPRINT
+  fingerprint_init();
+#endif
+  sensors_register(sensors, SENSOR_NUMOF);
 
-  last_wakeup = xtimer_now();
   loopCounter = 0;
+  power_wakeup(settings.interval_ms);
   // ------------------------------
   // Main loop
   // ------------------------------
-    
-    
+  // Sleeps until the next period, events (falls, light, finished uplinks)
+  // are handled as they arrive, also while the modem is transmitting. The
+  // MCU may only enter STOP2 while the main thread waits here.
   while(1) {
+    msg_t msg;
+    power_unblock(POWER_MAIN);
+    msg_receive(&msg);
+    power_block(POWER_MAIN);
+    if(msg.type != MSG_TYPE_TICK){
+      handleMessage(&msg);
+      continue;
+    }
     printf("MAIN LOOP\n");
-    last_wakeup = xtimer_now();
-    start = xtimer_now_usec();
+    power_wakeup(settings.interval_ms);
     measurementLoop(loopCounter);
     loopCounter++;
-    if(loopCounter == 4){
+    if(loopCounter >= settings.send_every){
       loopCounter = 0;
+      sensors_print_cache(sensors, SENSOR_NUMOF);
+      energy_print();
     }
-    xtimer_periodic_wakeup(&last_wakeup, INTERVAL);
-    printf("WOKEN UP\n");
-
   }
   return 0;
 }
@@ -0,0 +1,97 @@
+#include "power.h"
+
+#include "irq.h"
+#include "msg.h"
+#ifdef MODULE_PM_LAYERED
+#include "pm_layered.h"
+#endif
+
+#include "timebase.h"
+#include "energy.h"
+
+#define ENABLE_DEBUG (POWER_TRACE)
+#include "debug.h"
+
+static const char* const _names[POWER_USER_NUMOF] = { "main", "modem" };
+static const char* const _modes[] = { "STOP2", "SLEEP" };
+static uint8_t _busy;               /* one bit per user that blocks STOP */
+static kernel_pid_t _pid;
+static msg_t _msg;
+static ztimer_t _timer;
+static uint32_t _end;               /* when the last period was due */
+
+//MCU current for the charge estimate, the main thread runs, otherwise it idles
+static void _account(void)
+{
+    energy_set(ENERGY_MCU, (_busy & (1 << POWER_MAIN)) ? ENERGY_MCU_RUN_UA :
+                           _busy ? ENERGY_MCU_SLEEP_UA : ENERGY_MCU_STOP_UA);
+}
+
+//the end of each period is sent as a message of the given type to pid
+void power_init(kernel_pid_t pid, uint16_t type)
+{
+    _pid = pid;
+    _msg.type = type;
+    /* the main thread is busy until it waits for the first event */
+    _busy = 1 << POWER_MAIN;
+#ifdef MODULE_PM_LAYERED
+    pm_block(STM32_PM_STOP);
+#endif
+    _end = time_now_ms();
+    _account();
+    DEBUG("[power] init, idle in SLEEP\n");
+}
+
+void power_block(power_user_t user)
+{
+    unsigned state = irq_disable();
+    uint8_t busy = _busy;
+    _busy |= 1 << user;
+#ifdef MODULE_PM_LAYERED
+    if (!busy) {
+        pm_block(STM32_PM_STOP);
+    }
+#endif
+    irq_restore(state);
+    if (busy != _busy) {
+        _account();
+        DEBUG("[power] %s busy, idle in %s\n", _names[user], _modes[power_idle_mode()]);
+    }
+}
+
+void power_unblock(power_user_t user)
+{
+    unsigned state = irq_disable();
+    uint8_t busy = _busy;
+    _busy &= ~(1 << user);
+#ifdef MODULE_PM_LAYERED
+    if (busy && !_busy) {
+        pm_unblock(STM32_PM_STOP);
+    }
+#endif
+    irq_restore(state);
+    if (busy != _busy) {
+        _account();
+        DEBUG("[power] %s done, idle in %s\n", _names[user], _modes[power_idle_mode()]);
+    }
+}
+
+//mode the idle thread enters now, not counting ztimer's own block of STOP
+power_idle_t power_idle_mode(void)
+{
+    return _busy ? POWER_IDLE_SLEEP : POWER_IDLE_STOP2;
+}
+
+//end the next period period_ms after the end of the last one
+void power_wakeup(uint32_t period_ms)
+{
+    uint32_t late = time_now_ms() - _end;
+    if (late >= period_ms) {
+        /* the last period was overrun, start over from now */
+        _end += late;
+        late = 0;
+    }
+    _end += period_ms;
+    time_set_msg(&_timer, period_ms - late, &_msg, _pid);
+    DEBUG("[power] next period in %lu ms\n", (unsigned long)(period_ms - late));
+}
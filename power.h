@@ -0,0 +1,51 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+
+#include "kernel_types.h"
+
+#include "config.h"
+
+/*
+ * Low power idle.
+ *
+ * When no thread is running, the idle thread puts the MCU in the deepest mode
+ * pm_layered allows. On the STM32L4 the STOP mode is entered as STOP2 (see
+ * PM_STOP_CONFIG in the Makefile): RAM and registers are kept, the high speed
+ * clocks, the UART and ZTIMER_USEC stop. EXTI and LPTIM1 keep running, so the
+ * GPIO interrupts (PB13 fall, PG0 button, PB15 SHT3x alert, TCS34725 INT) and
+ * ZTIMER_MSEC, which runs from the RTT, still wake the MCU.
+ *
+ * STANDBY loses RAM and stays blocked (PM_BLOCKER_INITIAL in the Makefile).
+ * ztimer blocks STOP by itself while a timer on ZTIMER_USEC is set. Apart from
+ * that, STOP is blocked while one of the users below is busy:
+ *
+ *     POWER_MAIN   the main thread is handling an event (I2C transfers, flash
+ *                  writes, modem file reads at boot)
+ *     POWER_MODEM  an uplink is in flight, the TX thread waits on the UART
+ *
+ * The measurement period and the GPS polls are timed with ZTIMER_MSEC.
+ * power_idle_mode() tells which mode the idle thread enters as far as these
+ * users are concerned, a timer on ZTIMER_USEC is not seen. Set POWER_TRACE
+ * to print it after each change, also on the native board where there is no
+ * pm_layered.
+ */
+typedef enum {
+    POWER_MAIN,
+    POWER_MODEM,
+    POWER_USER_NUMOF
+} power_user_t;
+
+typedef enum {
+    POWER_IDLE_STOP2,       /**< no user is busy */
+    POWER_IDLE_SLEEP,       /**< STOP is blocked by a busy user */
+} power_idle_t;
+
+void power_init(kernel_pid_t pid, uint16_t type);
+void power_block(power_user_t user);
+void power_unblock(power_user_t user);
+void power_wakeup(uint32_t period_ms);
+power_idle_t power_idle_mode(void);
+
+#endif
@@ -2,13 +2,13 @@
 #include "sensor_lsm303agr.h"
 
 //initialize and enable device using the parameters in the header
-int init_lsm303agr(LSM303AGR_t* dev, int cm)
+int init_lsm303agr(LSM303AGR_t* dev, uint8_t ths, uint8_t dur)
 {   
     int res = LSM303AGR_init(dev, &LSM303AGR_params[0]);
     res += LSM303AGR_enable(dev);
-    res += LSM303AGR_enable_interrupt(dev, cm);
+    res += LSM303AGR_enable_interrupt(dev, ths, dur);
     if (res == 0){
-        puts("LSM303AGR: Initialization successful\n"); //should initialize using 2 options: unrespectfull: 10Hz, 0x02 duration, 40cm; 10Hz, 0x03 duration, 90cm
+        puts("LSM303AGR: Initialization successful\n");
     } else {
         puts("LSM303AGR: Initialization failed\n");
     }
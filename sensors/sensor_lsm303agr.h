@@ -9,7 +9,7 @@
 #include "lsm303agr_params.h"
 #include "periph/gpio.h"
 
-int init_lsm303agr(LSM303AGR_t* dev, int cm);
+int init_lsm303agr(LSM303AGR_t* dev, uint8_t ths, uint8_t dur);
 int read_lsm303agr(LSM303AGR_t* dev);
 
 #endif
\ No newline at end of file
@@ -16,19 +16,6 @@ int init_sht3x(sht3x_dev_t* dev)
     return 0;
 }
 
-static int16_t calculateData(int16_t humidity, float temperature)
-{
-    //Data from hum and temp should be converted in corresponding 16 bit values:
-    //hum = x/100*((2^16)-1): x*655.35    x is percentage of humidity
-    //temp = (x + 45)*((2^16)-1)/175  : (x+45)*374.5  x is temperature in celcius
-    float temp = temperature + 45.0;
-    temp = temp*374.48571;
-    int16_t temp16 = (int16_t) temp;
-    int16_t hum = humidity*655.35;
-    hum = hum & 0xFE00;
-    hum = hum + (temp16 >> 7);
-    return hum;
-}
 static uint8_t gencrc(uint8_t *data, size_t len)
 {
     uint8_t crc = 0xff;
@@ -79,7 +66,7 @@ int read_alert_sht3x(sht3x_dev_t* dev, int limit){
 }
 
 int set_alert_sht3x(sht3x_dev_t* dev, int limit, int humidity, int temperature){
-    uint16_t data = calculateData(humidity, temperature);
+    uint16_t data = SHT3X_LIMIT(humidity * 100, temperature * 100);
     uint8_t bytes[2] = {data >> 8, data & 0xff};
     uint8_t crc = gencrc(bytes, 2);
     if(sht3x_alertmode_write(dev, limit, data, crc) == SHT3X_OK){
@@ -0,0 +1,133 @@
+#include "sensor_table.h"
+
+#include <stdio.h>
+
+#include "mutex.h"
+#include "../timebase.h"
+
+//one lock for all entries, the sensors share the I2C bus anyway
+static mutex_t _cache_lock = MUTEX_INIT;
+
+//SAUL read of a registered entry, dev is the entry itself
+static int _cached_read(const void* dev, phydat_t* res)
+{
+    sensor_entry_t* s = (sensor_entry_t*)dev;
+    int dim;
+
+    mutex_lock(&_cache_lock);
+    if (s->cached_dim > 0 && time_now_ms() - s->cached_at < s->ttl) {
+        s->hits++;
+    } else {
+        s->misses++;
+        s->cached_dim = s->driver->read(s->dev, &s->cached);
+        s->cached_at = time_now_ms();
+    }
+    dim = s->cached_dim;
+    if (dim > 0) {
+        *res = s->cached;
+    } else {
+        //errors are not cached
+        s->cached_dim = 0;
+    }
+    mutex_unlock(&_cache_lock);
+    return dim;
+}
+
+static int _cached_write(const void* dev, phydat_t* data)
+{
+    sensor_entry_t* s = (sensor_entry_t*)dev;
+    int res;
+
+    mutex_lock(&_cache_lock);
+    res = s->driver->write(s->dev, data);
+    s->cached_dim = 0;
+    mutex_unlock(&_cache_lock);
+    return res;
+}
+
+void sensors_register(sensor_entry_t* table, size_t numof)
+{
+    for (size_t i = 0; i < numof; i++) {
+        sensor_entry_t* s = &table[i];
+        s->driver = s->reg.driver;
+        s->dev = s->reg.dev;
+        s->cache_driver.read = _cached_read;
+        s->cache_driver.write = _cached_write;
+        s->cache_driver.type = s->driver->type;
+        s->cached_dim = 0;
+        s->hits = 0;
+        s->misses = 0;
+        s->reg.driver = &s->cache_driver;
+        s->reg.dev = s;
+        saul_reg_add(&s->reg);
+    }
+}
+
+//start of a measurement loop: nothing read yet
+void sensors_begin(sensor_entry_t* table, size_t numof)
+{
+    for (size_t i = 0; i < numof; i++) {
+        table[i].fresh = false;
+        table[i].len = 0;
+    }
+}
+
+static bool _due(const sensor_entry_t* s, uint8_t loop, bool alert)
+{
+    if (s->disabled || s->fresh) {
+        return false;
+    }
+    if (alert && s->on_alert) {
+        return true;
+    }
+    return s->period > 0 && (loop + 1) % s->period == 0;
+}
+
+//read the sensors that are due and put their readings in the payload
+void sensors_sample(sensor_entry_t* table, size_t numof, uint8_t loop, bool alert, uint8_t* payload)
+{
+    for (size_t i = 0; i < numof; i++) {
+        sensor_entry_t* s = &table[i];
+        if (!_due(s, loop, alert)) {
+            continue;
+        }
+        s->fresh = true;
+        s->dim = saul_reg_read(&s->reg, &s->value);
+        if (s->dim <= 0) {
+            printf("%s: read failed (%d)\n", s->reg.name, s->dim);
+            continue;
+        }
+        if (s->pack) {
+            int len = s->pack(s, payload);
+            s->len = (len > 0) ? len : 0;
+        }
+    }
+}
+
+//end of the payload written in the current loop
+uint8_t sensors_payload_len(const sensor_entry_t* table, size_t numof)
+{
+    uint8_t len = 0;
+    for (size_t i = 0; i < numof; i++) {
+        if (table[i].len > 0 && table[i].offset + table[i].len > len) {
+            len = table[i].offset + table[i].len;
+        }
+    }
+    return len;
+}
+
+//first value as little endian int16
+int sensor_pack_int16(sensor_entry_t* s, uint8_t* payload)
+{
+    payload[s->offset] = s->value.val[0] & 0xFF;
+    payload[s->offset + 1] = s->value.val[0] >> 8;
+    return 2;
+}
+
+void sensors_print_cache(const sensor_entry_t* table, size_t numof)
+{
+    for (size_t i = 0; i < numof; i++) {
+        printf("sensor %u (%s): %lu cached, %lu read\n", (unsigned)i, table[i].reg.name,
+               (unsigned long)table[i].hits, (unsigned long)table[i].misses);
+    }
+}
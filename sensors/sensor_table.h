@@ -0,0 +1,61 @@
+#ifndef SENSOR_TABLE_H
+#define SENSOR_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../config.h"
+#include "saul_reg.h"
+#include "phydat.h"
+
+/*
+ * Table of sensors sampled by the measurement loop through SAUL.
+ *
+ * Each entry is registered in the SAUL registry and carries its own sampling
+ * policy and the place of its reading in the uplink payload. A sensor is
+ * sampled in loop n when (n + 1) % period == 0, and in alert loops when
+ * on_alert is set. Each sensor is read at most once per loop. Its pack
+ * function then writes the reading into the payload and returns the number
+ * of bytes written. Adding a sensor only takes a new table entry.
+ *
+ * Registration puts a sample cache between the registry and the driver: a
+ * reading younger than ttl ms is returned without touching the bus, to the
+ * measurement loop as well as to any other SAUL user such as the shell.
+ * With ttl 0 every read goes to the driver.
+ */
+typedef struct sensor_entry sensor_entry_t;
+
+typedef int (*sensor_pack_t)(sensor_entry_t* s, uint8_t* payload);
+
+struct sensor_entry {
+    saul_reg_t reg;         /**< device, name and SAUL driver */
+    uint8_t period;         /**< sample every period-th loop, 0 only on alerts */
+    bool on_alert;          /**< also sample in alert loops */
+    bool disabled;          /**< skip this sensor for now */
+    uint8_t offset;         /**< first payload byte of the reading */
+    sensor_pack_t pack;     /**< writes the reading to the payload */
+    phydat_t value;         /**< last reading */
+    int dim;                /**< dimensions of the last reading, < 0 on error */
+    bool fresh;             /**< read in the current loop */
+    uint8_t len;            /**< payload bytes written in the current loop */
+    uint32_t ttl;           /**< ms a cached reading is handed out again */
+    uint32_t hits;          /**< reads served from the cache */
+    uint32_t misses;        /**< reads that went to the driver */
+    /* set by sensors_register() */
+    const saul_driver_t* driver;    /**< the sensor's own driver */
+    void* dev;                      /**< the sensor's own device */
+    saul_driver_t cache_driver;     /**< registered in its place */
+    phydat_t cached;                /**< last reading of the driver */
+    int cached_dim;                 /**< its dimensions, 0 when empty */
+    uint32_t cached_at;             /**< local time of the reading in ms */
+};
+
+void sensors_register(sensor_entry_t* table, size_t numof);
+void sensors_begin(sensor_entry_t* table, size_t numof);
+void sensors_sample(sensor_entry_t* table, size_t numof, uint8_t loop, bool alert, uint8_t* payload);
+uint8_t sensors_payload_len(const sensor_entry_t* table, size_t numof);
+int sensor_pack_int16(sensor_entry_t* s, uint8_t* payload);
+void sensors_print_cache(const sensor_entry_t* table, size_t numof);
+
+#endif
@@ -0,0 +1,126 @@
+#include "sensor_tcs34725.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "bitarithm.h"
+#include "modem.h"
+
+#define LUX_CODES_PER_OCTAVE    (13)
+
+/* 2^((s - 0.5) / 13) in Q16, rounding boundaries inside one octave */
+static const uint32_t _lux_bounds[LUX_CODES_PER_OCTAVE] = {
+    67307, 70993, 74881, 78982, 83307, 87870, 92682,
+    97758, 103112, 108759, 114715, 120997, 127624
+};
+
+/* 2^(s / 13) in Q16, reconstruction values inside one octave */
+static const uint32_t _lux_steps[LUX_CODES_PER_OCTAVE] = {
+    65536, 69125, 72911, 76904, 81116, 85558, 90244,
+    95186, 100399, 105897, 111697, 117814, 124266
+};
+
+//encode deci-lux into one payload byte, see header for the format
+uint8_t encode_lux(uint32_t dlux)
+{
+    if (dlux == 0) {
+        return 0;
+    }
+    unsigned e = bitarithm_msb(dlux);
+    uint32_t m = (e <= 16) ? (dlux << (16 - e)) : (dlux >> (e - 16));
+    unsigned s = 0;
+    while (s < LUX_CODES_PER_OCTAVE && m >= _lux_bounds[s]) {
+        s++;
+    }
+    /* s == 13 rounds up into the next octave */
+    uint32_t code = 1 + LUX_CODES_PER_OCTAVE * e + s;
+    return (code > 255) ? 255 : code;
+}
+
+//decode one payload byte back into deci-lux
+uint32_t decode_lux(uint8_t code)
+{
+    if (code == 0) {
+        return 0;
+    }
+    unsigned e = (code - 1) / LUX_CODES_PER_OCTAVE;
+    uint32_t m = _lux_steps[(code - 1) % LUX_CODES_PER_OCTAVE];
+    if (e >= 16) {
+        return m << (e - 16);
+    }
+    return (m + (1UL << (15 - e))) >> (16 - e);
+}
+
+/* range of each word of the calibration record, in record order */
+static const struct {
+    int32_t min;
+    int32_t max;
+} _calib_bounds[] = {
+    { CALIB_TCS34725_GA_MIN, CALIB_TCS34725_GA_MAX },
+    { CALIB_TCS34725_GAIN_MIN, CALIB_TCS34725_GAIN_MAX },
+    { CALIB_TCS34725_GAIN_MIN, CALIB_TCS34725_GAIN_MAX },
+    { CALIB_TCS34725_GAIN_MIN, CALIB_TCS34725_GAIN_MAX },
+    { CALIB_TCS34725_GAIN_MIN, CALIB_TCS34725_GAIN_MAX },
+    { 0, CALIB_TCS34725_DARK_MAX },
+    { 0, CALIB_TCS34725_DARK_MAX },
+    { 0, CALIB_TCS34725_DARK_MAX },
+    { 0, CALIB_TCS34725_DARK_MAX },
+    { CALIB_TCS34725_DGF_MIN, CALIB_TCS34725_DGF_MAX },
+    { -CALIB_TCS34725_RB_COEF_MAX, CALIB_TCS34725_RB_COEF_MAX },
+    { CALIB_TCS34725_G_COEF_MIN, CALIB_TCS34725_G_COEF_MAX },
+    { -CALIB_TCS34725_RB_COEF_MAX, CALIB_TCS34725_RB_COEF_MAX },
+    { CALIB_TCS34725_CT_COEF_MIN, CALIB_TCS34725_CT_COEF_MAX },
+    { -CALIB_TCS34725_CT_OFFSET_MAX, CALIB_TCS34725_CT_OFFSET_MAX },
+};
+
+#define CALIB_WORDS     (sizeof(_calib_bounds) / sizeof(_calib_bounds[0]))
+#define CALIB_SIGNED    (9)     /* first signed word, dgf */
+
+static uint16_t _le16(const uint8_t* buf)
+{
+    return buf[0] | (buf[1] << 8);
+}
+
+//read the calibration record from the modem once and apply it to the driver
+int load_calib_tcs34725(tcs34725_t* dev)
+{
+    uint8_t buf[CALIB_TCS34725_SIZE];
+    if (modem_read_file(LIGHT_CALIB_FILE_ID, 0, CALIB_TCS34725_SIZE, buf)
+        != MODEM_STATUS_COMMAND_COMPLETED_SUCCESS) {
+        puts("Light sensor: no calibration file, using defaults");
+        return 1;
+    }
+    if (buf[0] != CALIB_TCS34725_MAGIC || buf[1] != CALIB_TCS34725_VERSION) {
+        puts("Light sensor: invalid calibration record, using defaults");
+        return 1;
+    }
+
+    /* a coefficient out of range would overflow the lux and CT sums */
+    int32_t w[CALIB_WORDS];
+    for (unsigned i = 0; i < CALIB_WORDS; i++) {
+        uint16_t raw = _le16(&buf[2 + 2 * i]);
+        w[i] = (i < CALIB_SIGNED) ? raw : (int16_t)raw;
+        if (w[i] < _calib_bounds[i].min || w[i] > _calib_bounds[i].max) {
+            printf("Light sensor: calibration word %u out of range (%"PRIi32"), using defaults\n",
+                   i, w[i]);
+            return 1;
+        }
+    }
+
+    tcs34725_calib_t calib;
+    calib.ga = w[0];
+    for (int i = 0; i < 4; i++) {
+        calib.gain[i] = w[1 + i];
+        calib.dark[i] = w[5 + i];
+    }
+    calib.dgf = w[9];
+    calib.r_coef = w[10];
+    calib.g_coef = w[11];
+    calib.b_coef = w[12];
+    calib.ct_coef = w[13];
+    calib.ct_offset = w[14];
+    tcs34725_set_calib(dev, &calib);
+    printf("Light sensor: calibration loaded (GA %u/%u)\n",
+           calib.ga, TCS34725_CALIB_ONE);
+    return 0;
+}
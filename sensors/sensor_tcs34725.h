@@ -0,0 +1,65 @@
+#ifndef SENSOR_TCS34725_H
+#define SENSOR_TCS34725_H
+
+#include <stdint.h>
+
+#include "../config.h"
+#include "tcs34725.h"
+
+/*
+ * Log-scale 8 bit light encoding used in the uplink payload.
+ *
+ * code 0 is darkness (< 0.1 lux), otherwise with c = code - 1:
+ *     lux = 0.1 * 2^(c / 13)
+ * i.e. 13 codes per octave covering 0.1 lux (code 1) to 76k lux (code 255).
+ * Values are rounded to the nearest code. ::decode_lux rounds to whole
+ * deci-lux on top, which adds to the error in dim light. Largest relative
+ * error of a round trip, as printed by tests/sensor_tcs34725:
+ *
+ *     range [lux]     | max. rel. error
+ *     ----------------+----------------
+ *     0.1 - 1         | 0.00 %
+ *     1 - 10          | 4.17 %
+ *     10 - 100        | 2.84 %
+ *     100 - 1000      | 2.71 %
+ *     1000 - 10000    | 2.71 %
+ *     10000 - 76148   | 2.71 %
+ */
+uint8_t encode_lux(uint32_t dlux);
+uint32_t decode_lux(uint8_t code);
+
+/*
+ * Calibration record stored in modem file LIGHT_CALIB_FILE_ID:
+ *
+ *     byte 0      magic CALIB_TCS34725_MAGIC
+ *     byte 1      version CALIB_TCS34725_VERSION
+ *     byte 2..31  15 little endian 16 bit words: ga, gain c/r/g/b,
+ *                 dark c/r/g/b, dgf, r/g/b coef, ct coef, ct offset
+ *
+ * Gains and ga use TCS34725_CALIB_ONE (1024) as 1.0.
+ *
+ * A record with any word outside the ranges below is rejected and the DN40
+ * defaults stay in use. Within these ranges, the lux and CT sums of the
+ * driver stay within int32 for any 16 bit count.
+ */
+#define CALIB_TCS34725_MAGIC    (0xCA)
+#define CALIB_TCS34725_VERSION  (1)
+#define CALIB_TCS34725_SIZE     (32)
+
+#define CALIB_TCS34725_GA_MIN       (TCS34725_CALIB_ONE)        /* clear window */
+#define CALIB_TCS34725_GA_MAX       (16 * TCS34725_CALIB_ONE)
+#define CALIB_TCS34725_GAIN_MIN     (TCS34725_CALIB_ONE / 2)
+#define CALIB_TCS34725_GAIN_MAX     (2 * TCS34725_CALIB_ONE)
+#define CALIB_TCS34725_DARK_MAX     (1024)                      /* counts */
+#define CALIB_TCS34725_DGF_MIN      (100)                       /* DN40: 310 */
+#define CALIB_TCS34725_DGF_MAX      (1000)
+#define CALIB_TCS34725_RB_COEF_MAX  (2000)                      /* |r|, |b| */
+#define CALIB_TCS34725_G_COEF_MIN   (250)                       /* DN40: 1000 */
+#define CALIB_TCS34725_G_COEF_MAX   (4000)
+#define CALIB_TCS34725_CT_COEF_MIN  (1000)                      /* DN40: 3810 */
+#define CALIB_TCS34725_CT_COEF_MAX  (8000)
+#define CALIB_TCS34725_CT_OFFSET_MAX (4000)                     /* |offset| */
+
+int load_calib_tcs34725(tcs34725_t* dev);
+
+#endif
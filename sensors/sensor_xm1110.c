@@ -0,0 +1,540 @@
+#include "sensor_xm1110.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "minmea.h"
+#include "../timebase.h"
+
+#define NMEA_MAX_LENGTH     (80)    /* '$' up to the checksum, without "\r\n" */
+#define DAYS_INVALID        (UINT32_MAX)
+
+static gps_fix_t _fix;
+static gps_rmc_t _rmc;
+static struct minmea_sentence_gga _gga;
+static bool _have_rmc;
+static bool _have_gga;
+static gps_stats_t _stats;
+static bool _on;
+static uint32_t _wake_time;
+static uint32_t _timeout;
+static gps_mode_t _mode;
+static uint32_t _sleep;
+static gps_attempt_t _attempts[GPS_ATTEMPT_LOG];
+static uint8_t _attempt_pos;
+
+static uint32_t _seconds(const struct minmea_time* t)
+{
+    return t->hours * 3600UL + t->minutes * 60UL + t->seconds;
+}
+
+//days since 1970-01-01 of a date from 2000 to 2099, DAYS_INVALID if there is no such day
+static uint32_t _days(uint16_t year, uint8_t month, uint8_t day)
+{
+    static const uint16_t before[13] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 };
+    bool leap = (year % 4 == 0);
+    if (month < 1 || month > 12 || day < 1 ||
+        day > before[month] - before[month - 1] + (leap && month == 2)) {
+        return DAYS_INVALID;
+    }
+    uint32_t days = (year - 1970) * 365UL + (year - 1969) / 4 + before[month - 1] + day - 1;
+    if (month > 2 && leap) {
+        days++;
+    }
+    return days;
+}
+
+static void _to_time(uint32_t epoch, xm1110_time_t* time)
+{
+    uint32_t days = epoch / 86400;
+    uint32_t secs = epoch % 86400;
+    time->hour = secs / 3600;
+    time->minute = (secs / 60) % 60;
+    time->second = secs % 60;
+    time->year = 1970 + days / 365;
+    while (_days(time->year, 1, 1) > days) {
+        time->year--;
+    }
+    time->month = 12;
+    while (_days(time->year, time->month, 1) > days) {
+        time->month--;
+    }
+    time->day = days - _days(time->year, time->month, 1) + 1;
+}
+
+//inject the current time and last position so the module knows where to look
+static bool _seed(xm1110_t* dev)
+{
+    if (!_fix.valid || fix_age_xm1110() > GPS_SEED_MAX_AGE) {
+        return false;
+    }
+    xm1110_time_t now;
+    uint32_t days = _days(2000 + _fix.utc_date % 100, (_fix.utc_date / 100) % 100,
+                          _fix.utc_date / 10000);
+    if (days == DAYS_INVALID) {
+        printf("GPS: no seed, invalid date %06lu\n", (unsigned long)_fix.utc_date);
+        return false;
+    }
+    _to_time(days * 86400UL + _fix.utc_time + fix_age_xm1110() / 1000, &now);
+    if (xm1110_set_time(dev, &now) != XM1110_OK ||
+        xm1110_set_ref_position(dev, _fix.latitude / 10, _fix.longitude / 10, _fix.altitude, &now) != XM1110_OK) {
+        printf("GPS: time/position seed not acknowledged\n");
+        return false;
+    }
+    return true;
+}
+
+/* cos of 0, 10, ... 90 degrees in 1/1024 */
+static const uint16_t _cos10[] = { 1024, 1008, 962, 887, 784, 658, 512, 350, 178, 0 };
+
+//cos of a latitude in micro-degrees in 1/1024, linear between steps of 10 degrees
+static uint32_t _cos_lat(int32_t latitude)
+{
+    uint32_t a = (latitude < 0) ? -(uint32_t)latitude : (uint32_t)latitude;
+    uint32_t i = a / 10000000;
+    if (i >= 9) {
+        return 0;
+    }
+    return _cos10[i] - ((_cos10[i] - _cos10[i + 1]) * (a % 10000000)) / 10000000;
+}
+
+//more than GPS_MOVING_DIST m apart, on a flat earth around the first position
+static bool _moved(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+    int64_t dlat = (int64_t)lat2 - lat1;
+    int64_t dlon = (int64_t)lon2 - lon1;
+    if (dlon > 180000000) {
+        dlon -= 360000000;
+    }
+    else if (dlon < -180000000) {
+        dlon += 360000000;
+    }
+    /* over a degree apart is moving, and keeps the squares below in range */
+    if (dlat > 1000000 || dlat < -1000000 || dlon > 1000000 || dlon < -1000000) {
+        return true;
+    }
+    /* cm, a micro-degree of latitude is 11.12 cm */
+    int64_t dy = (dlat * 1112) / 100;
+    int64_t dx = (dlon * 1112 * _cos_lat(lat1)) / (100 * 1024);
+    int64_t dist = GPS_MOVING_DIST * 100LL;
+    return dx * dx + dy * dy > dist * dist;
+}
+
+//combine RMC and GGA of the same epoch into a fix if the quality is good enough
+static bool _update_fix(void)
+{
+    if (!_have_rmc || !_have_gga || _rmc.time != _seconds(&_gga.time)) {
+        return false;
+    }
+    _have_rmc = false;
+    _have_gga = false;
+
+    int32_t hdop = minmea_rescale(&_gga.hdop, 100);
+    if (_gga.fix_quality == 0 || _gga.satellites_tracked < GPS_MIN_SATS ||
+        hdop <= 0 || hdop > GPS_MAX_HDOP) {
+        printf("GPS: fix rejected (quality %d, sats %d, hdop %"PRIi32")\n",
+               _gga.fix_quality, _gga.satellites_tracked, hdop);
+        return false;
+    }
+
+    _fix.moving = _fix.valid &&
+                  _moved(_fix.latitude, _fix.longitude, _rmc.latitude, _rmc.longitude);
+    _fix.latitude = _rmc.latitude;
+    _fix.longitude = _rmc.longitude;
+    _fix.utc_time = _rmc.time;
+    _fix.utc_date = _rmc.date;
+    _fix.altitude = minmea_rescale(&_gga.altitude, 1);
+    _fix.hdop = hdop;
+    _fix.sats = _gga.satellites_tracked;
+    _fix.quality = _gga.fix_quality;
+    _fix.timestamp = time_now_ms();
+    _fix.valid = true;
+    return true;
+}
+
+//end of a fix attempt, only in GPS_MODE_STANDBY the module is sent to standby by us
+static void _standby(xm1110_t* dev)
+{
+    if (_mode == GPS_MODE_STANDBY) {
+        xm1110_set_gps_standby(dev);
+    }
+    _on = false;
+    _stats.on_time += time_now_ms() - _wake_time;
+    printf("GPS: %"PRIu32"/%"PRIu32" attempts with fix, last TTFF %"PRIu32" ms, on for %"
+           PRIu32" s in total\n",
+           _stats.fixes, _stats.attempts, _stats.last_ttff, _stats.on_time / 1000);
+    if (_stats.seeded_fixes > 0 && _stats.fixes > _stats.seeded_fixes) {
+        printf("GPS: mean TTFF %"PRIu32" ms seeded, %"PRIu32" ms unseeded\n",
+               _stats.seeded_ttff_sum / _stats.seeded_fixes,
+               (_stats.ttff_sum - _stats.seeded_ttff_sum) / (_stats.fixes - _stats.seeded_fixes));
+    }
+}
+
+int init_gps_xm1110(xm1110_t* dev)
+{
+    int res = 0;
+    memset(&_stats, 0, sizeof(_stats));
+    _wake_time = time_now_ms();
+    _on = true;
+    _mode = GPS_MODE_STANDBY;
+
+    //only RMC and GGA are parsed, the rest only fills up the I2C buffer
+    if (xm1110_set_nmea_output(dev, 1, 1) != XM1110_OK ||
+        xm1110_set_update_rate(dev, 1000) != XM1110_OK) {
+        printf("GPS: configuration not acknowledged\n");
+        res = 1;
+    }
+    int sets = xm1110_get_epo_sets(dev);
+    if (sets < 0) {
+        printf("GPS: EPO query failed (%d)\n", sets);
+    } else {
+        printf("GPS: %d EPO sets\n", sets);
+    }
+    _standby(dev);
+    return res;
+}
+
+//wake the GPS for a fix attempt, returns 1 if the cached fix is still recent
+int start_fix_xm1110(xm1110_t* dev)
+{
+    if (_on) {
+        return 0;
+    }
+    if (_fix.valid && fix_age_xm1110() < GPS_FIX_REUSE_MS) {
+        printf("GPS: reusing fix from %"PRIu32" s ago\n", fix_age_xm1110() / 1000);
+        return 1;
+    }
+
+    _stats.attempts++;
+    _wake_time = time_now_ms();
+    _have_rmc = false;
+    _have_gga = false;
+    _attempt_pos = (_attempt_pos + 1) % GPS_ATTEMPT_LOG;
+    _attempts[_attempt_pos].start = _wake_time;
+    _attempts[_attempt_pos].ttff = 0;
+    _attempts[_attempt_pos].seeded = false;
+    if (_mode != GPS_MODE_STANDBY) {
+        /* the module wakes itself, make sure a whole periodic cycle is covered */
+        _timeout = (_mode == GPS_MODE_PERIODIC) ? GPS_PERIODIC_RUN_MS * 3 + _sleep : GPS_FIX_TIMEOUT_MS;
+        _on = true;
+        return 0;
+    }
+    _timeout = GPS_FIX_TIMEOUT_MS;
+    if (xm1110_set_gps_active(dev) != XM1110_OK) {
+        /* try again next time, make sure it does not stay half awake */
+        _stats.wake_errors++;
+        _on = true;
+        _standby(dev);
+        return -1;
+    }
+    _on = true;
+    _attempts[_attempt_pos].seeded = _seed(dev);
+    return 0;
+}
+
+//read the NMEA output, returns 1 when the attempt is over and the GPS is in standby
+int poll_fix_xm1110(xm1110_t* dev, xm1110_data_t* xmdata)
+{
+    if (!_on) {
+        return 1;
+    }
+    uint32_t fix_time = _fix.timestamp;
+    read_gps_xm1110(dev, xmdata);
+
+    if (_fix.valid && _fix.timestamp != fix_time) {
+        _stats.fixes++;
+        _stats.last_ttff = _fix.timestamp - _wake_time;
+        _stats.ttff_sum += _stats.last_ttff;
+        _attempts[_attempt_pos].ttff = _stats.last_ttff;
+        if (_attempts[_attempt_pos].seeded) {
+            _stats.seeded_fixes++;
+            _stats.seeded_ttff_sum += _stats.last_ttff;
+        }
+        _standby(dev);
+        return 1;
+    }
+    if (time_now_ms() - _wake_time >= _timeout) {
+        printf("GPS: no fix within %"PRIu32" s\n", _timeout / 1000);
+        _stats.timeouts++;
+        _standby(dev);
+        return 1;
+    }
+    return 0;
+}
+
+bool gps_on_xm1110(void)
+{
+    return _on;
+}
+
+//pick the power mode for a fix every interval_ms, 0 if no fixes are needed
+int set_fix_interval_xm1110(xm1110_t* dev, uint32_t interval_ms, bool moving)
+{
+    gps_mode_t mode = GPS_MODE_STANDBY;
+    uint32_t sleep = 0;
+    int res;
+
+    if (interval_ms > 0 && interval_ms <= GPS_PERIODIC_MAX_MS) {
+        if (moving) {
+            mode = GPS_MODE_ALWAYSLOCATE;
+        } else {
+            mode = GPS_MODE_PERIODIC;
+            sleep = (interval_ms > GPS_PERIODIC_RUN_MS + 1000) ? interval_ms - GPS_PERIODIC_RUN_MS : 1000;
+        }
+    }
+    if (mode == _mode && sleep == _sleep) {
+        return 0;
+    }
+
+    //commands are only received while the module is awake
+    if (xm1110_set_gps_active(dev) != XM1110_OK) {
+        _stats.wake_errors++;
+        return -1;
+    }
+    switch (mode) {
+        case GPS_MODE_PERIODIC:
+            res = xm1110_set_periodic(dev, GPS_PERIODIC_RUN_MS, sleep);
+            break;
+        case GPS_MODE_ALWAYSLOCATE:
+            res = xm1110_set_alwayslocate(dev);
+            break;
+        default:
+            res = xm1110_set_normal(dev);
+            break;
+    }
+    if (res != XM1110_OK) {
+        printf("GPS: power mode %d not acknowledged (%d)\n", mode, res);
+        mode = GPS_MODE_STANDBY;
+        sleep = 0;
+    }
+    _mode = mode;
+    _sleep = sleep;
+    if (_mode == GPS_MODE_STANDBY && !_on) {
+        xm1110_set_gps_standby(dev);
+    }
+    printf("GPS: power mode %d, run %"PRIu32" s, sleep %"PRIu32" s\n", _mode,
+           (uint32_t)((_mode == GPS_MODE_PERIODIC) ? GPS_PERIODIC_RUN_MS / 1000 : 0),
+           _sleep / 1000);
+    return res == XM1110_OK ? 0 : -1;
+}
+
+/* value of a hex digit, indexed from '0', -1 if it is none */
+static const int8_t _hex[] = {
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15,
+};
+
+static int _hexval(char c)
+{
+    unsigned i = (unsigned)(c - '0');
+    return (i < sizeof(_hex)) ? _hex[i] : -1;
+}
+
+//the digits at s[*pos] as an integer of at most max digits, returns the digit count
+static int _digits(const char* s, size_t* pos, size_t end, uint32_t* value, int max)
+{
+    int n = 0;
+    *value = 0;
+    while (*pos < end && s[*pos] >= '0' && s[*pos] <= '9') {
+        if (n < max) {
+            *value = *value * 10 + (s[*pos] - '0');
+        }
+        n++;
+        (*pos)++;
+    }
+    return n;
+}
+
+//ddmm.m[mmmmm] (latitude, 2 degree digits) or dddmm.m[mmmmm] (longitude, 3)
+//and the hemisphere into micro-degrees, up to 90 or 180 degrees
+static bool _coordinate(const char* s, size_t* pos, size_t end, char neg, int32_t* out)
+{
+    const int width = (neg == 'S') ? 4 : 5;
+    const uint32_t max = (neg == 'S') ? 90000000UL : 180000000UL;
+    uint32_t ddmm, frac;
+    if (_digits(s, pos, end, &ddmm, width) != width || *pos >= end || s[*pos] != '.') {
+        return false;
+    }
+    (*pos)++;
+    int n = _digits(s, pos, end, &frac, 6);
+    if (n < 1 || n > 6) {
+        return false;
+    }
+    for (; n < 6; n++) {
+        frac *= 10;
+    }
+    if (ddmm % 100 >= 60 || *pos + 2 >= end || s[*pos] != ',' || s[*pos + 2] != ',') {
+        return false;
+    }
+    /* minutes in 1e-6 minute units, divided by 60 with rounding */
+    uint32_t udeg = (ddmm / 100) * 1000000UL + ((ddmm % 100) * 1000000UL + frac + 30) / 60;
+    char hemi = s[*pos + 1];
+    *pos += 2;
+    if (udeg > max) {
+        return false;
+    }
+    *out = (hemi == neg) ? -(int32_t)udeg : (int32_t)udeg;
+    return hemi == neg || hemi == (neg == 'S' ? 'N' : 'E');
+}
+
+//skip to the first character after the next ','
+static bool _field(const char* s, size_t* pos, size_t end)
+{
+    while (*pos < end && s[*pos] != ',') {
+        (*pos)++;
+    }
+    if (*pos >= end) {
+        return false;
+    }
+    (*pos)++;
+    return true;
+}
+
+bool parse_rmc_xm1110(const char* s, size_t len, gps_rmc_t* rmc)
+{
+    /* $xxRMC,hhmmss.sss,A,ddmm.mmmm,N,dddmm.mmmm,E,spd,cog,ddmmyy,...*hh */
+    if (len < 16 || s[0] != '$' || memcmp(&s[3], "RMC,", 4) != 0 || s[len - 3] != '*') {
+        return false;
+    }
+    size_t end = len - 3;
+    size_t pos = 7;
+    uint32_t hhmmss, date;
+
+    if (_digits(s, &pos, end, &hhmmss, 6) != 6 || pos >= end ||
+        (s[pos] != '.' && s[pos] != ',') || !_field(s, &pos, end) ||
+        pos + 1 >= end || s[pos] != 'A' || s[pos + 1] != ',') {
+        return false;   /* no time or a void fix */
+    }
+    if (hhmmss / 10000 >= 24 || (hhmmss / 100) % 100 >= 60 || hhmmss % 100 >= 60) {
+        return false;
+    }
+
+    int hi = _hexval(s[len - 2]);
+    int lo = _hexval(s[len - 1]);
+    uint8_t cs = 0;
+    for (size_t i = 1; i < end; i++) {
+        cs ^= (uint8_t)s[i];
+    }
+    if (hi < 0 || lo < 0 || cs != ((hi << 4) | lo)) {
+        return false;
+    }
+
+    pos += 2;
+    if (!_coordinate(s, &pos, end, 'S', &rmc->latitude) || !_field(s, &pos, end) ||
+        !_coordinate(s, &pos, end, 'W', &rmc->longitude) || !_field(s, &pos, end) ||
+        !_field(s, &pos, end) || !_field(s, &pos, end) ||
+        _digits(s, &pos, end, &date, 6) != 6 || (pos < end && s[pos] != ',') ||
+        _days(2000 + date % 100, (date / 100) % 100, date / 10000) == DAYS_INVALID) {
+        return false;
+    }
+    rmc->time = (hhmmss / 10000) * 3600UL + ((hhmmss / 100) % 100) * 60UL + hhmmss % 100;
+    rmc->date = date;
+    return true;
+}
+
+//next complete sentence in data[*pos, len), as a slice without the line ending
+static bool _next_sentence(char* data, size_t len, size_t* pos, char** sentence, size_t* slen)
+{
+    while (*pos < len) {
+        char* start = memchr(&data[*pos], '$', len - *pos);
+        if (!start) {
+            break;
+        }
+        char* end = memchr(start, '\n', len - (start - data));
+        if (!end) {
+            break;  /* cut off at the end of the buffer */
+        }
+        *pos = end - data + 1;
+        if (end > start && end[-1] == '\r') {
+            end--;
+        }
+        if (end - start <= NMEA_MAX_LENGTH) {
+            *sentence = start;
+            *slen = end - start;
+            return true;
+        }
+    }
+    *pos = len;
+    return false;
+}
+
+//parse the NMEA data in the GPS buffer, returns 0 if a fix is available
+int read_gps_xm1110(xm1110_t* dev, xm1110_data_t* xmdata)
+{
+    char* sentence;
+    size_t slen;
+    size_t pos = 0;
+
+    if (xm1110_read(dev, xmdata) != XM1110_OK) {
+        printf("GPS: read failed\n");
+        return _fix.valid ? 0 : -1;
+    }
+
+    while (_next_sentence(xmdata->data, xmdata->len, &pos, &sentence, &slen)) {
+        if (slen > 6 && memcmp(&sentence[3], "RMC", 3) == 0) {
+            //void fixes are not kept, a following GGA then finds no matching RMC
+            _have_rmc = parse_rmc_xm1110(sentence, slen, &_rmc);
+        } else if (slen > 6 && memcmp(&sentence[3], "GGA", 3) == 0) {
+            /* minmea wants a C string: terminate in place on the line ending */
+            sentence[slen] = '\0';
+            _have_gga = minmea_sentence_id(sentence, false) == MINMEA_SENTENCE_GGA &&
+                        minmea_parse_gga(&_gga, sentence);
+        }
+
+        if (_update_fix()) {
+            printf("GPS: fix (%"PRIi32",%"PRIi32") sats %d hdop %d.%02d\n",
+                   _fix.latitude, _fix.longitude, _fix.sats,
+                   _fix.hdop / 100, _fix.hdop % 100);
+        }
+    }
+    return _fix.valid ? 0 : -1;
+}
+
+const gps_fix_t* get_fix_xm1110(void)
+{
+    return &_fix;
+}
+
+uint32_t fix_age_xm1110(void)
+{
+    return time_now_ms() - _fix.timestamp;
+}
+
+const gps_stats_t* get_stats_xm1110(void)
+{
+    return &_stats;
+}
+
+//attempt n, 0 being the last one, returns -1 if there is none
+int get_attempt_xm1110(uint8_t n, gps_attempt_t* attempt)
+{
+    if (n >= GPS_ATTEMPT_LOG || n >= _stats.attempts) {
+        return -1;
+    }
+    *attempt = _attempts[(_attempt_pos + GPS_ATTEMPT_LOG - n) % GPS_ATTEMPT_LOG];
+    return 0;
+}
+
+static int _saul_read(const void* dev, phydat_t* res)
+{
+    (void)dev;
+    if (!_fix.valid) {
+        return -ECANCELED;
+    }
+    res->val[0] = _fix.latitude / 10000;
+    res->val[1] = _fix.longitude / 10000;
+    res->unit = UNIT_NONE;
+    res->scale = -2;
+    return 2;
+}
+
+const saul_driver_t xm1110_saul_driver = {
+    .read = _saul_read,
+    .write = saul_notsup,
+    .type = SAUL_SENSE_ANY,
+};
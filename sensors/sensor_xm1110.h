@@ -0,0 +1,121 @@
+#ifndef SENSOR_XM1110_H
+#define SENSOR_XM1110_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../config.h"
+#include "xm1110.h"
+#include "saul.h"
+
+/*
+ * Last good GPS fix.
+ *
+ * A fix is taken from an RMC sentence with status 'A' and the GGA sentence
+ * of the same UTC time. It is rejected when GGA reports no fix, fewer than
+ * GPS_MIN_SATS satellites, or an HDOP above GPS_MAX_HDOP. The sentences may
+ * arrive in different reads of the I2C buffer.
+ */
+typedef struct {
+    bool valid;             /**< a fix was obtained since boot */
+    int32_t latitude;       /**< micro-degrees, north positive */
+    int32_t longitude;      /**< micro-degrees, east positive */
+    uint32_t utc_time;      /**< seconds since midnight UTC */
+    uint32_t utc_date;      /**< ddmmyy */
+    int16_t altitude;       /**< meters above mean sea level */
+    uint16_t hdop;          /**< HDOP * 100 */
+    uint8_t sats;           /**< satellites used */
+    uint8_t quality;        /**< GGA fix quality */
+    bool moving;            /**< moved more than GPS_MOVING_DIST since the previous fix */
+    uint32_t timestamp;     /**< local time of the fix in ms */
+} gps_fix_t;
+
+/*
+ * GPS power management.
+ *
+ * The module is kept in standby and only woken for a fix attempt:
+ * start_fix_xm1110() wakes it, after which poll_fix_xm1110() has to be called
+ * every GPS_POLL_MS. Once a fix is accepted, or after GPS_FIX_TIMEOUT_MS, the
+ * module goes back to standby. No attempt is started while the cached fix is
+ * younger than GPS_FIX_REUSE_MS.
+ *
+ * How the module spends the time between attempts depends on how often a fix
+ * is needed, see set_fix_interval_xm1110():
+ *  - no fixes, or less often than GPS_PERIODIC_MAX_MS: standby, woken by us
+ *  - while moving: AlwaysLocate, the module adapts its duty cycle to motion
+ *  - stationary: periodic mode, GPS_PERIODIC_RUN_MS tracking per interval
+ * In the last two modes the module wakes itself, attempts only read its
+ * output and on_time only counts the attempts.
+ */
+typedef enum {
+    GPS_MODE_STANDBY = 0,
+    GPS_MODE_PERIODIC,
+    GPS_MODE_ALWAYSLOCATE,
+} gps_mode_t;
+
+typedef struct {
+    uint32_t attempts;      /**< fix attempts started */
+    uint32_t fixes;         /**< attempts that ended with a fix */
+    uint32_t timeouts;      /**< attempts that ended without a fix */
+    uint32_t wake_errors;   /**< wake ups without NMEA read back */
+    uint32_t last_ttff;     /**< time to fix of the last good attempt in ms */
+    uint32_t ttff_sum;      /**< sum of the time to fix of all good attempts in ms */
+    uint32_t on_time;       /**< total time the module was awake in ms */
+    uint32_t seeded_fixes;  /**< good attempts that started with time and position injected */
+    uint32_t seeded_ttff_sum; /**< sum of their time to fix in ms */
+} gps_stats_t;
+
+/*
+ * Assisted start: before a woken module starts searching, the UTC time
+ * (last fix time plus the time elapsed since) and the last fix position are
+ * injected with PMTK740/741, if the last fix is younger than GPS_SEED_MAX_AGE.
+ * The outcome of the last GPS_ATTEMPT_LOG attempts is kept to compare the
+ * time to fix with and without seeding.
+ */
+typedef struct {
+    uint32_t start;         /**< local time the attempt started in ms */
+    uint32_t ttff;          /**< time to fix in ms, 0 without a fix */
+    bool seeded;            /**< time and position were injected */
+} gps_attempt_t;
+
+int init_gps_xm1110(xm1110_t* dev);
+int start_fix_xm1110(xm1110_t* dev);
+int poll_fix_xm1110(xm1110_t* dev, xm1110_data_t* xmdata);
+bool gps_on_xm1110(void);
+int set_fix_interval_xm1110(xm1110_t* dev, uint32_t interval_ms, bool moving);
+int read_gps_xm1110(xm1110_t* dev, xm1110_data_t* xmdata);
+
+/*
+ * SAUL driver for the cached fix, reads fail without a fix.
+ *
+ * SAUL has no position class or unit, so it is registered as
+ * SAUL_SENSE_ANY and returns latitude and longitude in units of 0.01 degree
+ * (about 1 km). Use get_fix_xm1110() for the full resolution.
+ */
+extern const saul_driver_t xm1110_saul_driver;
+
+/*
+ * Single pass RMC parser.
+ *
+ * Works on a sentence of len bytes from '$' up to the checksum (no line
+ * ending, no NUL needed). Returns false for anything but a well formed RMC
+ * sentence with status 'A' and a matching checksum. The fields have to have
+ * the NMEA widths: hhmmss with optional decimals, ddmm.m and dddmm.m with
+ * one to six decimals of the minutes, a one letter hemisphere and ddmmyy.
+ * Times, coordinates beyond 90 or 180 degrees and dates that do not exist
+ * are rejected. Coordinates are converted straight to micro-degrees.
+ */
+typedef struct {
+    uint32_t time;          /**< seconds since midnight UTC */
+    uint32_t date;          /**< ddmmyy */
+    int32_t latitude;       /**< micro-degrees, north positive */
+    int32_t longitude;      /**< micro-degrees, east positive */
+} gps_rmc_t;
+
+bool parse_rmc_xm1110(const char* s, size_t len, gps_rmc_t* rmc);
+const gps_fix_t* get_fix_xm1110(void);
+uint32_t fix_age_xm1110(void);
+const gps_stats_t* get_stats_xm1110(void);
+int get_attempt_xm1110(uint8_t n, gps_attempt_t* attempt);
+
+#endif
@@ -0,0 +1,28 @@
+#include "settings.h"
+
+#include "LSM303AGR.h"
+
+_Static_assert(SETTINGS_VALID(MEASURE_INTERVAL_MS, SEND_EVERY, TEMP_ALERT, HUM_ALERT,
+                              FALL_THRESHOLD_MG, FALL_SAMPLES, LIGHT_INT_PERSISTENCE,
+                              GPS_POLICY),
+               "default settings out of range, see settings.h");
+
+settings_t settings = SETTINGS_DEFAULT;
+
+bool settings_valid(const settings_t* s)
+{
+    return SETTINGS_VALID(s->interval_ms, s->send_every, s->temp_alert, s->hum_alert,
+                          s->fall_mg, s->fall_samples, s->light_persistence,
+                          s->gps_policy);
+}
+
+//check and take over new settings, the derived values are computed here
+int settings_apply(const settings_t* s)
+{
+    if (!settings_valid(s)) {
+        return -1;
+    }
+    settings = *s;
+    settings.fall_ths = LSM303AGR_FREEFALL_THS(s->fall_mg);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+
+/*
+ * Settings that can be changed at run time.
+ *
+ * The defaults come from SETTINGS_DEFAULT in config.h and can be overridden
+ * at compile time (e.g. CFLAGS += -DTEMP_ALERT=2800). They are checked
+ * against the limits below when compiling. New settings are checked the
+ * same way by settings_apply(), which also computes the derived values, so
+ * the measurement loop only compares and never converts.
+ */
+typedef struct {
+    uint32_t interval_ms;       /**< time between measurement loops */
+    uint8_t send_every;         /**< loops per routine uplink */
+    int16_t temp_alert;         /**< centi-degrees Celsius, alert at or above */
+    int16_t hum_alert;          /**< centi-percent RH, alert at or above */
+    uint16_t fall_mg;           /**< free fall threshold */
+    uint8_t fall_samples;       /**< free fall duration in samples at 10 Hz */
+    uint16_t light_threshold;   /**< clear counts at the initial range that raise the light alert */
+    uint8_t light_persistence;  /**< APERS field of the light interrupt */
+    uint8_t gps_policy;         /**< GPS_POLICY_OFF or GPS_POLICY_AUTO */
+    /* derived */
+    uint8_t fall_ths;           /**< INT1_THS register value */
+} settings_t;
+
+#define SETTINGS_INTERVAL_MIN   (1000U)
+#define SETTINGS_INTERVAL_MAX   (3600000U)
+#define SETTINGS_SEND_MAX       (60)
+#define SETTINGS_TEMP_MIN       (-4500)     /* SHT3x range */
+#define SETTINGS_TEMP_MAX       (13000)
+#define SETTINGS_HUM_MAX        (10000)
+#define SETTINGS_FALL_MG_MIN    (16)        /* one LSB at +-2 g */
+#define SETTINGS_FALL_MG_MAX    (2032)      /* 7 bit threshold */
+#define SETTINGS_FALL_DUR_MAX   (127)
+#define SETTINGS_PERS_MAX       (15)
+
+#define SETTINGS_VALID(interval, send, temp, hum, fall_mg, fall_dur, pers, gps) \
+    ((interval) >= SETTINGS_INTERVAL_MIN && (interval) <= SETTINGS_INTERVAL_MAX && \
+     (send) >= 1 && (send) <= SETTINGS_SEND_MAX && \
+     (temp) >= SETTINGS_TEMP_MIN && (temp) <= SETTINGS_TEMP_MAX && \
+     (hum) >= 0 && (hum) <= SETTINGS_HUM_MAX && \
+     (fall_mg) >= SETTINGS_FALL_MG_MIN && (fall_mg) <= SETTINGS_FALL_MG_MAX && \
+     (fall_dur) <= SETTINGS_FALL_DUR_MAX && (pers) <= SETTINGS_PERS_MAX && \
+     (gps) <= GPS_POLICY_AUTO)
+
+extern settings_t settings;
+
+bool settings_valid(const settings_t* s);
+int settings_apply(const settings_t* s);
+
+#endif
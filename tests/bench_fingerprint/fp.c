@@ -0,0 +1,2 @@
+/* the matcher under test */
+#include "fingerprint.c"
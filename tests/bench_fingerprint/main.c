@@ -0,0 +1,267 @@
+/*
+ * Time of fingerprint_match() on maps of 100, 300 and 1000 reference points,
+ * and its rooms against a plain k-NN vote.
+ *
+ * The maps are made up of ROOMS rooms, each with its own RSSI per gateway,
+ * and reference points scattered around them. They are written through
+ * fingerprint_write() in chunks, as the modem passes on a file write of the
+ * backend. Each query observes the gateways of one room with some noise.
+ * The reference computes every distance in full and votes among the FP_K
+ * nearest points, the matcher has to pick the same room with its early exit.
+ * A small map checks a vote the nearest point loses, and a query that is too
+ * far from every point.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ztimer.h"
+
+#include "fingerprint.h"
+#include "modem.h"
+#include "timebase.h"
+
+#ifndef BENCH_RUNS
+#define BENCH_RUNS      (100)   /* matches per query */
+#endif
+
+#define ROOMS           (12)
+#define QUERIES         (10)
+#define GATEWAYS        (FP_MAX_GATEWAYS)
+#define UNHEARD         (100)   /* -dBm, weaker gateways are not heard */
+#define NOISE           (6)     /* dB either way */
+#define CHUNK           (64)    /* bytes per file write */
+
+static uint8_t _map[FP_MAP_MAX];
+static uint8_t _center[ROOMS][GATEWAYS];
+static uint8_t _obs[GATEWAYS];
+
+uint32_t time_now_ms(void)
+{
+    return 0;
+}
+
+void time_set_msg(ztimer_t* timer, uint32_t ms, msg_t* msg, kernel_pid_t pid)
+{
+    (void)timer; (void)ms; (void)msg; (void)pid;
+}
+
+/* there is no map file, the maps are written by the test */
+modem_status_t modem_read_file(uint8_t file_id, uint32_t offset, uint32_t size, uint8_t* buffer)
+{
+    (void)file_id; (void)offset; (void)size; (void)buffer;
+    return MODEM_STATUS_COMMAND_COMPLETED_ERROR;
+}
+
+static uint32_t _random(void)
+{
+    /* xorshift32 */
+    static uint32_t x = 2463534242UL;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+//level around a room's level, 0 when the gateway is not heard
+static uint8_t _noisy(uint8_t level)
+{
+    int l = level + (int)(_random() % (2 * NOISE + 1)) - NOISE;
+    return (l > UNHEARD) ? 0 : l;
+}
+
+static const uint8_t* _uid(uint8_t g)
+{
+    return &_map[FP_MAP_HEADER + g * FP_UID_SIZE];
+}
+
+//header and gateway UIDs, returns the offset of the first point
+static uint32_t _header(uint8_t gateways, uint16_t points)
+{
+    _map[0] = FP_MAP_MAGIC;
+    _map[1] = FP_MAP_VERSION;
+    _map[2] = gateways;
+    _map[3] = 0;
+    _map[4] = points & 0xFF;
+    _map[5] = points >> 8;
+    for (uint8_t g = 0; g < gateways; g++) {
+        memset(&_map[FP_MAP_HEADER + g * FP_UID_SIZE], 0xA0 + g, FP_UID_SIZE);
+    }
+    return FP_MAP_HEADER + gateways * FP_UID_SIZE;
+}
+
+static void _write(uint32_t size)
+{
+    for (uint32_t offset = 0; offset < size; offset += CHUNK) {
+        fingerprint_write(offset, (size - offset < CHUNK) ? size - offset : CHUNK,
+                          &_map[offset]);
+    }
+}
+
+static void _build(uint16_t points)
+{
+    uint32_t p = _header(GATEWAYS, points);
+
+    for (uint16_t n = 0; n < points; n++) {
+        uint8_t room = n % ROOMS;
+        _map[p++] = room;
+        for (uint8_t g = 0; g < GATEWAYS; g++) {
+            _map[p++] = _noisy(_center[room][g]);
+        }
+    }
+    _write(p);
+}
+
+//observe the gateways as heard in a room, or at the given levels
+static void _observe(uint8_t gateways, const uint8_t* levels)
+{
+    fingerprint_clear();
+    for (uint8_t g = 0; g < gateways; g++) {
+        _obs[g] = levels ? levels[g] : 0;
+        if (_obs[g] != 0) {
+            fingerprint_observe(_uid(g), -_obs[g]);
+        }
+    }
+}
+
+//room of the FP_K nearest points, every distance computed in full
+static int _reference(uint8_t gateways, uint16_t points)
+{
+    uint32_t dist[FP_K];
+    uint8_t room[FP_K];
+    uint8_t count = 0;
+    const uint8_t* p = &_map[FP_MAP_HEADER + gateways * FP_UID_SIZE];
+
+    for (uint16_t n = 0; n < points; n++, p += 1 + gateways) {
+        uint32_t d = 0;
+        for (uint8_t g = 0; g < gateways; g++) {
+            int o = _obs[g] ? _obs[g] : FP_RSSI_FLOOR;
+            int r = p[1 + g] ? p[1 + g] : FP_RSSI_FLOOR;
+            d += (o - r) * (o - r);
+        }
+        /* sorted by distance, the earlier point first on equal distance */
+        uint8_t i = count;
+        while (i > 0 && dist[i - 1] > d) {
+            i--;
+        }
+        if (i == FP_K) {
+            continue;
+        }
+        for (uint8_t j = (count < FP_K) ? count++ : FP_K - 1; j > i; j--) {
+            dist[j] = dist[j - 1];
+            room[j] = room[j - 1];
+        }
+        dist[i] = d;
+        room[i] = p[0];
+    }
+    if (count == 0 || dist[0] > (uint32_t)FP_MAX_RMS_DB * FP_MAX_RMS_DB * gateways) {
+        return -1;
+    }
+
+    int best = room[0];
+    uint8_t most = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t votes = 0;
+        for (uint8_t j = 0; j < count; j++) {
+            votes += (room[j] == room[i]);
+        }
+        if (votes > most) {
+            most = votes;
+            best = room[i];
+        }
+    }
+    return best;
+}
+
+static bool _bench(uint16_t points)
+{
+    bool same = true;
+    uint32_t us = 0;
+
+    _build(points);
+    if (!fingerprint_ready()) {
+        printf("%u points: map not accepted\n", points);
+        return false;
+    }
+    for (unsigned q = 0; q < QUERIES; q++) {
+        uint8_t levels[GATEWAYS];
+        for (uint8_t g = 0; g < GATEWAYS; g++) {
+            levels[g] = _noisy(_center[q % ROOMS][g]);
+        }
+        _observe(GATEWAYS, levels);
+
+        uint32_t start = ztimer_now(ZTIMER_USEC);
+        int room = 0;
+        for (unsigned r = 0; r < BENCH_RUNS; r++) {
+            room = fingerprint_match();
+        }
+        us += ztimer_now(ZTIMER_USEC) - start;
+
+        int expected = _reference(GATEWAYS, points);
+        if (room != expected) {
+            printf("%u points, query %u: room %d, k-NN %d\n", points, q, room, expected);
+            same = false;
+        }
+    }
+
+    printf("%u points: %"PRIu32" us, %"PRIu32" ns per match\n", points, us,
+           (uint32_t)(((uint64_t)us * 1000) / (QUERIES * BENCH_RUNS)));
+    return same;
+}
+
+//two gateways: the nearest point is outvoted, a far query has no room
+static bool _vote(void)
+{
+    static const uint8_t points[][3] = {
+        { 1, 50, 80 },
+        { 2, 52, 80 },
+        { 2, 54, 80 },
+        { 1, 90, 40 },
+    };
+    static const uint8_t near[] = { 50, 80 };
+    static const uint8_t far[] = { 10, 10 };
+    uint32_t p = _header(2, 4);
+
+    memcpy(&_map[p], points, sizeof(points));
+    _write(p + sizeof(points));
+
+    _observe(2, near);
+    int room = fingerprint_match();
+    if (room != 2 || _reference(2, 4) != 2) {
+        printf("vote: room %d, expected 2\n", room);
+        return false;
+    }
+    _observe(2, far);
+    room = fingerprint_match();
+    if (room != -1) {
+        printf("far: room %d, expected none\n", room);
+        return false;
+    }
+    _observe(2, NULL);
+    return fingerprint_match() == -1;
+}
+
+int main(void)
+{
+    static const uint16_t sizes[] = { 100, 300, 1000 };
+    bool ok = true;
+
+    for (unsigned r = 0; r < ROOMS; r++) {
+        for (uint8_t g = 0; g < GATEWAYS; g++) {
+            _center[r][g] = 45 + _random() % 70;
+        }
+    }
+
+    printf("fingerprint_match, %u gateways, k %u, %u matches per map on %s\n",
+           GATEWAYS, FP_K, QUERIES * BENCH_RUNS, RIOT_BOARD);
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        if (sizes[i] <= FP_MAX_POINTS) {
+            ok = _bench(sizes[i]) && ok;
+        }
+    }
+    ok = _vote() && ok;
+
+    puts(ok ? "[SUCCESS]" : "[FAILED]");
+
+    return 0;
+}
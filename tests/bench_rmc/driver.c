@@ -0,0 +1,3 @@
+/* the driver below the GPS module, its I2C calls go to the simulated bus */
+#include "fake_periph.h"
+#include "xm1110.c"
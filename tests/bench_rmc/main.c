@@ -0,0 +1,165 @@
+/*
+ * Time of parsing RMC sentences, with minmea as readGPS did before and with
+ * parse_rmc_xm1110() now.
+ *
+ * The corpus is a track of BENCH_SENTENCES RMC sentences at 1 Hz, as the
+ * module prints them: a start without fix, then a slow walk that crosses
+ * midnight and the new year, and now and then a sentence with a wrong
+ * checksum as after a bad I2C read. The sentences are generated in chunks so
+ * that the corpus fits boards with little RAM, only the parsing is timed.
+ * Both parsers have to accept the same sentences and agree on the result.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ztimer.h"
+#include "minmea.h"
+
+#include "sensor_xm1110.h"
+
+#ifndef BENCH_SENTENCES
+#define BENCH_SENTENCES (10000)
+#endif
+
+#define CHUNK           (50)
+#define LINE_MAX        (84)
+#define START_TIME      (22 * 3600UL + 30 * 60UL)  /* 22:30:00 on 31/12/23 */
+#define NO_FIX          (90)        /* seconds to the first fix */
+#define BAD_EVERY       (97)        /* one wrong checksum in so many sentences */
+
+static char _lines[CHUNK][LINE_MAX];
+static size_t _len[CHUNK];
+static int32_t _lat = 50 * 600000L + 526000L;  /* 1e-4 minutes, 50°52.6' N */
+static int32_t _lon = 4 * 600000L + 421000L;   /* 1e-4 minutes, 4°42.1' E */
+static volatile int32_t _sink;
+
+static uint32_t _random(void)
+{
+    /* xorshift32, the same track on every run */
+    static uint32_t x = 2463534242UL;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+//sentence n of the track, without line ending
+static size_t _sentence(uint32_t n, char* s)
+{
+    uint32_t t = START_TIME + n;
+    uint32_t date = 311223;
+    if (t >= 86400) {
+        t -= 86400;
+        date = 10124;
+    }
+    uint32_t hhmmss = (t / 3600) * 10000 + ((t / 60) % 60) * 100 + t % 60;
+    int len;
+
+    if (n < NO_FIX) {
+        len = snprintf(s, LINE_MAX, "$GPRMC,%06lu.000,V,,,,,0.00,0.00,%06lu,,,N",
+                       (unsigned long)hhmmss, (unsigned long)date);
+    } else {
+        _lat += (int32_t)(_random() % 7) - 3;
+        _lon += (int32_t)(_random() % 9) - 4;
+        len = snprintf(s, LINE_MAX, "$GPRMC,%06lu.000,A,%02ld%02ld.%04ld,N,%03ld%02ld.%04ld,E,"
+                       "%lu.%02lu,%lu.%02lu,%06lu,,,A",
+                       (unsigned long)hhmmss, (long)(_lat / 600000), (long)((_lat / 10000) % 60),
+                       (long)(_lat % 10000), (long)(_lon / 600000), (long)((_lon / 10000) % 60),
+                       (long)(_lon % 10000), (unsigned long)(_random() % 3),
+                       (unsigned long)(_random() % 100), (unsigned long)(_random() % 360),
+                       (unsigned long)(_random() % 100), (unsigned long)date);
+    }
+    uint8_t cs = 0;
+    for (int i = 1; i < len; i++) {
+        cs ^= (uint8_t)s[i];
+    }
+    len += snprintf(&s[len], LINE_MAX - len, "*%02X", cs);
+    if (n % BAD_EVERY == BAD_EVERY - 1) {
+        s[10] ^= 0x01;  /* a digit of the time */
+    }
+    return len;
+}
+
+//what readGPS did per RMC sentence: parse, then rescale each coordinate
+//for the log and again for the fix
+static bool _minmea(const char* s, struct minmea_sentence_rmc* frame)
+{
+    if (minmea_sentence_id(s, false) != MINMEA_SENTENCE_RMC ||
+        !minmea_parse_rmc(frame, s) || !frame->valid) {
+        return false;
+    }
+    _sink = minmea_rescale(&frame->latitude, 100000);
+    _sink = minmea_rescale(&frame->longitude, 100000);
+    _sink = minmea_rescale(&frame->latitude, 100000);
+    _sink = minmea_rescale(&frame->longitude, 100000);
+    return true;
+}
+
+//ddmm.mmmm of minmea in micro-degrees, rounded as the single pass does
+static int32_t _udeg(const struct minmea_float* f)
+{
+    int64_t v = llabs(f->value);
+    int64_t deg = v / (100 * f->scale);
+    int64_t min = (v % (100 * f->scale)) * (1000000 / f->scale);
+    int64_t udeg = deg * 1000000 + (min + 30) / 60;
+    return (f->value < 0) ? -(int32_t)udeg : (int32_t)udeg;
+}
+
+static bool _same(const struct minmea_sentence_rmc* frame, const gps_rmc_t* rmc)
+{
+    int32_t dlat = _udeg(&frame->latitude) - rmc->latitude;
+    int32_t dlon = _udeg(&frame->longitude) - rmc->longitude;
+
+    return frame->time.hours * 3600UL + frame->time.minutes * 60UL + frame->time.seconds == rmc->time &&
+           frame->date.day * 10000UL + frame->date.month * 100UL + frame->date.year == rmc->date &&
+           abs(dlat) <= 1 && abs(dlon) <= 1;
+}
+
+int main(void)
+{
+    uint32_t us_minmea = 0, us_single = 0;
+    uint32_t fixes_minmea = 0, fixes_single = 0;
+    bool same = true;
+
+    printf("RMC parsing, %u sentences on %s\n", BENCH_SENTENCES, RIOT_BOARD);
+
+    for (uint32_t n = 0; n < BENCH_SENTENCES; n += CHUNK) {
+        unsigned count = (BENCH_SENTENCES - n < CHUNK) ? BENCH_SENTENCES - n : CHUNK;
+        for (unsigned i = 0; i < count; i++) {
+            _len[i] = _sentence(n + i, _lines[i]);
+        }
+
+        struct minmea_sentence_rmc frame;
+        uint32_t start = ztimer_now(ZTIMER_USEC);
+        for (unsigned i = 0; i < count; i++) {
+            fixes_minmea += _minmea(_lines[i], &frame);
+        }
+        us_minmea += ztimer_now(ZTIMER_USEC) - start;
+
+        gps_rmc_t rmc;
+        start = ztimer_now(ZTIMER_USEC);
+        for (unsigned i = 0; i < count; i++) {
+            fixes_single += parse_rmc_xm1110(_lines[i], _len[i], &rmc);
+        }
+        us_single += ztimer_now(ZTIMER_USEC) - start;
+
+        for (unsigned i = 0; i < count; i++) {
+            bool a = _minmea(_lines[i], &frame);
+            bool b = parse_rmc_xm1110(_lines[i], _len[i], &rmc);
+            if (a != b || (a && !_same(&frame, &rmc))) {
+                printf("%s: minmea %d, single pass %d\n", _lines[i], a, b);
+                same = false;
+            }
+        }
+    }
+
+    printf("minmea: %"PRIu32" us, %"PRIu32" ns per sentence, %"PRIu32" fixes\n", us_minmea,
+           (uint32_t)(((uint64_t)us_minmea * 1000) / BENCH_SENTENCES), fixes_minmea);
+    printf("single pass: %"PRIu32" us, %"PRIu32" ns per sentence, %"PRIu32" fixes\n", us_single,
+           (uint32_t)(((uint64_t)us_single * 1000) / BENCH_SENTENCES), fixes_single);
+
+    puts(same ? "[SUCCESS]" : "[FAILED]");
+
+    return 0;
+}
@@ -0,0 +1,2 @@
+/* the GPS module with the RMC parser under test */
+#include "sensor_xm1110.c"
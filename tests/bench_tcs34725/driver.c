@@ -0,0 +1,66 @@
+/* the driver under test, its I2C and GPIO calls go to the simulated bus */
+#include "fake_periph.h"
+#include "tcs34725.c"
+
+/*
+ * tcs34725_read() as it was before the reciprocals, for comparison: CPL is
+ * computed on every read and each channel divides by it.
+ */
+int bench_read_div(tcs34725_t *dev, tcs34725_data_t *data)
+{
+    uint8_t buf[8];
+    uint8_t status;
+
+    i2c_acquire(BUS);
+    if (i2c_read_reg(BUS, ADR, TCS34725_STATUS, &status, 0) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    if (!(status & TCS34725_STATUS_AVALID)) {
+        i2c_release(BUS);
+        return TCS34725_NODATA;
+    }
+    if (i2c_read_regs(BUS, ADR, (TCS34725_INC_TRANS | TCS34725_CDATA),
+                      buf, 8, 0) < 0) {
+        i2c_release(BUS);
+        return TCS34725_NOBUS;
+    }
+    i2c_release(BUS);
+
+    const tcs34725_calib_t *cal = &dev->calib;
+    int32_t rawc = ((uint16_t)buf[1] << 8) | buf[0];
+    int32_t tmpc = _trim(rawc, cal->dark[0], cal->gain[0]);
+    int32_t tmpr = _trim(((uint16_t)buf[3] << 8) | buf[2],
+                         cal->dark[1], cal->gain[1]);
+    int32_t tmpg = _trim(((uint16_t)buf[5] << 8) | buf[4],
+                         cal->dark[2], cal->gain[2]);
+    int32_t tmpb = _trim(((uint16_t)buf[7] << 8) | buf[6],
+                         cal->dark[3], cal->gain[3]);
+
+    int32_t ir = (tmpr + tmpg + tmpb - tmpc) >> 1;
+    tmpr -= ir;
+    tmpg -= ir;
+    tmpb -= ir;
+
+    int32_t ct = (tmpr > 0) ? (cal->ct_coef * tmpb) / tmpr + cal->ct_offset : 0;
+
+    int32_t gi = cal->r_coef * tmpr + cal->g_coef * tmpg + cal->b_coef * tmpb;
+    int32_t cpl = (dev->p.atime * dev->again) / dev->dgf_ga;
+    int32_t lux = gi / cpl;
+
+    uint32_t max = TCS34725_MAX_COUNT(dev->p.atime / TCS34725_ATIME_MIN);
+    bool saturated = (uint32_t)rawc > (max / 100) * TCS34725_AG_SATURATION_PCT;
+    bool dark = (rawc < TCS34725_AG_THRESHOLD_LOW) &&
+                (dev->again < 60 || dev->p.atime < TCS34725_ATIME_MAX);
+    data->valid = !saturated && !dark;
+
+    data->red = (tmpr < 0) ? 0 : (tmpr * 1000) / cpl;
+    data->green = (tmpg < 0) ? 0 : (tmpg * 1000) / cpl;
+    data->blue = (tmpb < 0) ? 0 : (tmpb * 1000) / cpl;
+    data->clear = (tmpc * 1000) / cpl;
+    data->lux = (lux < 0) ? 0 : lux;
+    data->dlux = data->lux * 10;
+    data->ct = (ct < 0) ? 0 : ct;
+
+    return TCS34725_OK;
+}
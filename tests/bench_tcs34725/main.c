@@ -0,0 +1,155 @@
+/*
+ * Time of tcs34725_read(), with a division by CPL per channel as before and
+ * with the precomputed reciprocal of the driver now.
+ *
+ * Both read the same raw values from the simulated bus, so the difference is
+ * the conversion. The time is taken with ZTIMER_USEC, and on cores with a DWT
+ * cycle counter (Cortex-M3 and up) in cycles as well. Cortex-M0 has no DWT
+ * and no hardware divider, the division path is the slow one there.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "ztimer.h"
+
+#include "fake_periph.h"
+#include "tcs34725.h"
+#include "tcs34725-internal.h"
+
+#ifndef BENCH_RUNS
+#define BENCH_RUNS      (1000)
+#endif
+
+#ifdef DWT_CTRL_CYCCNTENA_Msk
+#define BENCH_CYCLES    (1)
+#else
+#define BENCH_CYCLES    (0)
+#endif
+
+int bench_read_div(tcs34725_t *dev, tcs34725_data_t *data);
+
+typedef int (*read_fn_t)(tcs34725_t *dev, tcs34725_data_t *data);
+
+/* raw clear, red, green, blue, all valid at 4x and 200 ms */
+static const uint16_t _raw[][4] = {
+    { 20000,  9000,  8000,  5000 },
+    {   900,   400,   350,   250 },
+    { 45000, 21000, 17000,  9000 },
+    {  5000,  1900,  2100,  1500 },
+    { 31000, 10000, 14000, 11000 },
+    {   250,   120,    90,    70 },
+    { 12000,  6000,  4000,  3000 },
+    { 52000, 19000, 20000, 16000 },
+};
+
+#define RAW_NUMOF       (sizeof(_raw) / sizeof(_raw[0]))
+
+static const tcs34725_params_t _params = {
+    .i2c = I2C_DEV(0),
+    .addr = TCS34725_I2C_ADDRESS,
+    .atime = TCS34725_ATIME_DEFAULT,
+    .int_pin = GPIO_UNDEF,
+};
+
+static tcs34725_t _dev;
+static unsigned _sample;
+
+static int _read(uint16_t reg, uint8_t *data, size_t len)
+{
+    const uint16_t *raw = _raw[_sample % RAW_NUMOF];
+
+    reg &= 0x1f;
+    if (reg == TCS34725_ID) {
+        data[0] = TCS34725_ID_VALUE;
+    }
+    else if (reg == TCS34725_STATUS) {
+        data[0] = TCS34725_STATUS_AVALID;
+    }
+    else if (reg == TCS34725_CDATA) {
+        for (size_t i = 0; i < len; i++) {
+            data[i] = (i & 1) ? raw[i / 2] >> 8 : raw[i / 2] & 0xff;
+        }
+    }
+    else {
+        memset(data, 0, len);
+    }
+    return 0;
+}
+
+static int _write(uint16_t reg, const uint8_t *data, size_t len)
+{
+    (void)reg; (void)data; (void)len;
+    return 0;
+}
+
+static const fake_i2c_dev_t _model = {
+    .addr = TCS34725_I2C_ADDRESS,
+    .read = _read,
+    .write = _write,
+};
+
+static void _bench(const char *name, read_fn_t fn)
+{
+    tcs34725_data_t data;
+    uint32_t cycles = 0;
+
+#if BENCH_CYCLES
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    uint32_t start = ztimer_now(ZTIMER_USEC);
+    for (_sample = 0; _sample < BENCH_RUNS; _sample++) {
+        fn(&_dev, &data);
+    }
+    uint32_t us = ztimer_now(ZTIMER_USEC) - start;
+#if BENCH_CYCLES
+    cycles = DWT->CYCCNT / BENCH_RUNS;
+#endif
+
+    printf("%s: %"PRIu32" us, %"PRIu32" ns per read", name, us,
+           (uint32_t)(((uint64_t)us * 1000) / BENCH_RUNS));
+    if (BENCH_CYCLES) {
+        printf(", %"PRIu32" cycles per read", cycles);
+    }
+    printf("\n");
+}
+
+//both paths give the same result, up to the rounding of the integer CPL
+static bool _compare(void)
+{
+    bool same = true;
+
+    for (_sample = 0; _sample < RAW_NUMOF; _sample++) {
+        tcs34725_data_t div, recip;
+        bench_read_div(&_dev, &div);
+        tcs34725_read(&_dev, &recip);
+        uint32_t tol = div.lux / 100 + 1;
+        uint32_t lux = recip.dlux / 10;
+        if ((lux > div.lux + tol) || (lux + tol < div.lux) ||
+            (recip.ct != div.ct) || (recip.valid != div.valid)) {
+            printf("sample %u: lux %"PRIu32"/%"PRIu32" ct %"PRIu32"/%"PRIu32"\n",
+                   _sample, div.lux, lux, div.ct, recip.ct);
+            same = false;
+        }
+    }
+    return same;
+}
+
+int main(void)
+{
+    fake_i2c_attach(&_model);
+    if (tcs34725_init(&_dev, &_params) != TCS34725_OK) {
+        puts("[FAILED] init");
+        return 1;
+    }
+
+    printf("tcs34725_read, %u reads on %s\n", BENCH_RUNS, RIOT_BOARD);
+    _bench("division", bench_read_div);
+    _bench("reciprocal", tcs34725_read);
+
+    puts(_compare() ? "[SUCCESS]" : "[FAILED]");
+
+    return 0;
+}
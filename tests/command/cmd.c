@@ -0,0 +1,3 @@
+/* the command parser and the settings check under test */
+#include "command.c"
+#include "settings.c"
@@ -0,0 +1,329 @@
+/*
+ * Backend commands: the parser and its checks.
+ *
+ * A corpus of writes checks the decoding of each command and that a write
+ * is refused as a whole: unknown opcodes, cut off arguments and settings
+ * out of range. The fuzz test then runs random writes, built from commands
+ * with arguments at and around their limits, random bytes and random edits
+ * of both. Every result is compared with the framing rules of command.h,
+ * accepted settings have to be valid and running a write again on its own
+ * result must not change it.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "embUnit.h"
+
+#include "command.h"
+#include "settings.h"
+#include "LSM303AGR.h"
+
+#ifndef FUZZ_RUNS
+#define FUZZ_RUNS       (100000)
+#endif
+
+#define W(...)          { .data = { __VA_ARGS__ }, .len = sizeof((uint8_t[]){ __VA_ARGS__ }) }
+
+typedef struct {
+    uint8_t data[CMD_MAX];
+    uint8_t len;
+} write_t;
+
+static const settings_t _current = SETTINGS_DEFAULT;
+
+/* writes that are refused, with the error */
+static const struct {
+    write_t w;
+    int res;
+} _refused[] = {
+    { W(0x00), -EINVAL },
+    { W(0x09), -EINVAL },
+    { W(0xff), -EINVAL },
+    { W(CMD_FLUSH, 0x42), -EINVAL },
+    { W(CMD_INTERVAL), -EMSGSIZE },
+    { W(CMD_INTERVAL, 0x10, 0x27, 0x00, 0x00), -EMSGSIZE },
+    { W(CMD_ALERTS, 0x10, 0x0e, 0x70), -EMSGSIZE },
+    { W(CMD_FALL, 0x00, 0x01), -EMSGSIZE },
+    { W(CMD_LIGHT, 0x00), -EMSGSIZE },
+    { W(CMD_GPS), -EMSGSIZE },
+    { W(CMD_GPS, GPS_POLICY_OFF, CMD_FALL, 0x40), -EMSGSIZE },
+    /* interval 999 ms, 3600001 ms, 0 and 61 loops per uplink */
+    { W(CMD_INTERVAL, 0xe7, 0x03, 0x00, 0x00, 1), -ERANGE },
+    { W(CMD_INTERVAL, 0x81, 0xee, 0x36, 0x00, 1), -ERANGE },
+    { W(CMD_INTERVAL, 0x10, 0x27, 0x00, 0x00, 0), -ERANGE },
+    { W(CMD_INTERVAL, 0x10, 0x27, 0x00, 0x00, 61), -ERANGE },
+    /* -45.01 and 130.01 degrees, -0.01 and 100.01 % */
+    { W(CMD_ALERTS, 0x6b, 0xee, 0x00, 0x00), -ERANGE },
+    { W(CMD_ALERTS, 0xc9, 0x32, 0x00, 0x00), -ERANGE },
+    { W(CMD_ALERTS, 0x00, 0x00, 0xff, 0xff), -ERANGE },
+    { W(CMD_ALERTS, 0x00, 0x00, 0x11, 0x27), -ERANGE },
+    /* 15 and 2033 mg, 128 samples */
+    { W(CMD_FALL, 0x0f, 0x00, 1), -ERANGE },
+    { W(CMD_FALL, 0xf1, 0x07, 1), -ERANGE },
+    { W(CMD_FALL, 0x00, 0x01, 128), -ERANGE },
+    { W(CMD_LIGHT, 0x00, 0x01, 16), -ERANGE },
+    { W(CMD_GPS, GPS_POLICY_AUTO + 1), -ERANGE },
+    /* a good command does not make up for a bad one */
+    { W(CMD_FLUSH, CMD_GPS, 0x07), -ERANGE },
+    { W(CMD_REBOOT, CMD_LIGHT, 0x00, 0x01, 3, 0x0a), -EINVAL },
+};
+
+#define REFUSED_NUMOF   (sizeof(_refused) / sizeof(_refused[0]))
+
+/* arguments per opcode as in command.h, -1 for unknown opcodes */
+static const int8_t _args[] = { -1, 5, 4, 3, 3, 1, 0, 0, 0 };
+
+static uint32_t _random(void)
+{
+    /* xorshift32, the same writes on every run */
+    static uint32_t x = 2463534242UL;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+//what the framing rules alone make of a write, 0 if it is well formed
+static int _framing(const uint8_t* buf, uint8_t len)
+{
+    for (uint8_t pos = 0; pos < len;) {
+        uint8_t op = buf[pos++];
+        if (op >= sizeof(_args) || _args[op] < 0) {
+            return -EINVAL;
+        }
+        if (len - pos < _args[op]) {
+            return -EMSGSIZE;
+        }
+        pos += _args[op];
+    }
+    return 0;
+}
+
+static bool _same(const settings_t* a, const settings_t* b)
+{
+    return a->interval_ms == b->interval_ms && a->send_every == b->send_every &&
+           a->temp_alert == b->temp_alert && a->hum_alert == b->hum_alert &&
+           a->fall_mg == b->fall_mg && a->fall_samples == b->fall_samples &&
+           a->light_threshold == b->light_threshold &&
+           a->light_persistence == b->light_persistence &&
+           a->gps_policy == b->gps_policy;
+}
+
+static void _put16(write_t* w, uint16_t v)
+{
+    w->data[w->len++] = v & 0xff;
+    w->data[w->len++] = v >> 8;
+}
+
+//a value near one of the limits of a setting
+static uint32_t _near(uint32_t min, uint32_t max)
+{
+    uint32_t v = (_random() & 1) ? min : max;
+    return v + (_random() % 3) - 1;
+}
+
+//a write of random commands with arguments around their limits
+static void _commands(write_t* w)
+{
+    w->len = 0;
+    for (unsigned n = 1 + _random() % 4; n > 0 && w->len < CMD_MAX - 6; n--) {
+        uint8_t op = 1 + _random() % (sizeof(_args) - 1);
+        w->data[w->len++] = op;
+        switch (op) {
+            case CMD_INTERVAL: {
+                uint32_t ms = _near(SETTINGS_INTERVAL_MIN, SETTINGS_INTERVAL_MAX);
+                _put16(w, ms & 0xffff);
+                _put16(w, ms >> 16);
+                w->data[w->len++] = _near(1, SETTINGS_SEND_MAX);
+                break;
+            }
+            case CMD_ALERTS:
+                _put16(w, _near(SETTINGS_TEMP_MIN, SETTINGS_TEMP_MAX));
+                _put16(w, _near(0, SETTINGS_HUM_MAX));
+                break;
+            case CMD_FALL:
+                _put16(w, _near(SETTINGS_FALL_MG_MIN, SETTINGS_FALL_MG_MAX));
+                w->data[w->len++] = _near(0, SETTINGS_FALL_DUR_MAX);
+                break;
+            case CMD_LIGHT:
+                _put16(w, _random());
+                w->data[w->len++] = _near(0, SETTINGS_PERS_MAX);
+                break;
+            case CMD_GPS:
+                w->data[w->len++] = _near(GPS_POLICY_OFF, GPS_POLICY_AUTO);
+                break;
+        }
+    }
+}
+
+static void _edit(write_t* w)
+{
+    for (unsigned edits = 1 + _random() % 2; edits > 0 && w->len > 0; edits--) {
+        uint8_t at = _random() % w->len;
+        switch (_random() % 3) {
+            case 0:
+                w->data[at] = _random();
+                break;
+            case 1:
+                w->len = at;
+                break;
+            default:
+                if (w->len < CMD_MAX) {
+                    memmove(&w->data[at + 1], &w->data[at], w->len - at);
+                    w->data[at] = _random() % 10;
+                    w->len++;
+                }
+                break;
+        }
+    }
+}
+
+static void test_command_decode(void)
+{
+    command_result_t r;
+    const write_t w = W(CMD_INTERVAL, 0x60, 0xea, 0x00, 0x00, 10,
+                        CMD_ALERTS, 0x8c, 0x0a, 0x70, 0x17,
+                        CMD_FALL, 0x90, 0x01, 3,
+                        CMD_LIGHT, 0x34, 0x12, 5,
+                        CMD_GPS, GPS_POLICY_OFF);
+
+    TEST_ASSERT_EQUAL_INT(0, command_run(w.data, w.len, &_current, &r));
+    TEST_ASSERT_EQUAL_INT(60000, r.settings.interval_ms);
+    TEST_ASSERT_EQUAL_INT(10, r.settings.send_every);
+    TEST_ASSERT_EQUAL_INT(2700, r.settings.temp_alert);
+    TEST_ASSERT_EQUAL_INT(6000, r.settings.hum_alert);
+    TEST_ASSERT_EQUAL_INT(400, r.settings.fall_mg);
+    TEST_ASSERT_EQUAL_INT(3, r.settings.fall_samples);
+    TEST_ASSERT_EQUAL_INT(0x1234, r.settings.light_threshold);
+    TEST_ASSERT_EQUAL_INT(5, r.settings.light_persistence);
+    TEST_ASSERT_EQUAL_INT(GPS_POLICY_OFF, r.settings.gps_policy);
+    TEST_ASSERT(!r.flush_log && !r.reboot);
+
+    /* the limits themselves are accepted, a negative alert too */
+    const write_t limits = W(CMD_INTERVAL, 0x80, 0xee, 0x36, 0x00, SETTINGS_SEND_MAX,
+                             CMD_ALERTS, 0x6c, 0xee, 0x10, 0x27,
+                             CMD_FALL, 0xf0, 0x07, SETTINGS_FALL_DUR_MAX);
+    TEST_ASSERT_EQUAL_INT(0, command_run(limits.data, limits.len, &_current, &r));
+    TEST_ASSERT_EQUAL_INT(SETTINGS_INTERVAL_MAX, r.settings.interval_ms);
+    TEST_ASSERT_EQUAL_INT(SETTINGS_TEMP_MIN, r.settings.temp_alert);
+    TEST_ASSERT_EQUAL_INT(SETTINGS_HUM_MAX, r.settings.hum_alert);
+    TEST_ASSERT_EQUAL_INT(SETTINGS_FALL_MG_MAX, r.settings.fall_mg);
+}
+
+static void test_command_flags(void)
+{
+    command_result_t r;
+    const write_t defaults = W(CMD_GPS, GPS_POLICY_OFF, CMD_DEFAULTS, CMD_FLUSH);
+    const write_t reboot = W(CMD_REBOOT);
+
+    TEST_ASSERT_EQUAL_INT(0, command_run(defaults.data, defaults.len, &_current, &r));
+    TEST_ASSERT(_same(&_current, &r.settings));
+    TEST_ASSERT(r.flush_log && !r.reboot);
+
+    TEST_ASSERT_EQUAL_INT(0, command_run(reboot.data, reboot.len, &_current, &r));
+    TEST_ASSERT(r.flush_log && r.reboot);
+
+    /* an empty write changes nothing */
+    TEST_ASSERT_EQUAL_INT(0, command_run(reboot.data, 0, &_current, &r));
+    TEST_ASSERT(_same(&_current, &r.settings));
+    TEST_ASSERT(!r.flush_log && !r.reboot);
+}
+
+static void test_command_refused(void)
+{
+    command_result_t r;
+
+    for (unsigned i = 0; i < REFUSED_NUMOF; i++) {
+        int res = command_run(_refused[i].w.data, _refused[i].w.len, &_current, &r);
+        if (res != _refused[i].res) {
+            printf("write %u: %d\n", i, res);
+        }
+        TEST_ASSERT_EQUAL_INT(_refused[i].res, res);
+    }
+}
+
+static void test_command_post(void)
+{
+    uint8_t data[CMD_MAX + 1] = { CMD_FLUSH };
+    uint8_t buf[CMD_MAX];
+
+    TEST_ASSERT_EQUAL_INT(-EINVAL, command_post(1, 1, data));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, command_post(0, 0, data));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, command_post(0, CMD_MAX + 1, data));
+    TEST_ASSERT_EQUAL_INT(0, command_take(buf));
+
+    /* one write at a time until the main thread takes it */
+    TEST_ASSERT_EQUAL_INT(0, command_post(0, CMD_MAX, data));
+    TEST_ASSERT_EQUAL_INT(-EBUSY, command_post(0, 1, data));
+    TEST_ASSERT_EQUAL_INT(CMD_MAX, command_take(buf));
+    TEST_ASSERT_EQUAL_INT(CMD_FLUSH, buf[0]);
+    TEST_ASSERT_EQUAL_INT(0, command_take(buf));
+}
+
+static void test_command_fuzz(void)
+{
+    unsigned accepted = 0;
+
+    for (unsigned run = 0; run < FUZZ_RUNS; run++) {
+        write_t w;
+        switch (run % 3) {
+            case 0:
+                _commands(&w);
+                break;
+            case 1:
+                _commands(&w);
+                _edit(&w);
+                break;
+            default:
+                w.len = _random() % (CMD_MAX + 1);
+                for (uint8_t i = 0; i < w.len; i++) {
+                    w.data[i] = (_random() & 1) ? _random() % 10 : _random();
+                }
+                break;
+        }
+
+        command_result_t r, again;
+        int res = command_run(w.data, w.len, &_current, &r);
+        int framing = _framing(w.data, w.len);
+        if (framing) {
+            TEST_ASSERT_EQUAL_INT(framing, res);
+            continue;
+        }
+        if (res) {
+            TEST_ASSERT_EQUAL_INT(-ERANGE, res);
+            TEST_ASSERT(!settings_valid(&r.settings));
+            continue;
+        }
+        accepted++;
+        TEST_ASSERT(settings_valid(&r.settings));
+        TEST_ASSERT(!r.reboot || r.flush_log);
+        TEST_ASSERT_EQUAL_INT(0, command_run(w.data, w.len, &r.settings, &again));
+        TEST_ASSERT(_same(&r.settings, &again.settings));
+    }
+    printf("%u of %u writes accepted\n", accepted, FUZZ_RUNS);
+}
+
+Test *tests_command(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_command_decode),
+        new_TestFixture(test_command_flags),
+        new_TestFixture(test_command_refused),
+        new_TestFixture(test_command_post),
+        new_TestFixture(test_command_fuzz),
+    };
+
+    EMB_UNIT_TESTCALLER(command_tests, NULL, NULL, fixtures);
+
+    return (Test *)&command_tests;
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_command());
+    TESTS_END();
+
+    return 0;
+}
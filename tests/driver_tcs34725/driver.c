@@ -0,0 +1,3 @@
+/* the driver under test, its I2C and GPIO calls go to the simulated bus */
+#include "fake_periph.h"
+#include "tcs34725.c"
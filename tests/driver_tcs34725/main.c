@@ -0,0 +1,335 @@
+/*
+ * Clear channel interrupt and auto-range of the TCS34725 driver on a
+ * simulated bus.
+ *
+ * The model below keeps the register file of the sensor. Each call of
+ * _cycle() is one integration cycle: the clear count follows the simulated
+ * light level, gain and integration time, and INT is pulled low once the
+ * count is outside the AILT..AIHT window for the cycles set by APERS. INT
+ * stays low until the CICLR command, as on the sensor.
+ */
+#include <string.h>
+
+#include "embUnit.h"
+
+#include "fake_periph.h"
+#include "tcs34725.h"
+#include "tcs34725-internal.h"
+
+#define INT_PIN         GPIO_PIN(0, 1)
+#define BRIGHT          (10)    /* counts per cycle at 1x, above the threshold */
+#define DARK            (1)     /* counts per cycle at 1x, below the threshold */
+#define THRESHOLD       (1000)
+
+static const tcs34725_params_t _params = {
+    .i2c = I2C_DEV(0),
+    .addr = TCS34725_I2C_ADDRESS,
+    .atime = TCS34725_ATIME_DEFAULT,
+    .int_pin = INT_PIN,
+};
+
+static tcs34725_t _dev;
+static uint8_t _reg[0x20];
+static uint32_t _light;         /* clear counts per cycle at 1x gain */
+static unsigned _out;           /* cycles in a row outside the window */
+static unsigned _ciclr;
+static unsigned _alerts;
+static bool _nack_aen;         /* refuse to start an integration cycle */
+
+static const uint8_t _gains[] = { 1, 4, 16, 60 };
+
+static uint16_t _reg16(uint8_t reg)
+{
+    return _reg[reg] | (_reg[reg + 1] << 8);
+}
+
+static void _cycle(void)
+{
+    unsigned cycles = 256 - _reg[TCS34725_ATIME];
+    uint32_t count = _light * _gains[_reg[TCS34725_CONTROL] & TCS34725_CONTROL_AGAIN_MASK] *
+                     cycles;
+
+    if (count > TCS34725_MAX_COUNT(cycles)) {
+        count = TCS34725_MAX_COUNT(cycles);
+    }
+    for (unsigned i = 0; i < 4; i++) {
+        uint16_t val = (i == 0) ? count : count / 3;
+        _reg[TCS34725_CDATA + 2 * i] = val & 0xff;
+        _reg[TCS34725_CDATA + 2 * i + 1] = val >> 8;
+    }
+    _reg[TCS34725_STATUS] |= TCS34725_STATUS_AVALID;
+
+    if (!(_reg[TCS34725_ENABLE] & TCS34725_ENABLE_AIEN)) {
+        return;
+    }
+    if (count < _reg16(TCS34725_AILTL) || count > _reg16(TCS34725_AIHTL)) {
+        _out++;
+    }
+    else {
+        _out = 0;
+    }
+    unsigned apers = _reg[TCS34725_PERS] & TCS34725_PERS_APERS_MASK;
+    unsigned needed = (apers == 0) ? 1 : (apers <= 3) ? apers : 5 * (apers - 3);
+    if (_out >= needed && !(_reg[TCS34725_STATUS] & TCS34725_STATUS_AINT)) {
+        _reg[TCS34725_STATUS] |= TCS34725_STATUS_AINT;
+        fake_gpio_set(INT_PIN, 0);
+    }
+}
+
+static int _read(uint16_t reg, uint8_t *data, size_t len)
+{
+    if (reg == FAKE_I2C_NOREG) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        data[i] = _reg[(reg + i) & 0x1f];
+    }
+    return 0;
+}
+
+static int _write(uint16_t reg, const uint8_t *data, size_t len)
+{
+    if (reg == FAKE_I2C_NOREG) {
+        if (len != 1 || data[0] != TCS34725_SF_CICLR) {
+            return -1;
+        }
+        _ciclr++;
+        _reg[TCS34725_STATUS] &= ~TCS34725_STATUS_AINT;
+        fake_gpio_set(INT_PIN, 1);
+        return 0;
+    }
+    reg &= 0x1f;
+    if (_nack_aen && reg == TCS34725_ENABLE && (data[0] & TCS34725_ENABLE_AEN)) {
+        return -1;
+    }
+    uint8_t en = _reg[TCS34725_ENABLE];
+    for (size_t i = 0; i < len; i++) {
+        _reg[(reg + i) & 0x1f] = data[i];
+    }
+    /* a one-shot read restarts the integration by setting AEN */
+    if (reg == TCS34725_ENABLE && !(en & TCS34725_ENABLE_AEN) &&
+        (data[0] & TCS34725_ENABLE_AEN)) {
+        _cycle();
+    }
+    return 0;
+}
+
+static const fake_i2c_dev_t _model = {
+    .addr = TCS34725_I2C_ADDRESS,
+    .read = _read,
+    .write = _write,
+};
+
+static void _cb(void *arg)
+{
+    (void)arg;
+    _alerts++;
+}
+
+static void set_up(void)
+{
+    memset(_reg, 0, sizeof(_reg));
+    _reg[TCS34725_ID] = TCS34725_ID_VALUE;
+    _light = DARK;
+    _out = 0;
+    _ciclr = 0;
+    _alerts = 0;
+    fake_i2c_attach(&_model);
+    tcs34725_init(&_dev, &_params);
+}
+
+static void test_init(void)
+{
+    TEST_ASSERT_EQUAL_INT(TCS34725_ATIME_TO_REG(TCS34725_ATIME_DEFAULT), _reg[TCS34725_ATIME]);
+    TEST_ASSERT_EQUAL_INT(TCS34725_CONTROL_AGAIN_4, _reg[TCS34725_CONTROL]);
+    TEST_ASSERT_EQUAL_INT(TCS34725_ENABLE_AEN | TCS34725_ENABLE_PON, _reg[TCS34725_ENABLE]);
+    TEST_ASSERT_EQUAL_INT(0, fake_i2c_stats()->acquired);
+}
+
+static void test_threshold_registers(void)
+{
+    TEST_ASSERT_EQUAL_INT(TCS34725_OK, tcs34725_set_threshold(&_dev, 100, THRESHOLD, 2));
+    TEST_ASSERT_EQUAL_INT(100, _reg16(TCS34725_AILTL));
+    TEST_ASSERT_EQUAL_INT(THRESHOLD, _reg16(TCS34725_AIHTL));
+    TEST_ASSERT_EQUAL_INT(2, _reg[TCS34725_PERS]);
+
+    /* APERS is 4 bits wide */
+    TEST_ASSERT_EQUAL_INT(TCS34725_OK, tcs34725_set_threshold(&_dev, 0, 0xffff, 0x1f));
+    TEST_ASSERT_EQUAL_INT(0, _reg16(TCS34725_AILTL));
+    TEST_ASSERT_EQUAL_INT(0xffff, _reg16(TCS34725_AIHTL));
+    TEST_ASSERT_EQUAL_INT(0x0f, _reg[TCS34725_PERS]);
+}
+
+static void test_enable_int(void)
+{
+    /* a stale interrupt from before is dropped */
+    _reg[TCS34725_STATUS] |= TCS34725_STATUS_AINT;
+    TEST_ASSERT_EQUAL_INT(TCS34725_OK, tcs34725_enable_int(&_dev, _cb, NULL));
+    TEST_ASSERT_EQUAL_INT(1, _ciclr);
+    TEST_ASSERT(!(_reg[TCS34725_STATUS] & TCS34725_STATUS_AINT));
+    TEST_ASSERT(_reg[TCS34725_ENABLE] & TCS34725_ENABLE_AIEN);
+
+    /* open drain, active low */
+    TEST_ASSERT(fake_gpio_int()->pin == INT_PIN);
+    TEST_ASSERT_EQUAL_INT(GPIO_IN_PU, fake_gpio_int()->mode);
+    TEST_ASSERT_EQUAL_INT(GPIO_FALLING, fake_gpio_int()->flank);
+    TEST_ASSERT(fake_gpio_int()->enabled);
+}
+
+static void test_persistence(void)
+{
+    tcs34725_set_threshold(&_dev, 0, THRESHOLD, 2);
+    tcs34725_enable_int(&_dev, _cb, NULL);
+
+    for (int i = 0; i < 5; i++) {
+        _cycle();
+    }
+    TEST_ASSERT_EQUAL_INT(0, _alerts);
+
+    /* two bright cycles in a row are needed */
+    _light = BRIGHT;
+    _cycle();
+    TEST_ASSERT_EQUAL_INT(0, _alerts);
+    _cycle();
+    TEST_ASSERT_EQUAL_INT(1, _alerts);
+
+    /* INT stays latched while it is bright */
+    for (int i = 0; i < 5; i++) {
+        _cycle();
+    }
+    TEST_ASSERT_EQUAL_INT(1, _alerts);
+
+    /* re-armed once dark, the next exposure interrupts again */
+    _light = DARK;
+    _cycle();
+    TEST_ASSERT_EQUAL_INT(TCS34725_OK, tcs34725_clear_int(&_dev));
+    _light = BRIGHT;
+    _cycle();
+    TEST_ASSERT_EQUAL_INT(1, _alerts);
+    _cycle();
+    TEST_ASSERT_EQUAL_INT(2, _alerts);
+}
+
+static void test_disable_int(void)
+{
+    tcs34725_set_threshold(&_dev, 0, THRESHOLD, 0);
+    tcs34725_enable_int(&_dev, _cb, NULL);
+    TEST_ASSERT_EQUAL_INT(TCS34725_OK, tcs34725_disable_int(&_dev));
+    TEST_ASSERT(!(_reg[TCS34725_ENABLE] & TCS34725_ENABLE_AIEN));
+    TEST_ASSERT(!fake_gpio_int()->enabled);
+
+    _light = BRIGHT;
+    _cycle();
+    _cycle();
+    TEST_ASSERT_EQUAL_INT(0, _alerts);
+}
+
+static void test_wait(void)
+{
+    /* 5 s needs the 12x WLONG multiplier */
+    TEST_ASSERT_EQUAL_INT(TCS34725_OK, tcs34725_set_wait(&_dev, 5000000));
+    TEST_ASSERT_EQUAL_INT(TCS34725_CONFIG_WLONG, _reg[TCS34725_CONFIG]);
+    TEST_ASSERT_EQUAL_INT(256 - 173, _reg[TCS34725_WTIME]);
+    TEST_ASSERT(_reg[TCS34725_ENABLE] & TCS34725_ENABLE_WEN);
+
+    TEST_ASSERT_EQUAL_INT(TCS34725_OK, tcs34725_set_wait(&_dev, 0));
+    TEST_ASSERT(!(_reg[TCS34725_ENABLE] & TCS34725_ENABLE_WEN));
+}
+
+static void test_saturation_step(void)
+{
+    tcs34725_data_t data;
+
+    /* saturated at 4x, 83 cycles but only 190 counts, dark, at 1x, 1 cycle */
+    _light = 190;
+    TEST_ASSERT_EQUAL_INT(TCS34725_OK, tcs34725_read_oneshot(&_dev, &data));
+    TEST_ASSERT(data.valid);
+    TEST_ASSERT_EQUAL_INT(1, _dev.again);
+    TEST_ASSERT_EQUAL_INT(10 * TCS34725_ATIME_MIN, _dev.p.atime);
+    TEST_ASSERT(data.lux > 0);
+    TEST_ASSERT_EQUAL_INT(data.dlux / 10, data.lux);
+
+    /* full sunlight walks down to the least sensitive range */
+    _light = 5000;
+    tcs34725_read_oneshot(&_dev, &data);
+    TEST_ASSERT_EQUAL_INT(1, _dev.again);
+    TEST_ASSERT_EQUAL_INT(TCS34725_ATIME_MIN, _dev.p.atime);
+    TEST_ASSERT_EQUAL_INT(0, fake_i2c_stats()->acquired);
+}
+
+static void test_threshold_rescale(void)
+{
+    tcs34725_data_t data;
+
+    tcs34725_set_threshold(&_dev, 0, THRESHOLD, 2);
+    TEST_ASSERT_EQUAL_INT(THRESHOLD, _reg16(TCS34725_AIHTL));
+
+    /* 1x, 10 cycles is 33.2 times less sensitive than 4x, 83 cycles */
+    _light = 190;
+    tcs34725_read_oneshot(&_dev, &data);
+    TEST_ASSERT_EQUAL_INT(10 * TCS34725_ATIME_MIN, _dev.p.atime);
+    TEST_ASSERT_EQUAL_INT((THRESHOLD * 10) / 332, _reg16(TCS34725_AIHTL));
+
+    /* 60x, 256 cycles, scaled up to the same light level */
+    _light = DARK;
+    tcs34725_read_oneshot(&_dev, &data);
+    TEST_ASSERT_EQUAL_INT(60, _dev.again);
+    TEST_ASSERT_EQUAL_INT((THRESHOLD * 60 * 256) / 332, _reg16(TCS34725_AIHTL));
+    TEST_ASSERT_EQUAL_INT(0, _reg16(TCS34725_AILTL));
+
+    /* the interrupt still fires at the same light level */
+    tcs34725_enable_int(&_dev, _cb, NULL);
+    _light = THRESHOLD / 332;
+    _cycle();
+    _cycle();
+    TEST_ASSERT_EQUAL_INT(0, _alerts);
+    _light = THRESHOLD / 332 + 1;
+    _cycle();
+    _cycle();
+    TEST_ASSERT_EQUAL_INT(1, _alerts);
+}
+
+static void test_bus_error(void)
+{
+    fake_i2c_fail(1);
+    TEST_ASSERT_EQUAL_INT(TCS34725_NOBUS, tcs34725_set_threshold(&_dev, 0, THRESHOLD, 2));
+    TEST_ASSERT_EQUAL_INT(0, fake_i2c_stats()->acquired);
+    fake_i2c_fail(1);
+    TEST_ASSERT_EQUAL_INT(TCS34725_NOBUS, tcs34725_enable_int(&_dev, _cb, NULL));
+    TEST_ASSERT_EQUAL_INT(0, fake_i2c_stats()->acquired);
+
+    /* a one-shot read that cannot start the integration cycle */
+    tcs34725_data_t data;
+    _nack_aen = true;
+    TEST_ASSERT_EQUAL_INT(TCS34725_NOBUS, tcs34725_read_oneshot(&_dev, &data));
+    _nack_aen = false;
+    TEST_ASSERT_EQUAL_INT(0, fake_i2c_stats()->acquired);
+}
+
+static Test *tests_tcs34725(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_init),
+        new_TestFixture(test_threshold_registers),
+        new_TestFixture(test_enable_int),
+        new_TestFixture(test_persistence),
+        new_TestFixture(test_disable_int),
+        new_TestFixture(test_wait),
+        new_TestFixture(test_saturation_step),
+        new_TestFixture(test_threshold_rescale),
+        new_TestFixture(test_bus_error),
+    };
+
+    EMB_UNIT_TESTCALLER(tcs34725_tests, set_up, NULL, fixtures);
+
+    return (Test *)&tcs34725_tests;
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_tcs34725());
+    TESTS_END();
+
+    return 0;
+}
@@ -0,0 +1,3 @@
+/* the driver under test, its I2C calls go to the simulated bus */
+#include "fake_periph.h"
+#include "xm1110.c"
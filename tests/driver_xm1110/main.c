@@ -0,0 +1,338 @@
+/*
+ * PMTK commands and power modes of the XM1110 driver on a simulated bus.
+ *
+ * The model below takes the bytes written to the module as NMEA frames,
+ * rejects frames with a wrong checksum as the module does, and answers every
+ * accepted PMTK command with a $PMTK001 acknowledge. In standby it does not
+ * answer: the wake bytes written to it are counted and it resumes its NMEA
+ * output after the configured number of them.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "embUnit.h"
+
+#include "fake_periph.h"
+#include "ztimer.h"
+#include "xm1110.h"
+#include "xm1110_internal.h"
+
+#define OUT_MAX         (512)
+#define FRAME_MAX       (96)
+#define RMC             "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W"
+
+static const xm1110_params_t _params = {
+    .i2c_bus = I2C_DEV(0),
+    .i2c_addr = XM1110_I2C_ADDRESS,
+    .r_addr = XM1110_REG_ADDRESS_R,
+    .w_addr = XM1110_REG_ADDRESS_W,
+};
+
+static xm1110_t _dev;
+
+static char _out[OUT_MAX];          /* output buffer of the module */
+static size_t _out_len;
+static size_t _out_pos;
+static char _frame[FRAME_MAX];      /* frame being written */
+static size_t _frame_len;
+static char _last[FRAME_MAX];       /* last accepted frame */
+static unsigned _frames;
+static unsigned _bad_frames;
+static int _ack_flag;               /* flag of the acknowledges, -1 for none */
+static bool _standby;
+static unsigned _wake_after;        /* wake bytes needed, 0 never wakes */
+static unsigned _wake_bytes;
+static unsigned _epo_sets;
+
+static uint8_t _checksum(const char *s, size_t len)
+{
+    uint8_t cs = 0;
+    for (size_t i = 0; i < len; i++) {
+        cs ^= (uint8_t)s[i];
+    }
+    return cs;
+}
+
+static void _emit(const char *body)
+{
+    _out_len += snprintf(&_out[_out_len], sizeof(_out) - _out_len, "$%s*%02X\r\n",
+                         body, _checksum(body, strlen(body)));
+}
+
+//a frame is $<body>*<two hex digits>\r\n, the checksum covers the body
+static void _command(void)
+{
+    char *star = memchr(_frame, '*', _frame_len);
+    if (_frame[0] != '$' || !star || star + 5 != &_frame[_frame_len] ||
+        star[3] != '\r' || star[4] != '\n' ||
+        strtoul((char[]){ star[1], star[2], 0 }, NULL, 16) !=
+        _checksum(&_frame[1], star - &_frame[1])) {
+        _bad_frames++;
+        return;
+    }
+    _frames++;
+    memcpy(_last, _frame, _frame_len);
+    _last[_frame_len] = '\0';
+    if (memcmp(&_frame[1], "PMTK", 4) != 0 || _ack_flag < 0) {
+        return;
+    }
+    unsigned type = strtoul(&_frame[5], NULL, 10);
+    char ack[40];
+    if (type == XM1110_PMTK_Q_EPO_INFO) {
+        /* answered with data instead of an acknowledge */
+        snprintf(ack, sizeof(ack), "PMTK707,%u,2040,86400,2041,86400", _epo_sets);
+    } else {
+        snprintf(ack, sizeof(ack), "PMTK001,%u,%d", type, _ack_flag);
+    }
+    _emit(ack);
+    if (type == XM1110_PMTK_CMD_STANDBY && _ack_flag == XM1110_ACK_OK) {
+        _standby = true;
+    }
+}
+
+static int _read(uint16_t reg, uint8_t *data, size_t len)
+{
+    if (reg != FAKE_I2C_NOREG) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        data[i] = (_out_pos < _out_len) ? _out[_out_pos++] : XM1110_NO_DATA;
+    }
+    if (_out_pos == _out_len) {
+        _out_pos = _out_len = 0;
+    }
+    return 0;
+}
+
+static int _write(uint16_t reg, const uint8_t *data, size_t len)
+{
+    if (reg != FAKE_I2C_NOREG) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (_standby) {
+            if (++_wake_bytes == _wake_after) {
+                _standby = false;
+                _emit(RMC);
+            }
+            continue;
+        }
+        if (data[i] == '$') {
+            _frame_len = 0;
+        }
+        if (_frame_len < sizeof(_frame) - 1) {
+            _frame[_frame_len++] = data[i];
+        }
+        if (data[i] == '\n') {
+            _command();
+            _frame_len = 0;
+        }
+    }
+    return 0;
+}
+
+static const fake_i2c_dev_t _model = {
+    .addr = XM1110_I2C_ADDRESS,
+    .read = _read,
+    .write = _write,
+};
+
+static void set_up(void)
+{
+    _out_len = _out_pos = 0;
+    _frame_len = 0;
+    _last[0] = '\0';
+    _frames = 0;
+    _bad_frames = 0;
+    _ack_flag = XM1110_ACK_OK;
+    _standby = false;
+    _wake_after = 1;
+    _wake_bytes = 0;
+    _epo_sets = 0;
+    fake_i2c_attach(&_model);
+    xm1110_init(&_dev, &_params);
+}
+
+static void test_checksum(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, xm1110_send_command(&_dev, "PMTK225,0"));
+    TEST_ASSERT_EQUAL_STRING("$PMTK225,0*2B\r\n", _last);
+    TEST_ASSERT_EQUAL_INT(0, xm1110_send_command(&_dev, "PMTK161,0"));
+    TEST_ASSERT_EQUAL_STRING("$PMTK161,0*28\r\n", _last);
+    TEST_ASSERT_EQUAL_INT(0, _bad_frames);
+}
+
+static void test_too_long(void)
+{
+    char cmd[XM1110_CMD_MAX];
+    memset(cmd, 'A', sizeof(cmd) - 1);
+    cmd[sizeof(cmd) - 1] = '\0';
+
+    TEST_ASSERT_EQUAL_INT(-EINVAL, xm1110_send_command(&_dev, cmd));
+    TEST_ASSERT_EQUAL_INT(0, fake_i2c_stats()->transfers);
+}
+
+static void test_standby(void)
+{
+    xm1110_set_gps_standby(&_dev);
+    TEST_ASSERT(_standby);
+    TEST_ASSERT_EQUAL_STRING("$PMTK161,0*28\r\n", _last);
+    TEST_ASSERT_EQUAL_INT(0, fake_i2c_stats()->acquired);
+}
+
+static void test_standby_not_acknowledged(void)
+{
+    _ack_flag = -1;
+    uint32_t start = ztimer_now(ZTIMER_MSEC);
+
+    TEST_ASSERT_EQUAL_INT(-ETIMEDOUT, xm1110_command(&_dev, XM1110_PMTK_CMD_STANDBY, "0"));
+    TEST_ASSERT(!_standby);
+    /* all retries were waited for */
+    TEST_ASSERT(ztimer_now(ZTIMER_MSEC) - start >= XM1110_ACK_RETRIES * XM1110_ACK_DELAY);
+}
+
+static void test_wake(void)
+{
+    xm1110_set_gps_standby(&_dev);
+    _wake_after = 2;
+
+    TEST_ASSERT_EQUAL_INT(XM1110_OK, xm1110_set_gps_active(&_dev));
+    TEST_ASSERT(!_standby);
+    TEST_ASSERT_EQUAL_INT(2, _wake_bytes);
+}
+
+static void test_wake_fails(void)
+{
+    xm1110_set_gps_standby(&_dev);
+    _wake_after = 0;
+
+    TEST_ASSERT_EQUAL_INT(-ETIMEDOUT, xm1110_set_gps_active(&_dev));
+    TEST_ASSERT_EQUAL_INT(XM1110_WAKE_RETRIES, _wake_bytes);
+    TEST_ASSERT_EQUAL_INT(0, fake_i2c_stats()->acquired);
+}
+
+static void test_bus_error(void)
+{
+    fake_i2c_fail(1);
+    TEST_ASSERT_EQUAL_INT(-ENXIO, xm1110_command(&_dev, XM1110_PMTK_CMD_STANDBY, "0"));
+    TEST_ASSERT_EQUAL_INT(0, _frames);
+    TEST_ASSERT_EQUAL_INT(0, fake_i2c_stats()->acquired);
+
+    fake_i2c_fail(1);
+    TEST_ASSERT_EQUAL_INT(-ENXIO, xm1110_get_epo_sets(&_dev));
+}
+
+static void test_ack_flags(void)
+{
+    static const int res[] = {
+        [XM1110_ACK_INVALID] = -EINVAL,
+        [XM1110_ACK_UNSUPPORTED] = -ENOTSUP,
+        [XM1110_ACK_FAILED] = -EIO,
+        [XM1110_ACK_OK] = XM1110_OK,
+    };
+
+    for (int flag = XM1110_ACK_INVALID; flag <= XM1110_ACK_OK; flag++) {
+        _ack_flag = flag;
+        TEST_ASSERT_EQUAL_INT(res[flag], xm1110_set_normal(&_dev));
+    }
+}
+
+static void test_epo_sets(void)
+{
+    _epo_sets = 12;
+    TEST_ASSERT_EQUAL_INT(12, xm1110_get_epo_sets(&_dev));
+    TEST_ASSERT_EQUAL_STRING("$PMTK607*33\r\n", _last);
+
+    _ack_flag = -1;
+    TEST_ASSERT_EQUAL_INT(-ETIMEDOUT, xm1110_get_epo_sets(&_dev));
+}
+
+//the frame the driver is expected to send for body
+static const char *_framed(const char *body)
+{
+    static char frame[FRAME_MAX];
+    snprintf(frame, sizeof(frame), "$%s*%02X\r\n", body, _checksum(body, strlen(body)));
+    return frame;
+}
+
+static void test_periodic(void)
+{
+    TEST_ASSERT_EQUAL_INT(XM1110_OK, xm1110_set_periodic(&_dev, 10000, 290000));
+    /* no fix in a run extends the next one to three times the run time */
+    TEST_ASSERT_EQUAL_STRING(_framed("PMTK225,2,10000,290000,30000,290000"), _last);
+
+    TEST_ASSERT_EQUAL_INT(XM1110_OK, xm1110_set_alwayslocate(&_dev));
+    TEST_ASSERT_EQUAL_STRING(_framed("PMTK225,8"), _last);
+
+    TEST_ASSERT_EQUAL_INT(XM1110_OK, xm1110_set_normal(&_dev));
+    TEST_ASSERT_EQUAL_STRING(_framed("PMTK225,0"), _last);
+    TEST_ASSERT_EQUAL_INT(3, _frames);
+    TEST_ASSERT_EQUAL_INT(0, _bad_frames);
+}
+
+static void test_periodic_limits(void)
+{
+    static const uint32_t bad[][2] = {
+        { XM1110_PERIODIC_MIN - 1, XM1110_PERIODIC_MIN },
+        { XM1110_PERIODIC_MIN, XM1110_PERIODIC_MIN - 1 },
+        { XM1110_PERIODIC_MAX / 3 + 1, XM1110_PERIODIC_MIN },
+        { XM1110_PERIODIC_MIN, XM1110_PERIODIC_MAX + 1 },
+    };
+
+    for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        TEST_ASSERT_EQUAL_INT(-EINVAL, xm1110_set_periodic(&_dev, bad[i][0], bad[i][1]));
+    }
+    TEST_ASSERT_EQUAL_INT(0, fake_i2c_stats()->transfers);
+
+    TEST_ASSERT_EQUAL_INT(XM1110_OK, xm1110_set_periodic(&_dev, XM1110_PERIODIC_MIN,
+                                                         XM1110_PERIODIC_MIN));
+    TEST_ASSERT_EQUAL_INT(XM1110_OK, xm1110_set_periodic(&_dev, XM1110_PERIODIC_MAX / 3,
+                                                         XM1110_PERIODIC_MAX));
+    TEST_ASSERT_EQUAL_STRING(_framed("PMTK225,2,172800000,518400000,518400000,518400000"),
+                             _last);
+}
+
+static void test_periodic_in_standby(void)
+{
+    xm1110_set_gps_standby(&_dev);
+    _wake_after = 1;
+
+    /* the first byte only wakes the module, the rest is not a frame */
+    TEST_ASSERT_EQUAL_INT(-ETIMEDOUT, xm1110_set_periodic(&_dev, 10000, 290000));
+    TEST_ASSERT_EQUAL_INT(1, _bad_frames);
+
+    TEST_ASSERT_EQUAL_INT(XM1110_OK, xm1110_set_periodic(&_dev, 10000, 290000));
+}
+
+Test *tests_xm1110(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_checksum),
+        new_TestFixture(test_too_long),
+        new_TestFixture(test_standby),
+        new_TestFixture(test_standby_not_acknowledged),
+        new_TestFixture(test_wake),
+        new_TestFixture(test_wake_fails),
+        new_TestFixture(test_bus_error),
+        new_TestFixture(test_ack_flags),
+        new_TestFixture(test_epo_sets),
+        new_TestFixture(test_periodic),
+        new_TestFixture(test_periodic_limits),
+        new_TestFixture(test_periodic_in_standby),
+    };
+
+    EMB_UNIT_TESTCALLER(xm1110_tests, set_up, NULL, fixtures);
+
+    return (Test *)&xm1110_tests;
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_xm1110());
+    TESTS_END();
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <errno.h>
+
+#include "fake_periph.h"
+
+static const fake_i2c_dev_t *_dev;
+static fake_i2c_stats_t _stats;
+static unsigned _fail;
+
+static fake_gpio_int_t _int = { .pin = GPIO_UNDEF };
+static gpio_cb_t _cb;
+static void *_arg;
+static int _level = 1;
+
+void fake_i2c_attach(const fake_i2c_dev_t *dev)
+{
+    _dev = dev;
+    _stats = (fake_i2c_stats_t){ 0 };
+    _fail = 0;
+}
+
+const fake_i2c_stats_t *fake_i2c_stats(void)
+{
+    return &_stats;
+}
+
+void fake_i2c_fail(unsigned n)
+{
+    _fail = n;
+}
+
+//pass one transfer to the device model, or refuse it like a missing device
+static int _transfer(uint16_t addr, uint16_t reg, void *data, size_t len, bool read)
+{
+    if (!_dev || addr != _dev->addr || _fail) {
+        if (_fail) {
+            _fail--;
+        }
+        _stats.nacks++;
+        return -ENXIO;
+    }
+    int res = read ? _dev->read(reg, data, len) : _dev->write(reg, data, len);
+    if (res < 0) {
+        _stats.nacks++;
+        return -EIO;
+    }
+    _stats.transfers++;
+    return 0;
+}
+
+int fake_i2c_acquire(i2c_t dev)
+{
+    (void)dev;
+    _stats.acquired++;
+    return 0;
+}
+
+void fake_i2c_release(i2c_t dev)
+{
+    (void)dev;
+    _stats.acquired--;
+}
+
+int fake_i2c_read_reg(i2c_t dev, uint16_t addr, uint16_t reg, void *data, uint8_t flags)
+{
+    (void)dev; (void)flags;
+    return _transfer(addr, reg, data, 1, true);
+}
+
+int fake_i2c_read_regs(i2c_t dev, uint16_t addr, uint16_t reg, void *data, size_t len,
+                       uint8_t flags)
+{
+    (void)dev; (void)flags;
+    return _transfer(addr, reg, data, len, true);
+}
+
+int fake_i2c_write_reg(i2c_t dev, uint16_t addr, uint16_t reg, uint8_t data, uint8_t flags)
+{
+    (void)dev; (void)flags;
+    return _transfer(addr, reg, &data, 1, false);
+}
+
+int fake_i2c_write_regs(i2c_t dev, uint16_t addr, uint16_t reg, const void *data,
+                        size_t len, uint8_t flags)
+{
+    (void)dev; (void)flags;
+    return _transfer(addr, reg, (void *)data, len, false);
+}
+
+int fake_i2c_read_byte(i2c_t dev, uint16_t addr, void *data, uint8_t flags)
+{
+    (void)dev; (void)flags;
+    return _transfer(addr, FAKE_I2C_NOREG, data, 1, true);
+}
+
+int fake_i2c_read_bytes(i2c_t dev, uint16_t addr, void *data, size_t len, uint8_t flags)
+{
+    (void)dev; (void)flags;
+    return _transfer(addr, FAKE_I2C_NOREG, data, len, true);
+}
+
+int fake_i2c_write_byte(i2c_t dev, uint16_t addr, uint8_t data, uint8_t flags)
+{
+    (void)dev; (void)flags;
+    return _transfer(addr, FAKE_I2C_NOREG, &data, 1, false);
+}
+
+int fake_i2c_write_bytes(i2c_t dev, uint16_t addr, const void *data, size_t len,
+                         uint8_t flags)
+{
+    (void)dev; (void)flags;
+    return _transfer(addr, FAKE_I2C_NOREG, (void *)data, len, false);
+}
+
+int fake_gpio_init_int(gpio_t pin, gpio_mode_t mode, gpio_flank_t flank, gpio_cb_t cb,
+                       void *arg)
+{
+    _int = (fake_gpio_int_t){ .pin = pin, .mode = mode, .flank = flank, .enabled = true };
+    _cb = cb;
+    _arg = arg;
+    _level = 1;
+    return 0;
+}
+
+void fake_gpio_irq_enable(gpio_t pin)
+{
+    if (pin == _int.pin) {
+        _int.enabled = true;
+    }
+}
+
+void fake_gpio_irq_disable(gpio_t pin)
+{
+    if (pin == _int.pin) {
+        _int.enabled = false;
+    }
+}
+
+const fake_gpio_int_t *fake_gpio_int(void)
+{
+    return &_int;
+}
+
+void fake_gpio_set(gpio_t pin, int level)
+{
+    int prev = _level;
+    if (pin != _int.pin) {
+        return;
+    }
+    _level = level;
+    if (!_int.enabled || !_cb || prev == level) {
+        return;
+    }
+    if ((_int.flank == GPIO_BOTH) || (_int.flank == GPIO_RISING && level) ||
+        (_int.flank == GPIO_FALLING && !level)) {
+        _cb(_arg);
+    }
+}
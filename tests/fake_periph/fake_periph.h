@@ -0,0 +1,85 @@
+#ifndef FAKE_PERIPH_H
+#define FAKE_PERIPH_H
+
+/*
+ * Simulated I2C bus and GPIO interrupts for the driver tests.
+ *
+ * Include this header before the driver source under test. The I2C and GPIO
+ * interrupt calls of the driver are renamed to the fake_* functions below,
+ * which pass every transfer to the model of the device registered with
+ * fake_i2c_attach(). The model raises its interrupt line with fake_gpio_set().
+ */
+#define i2c_acquire         fake_i2c_acquire
+#define i2c_release         fake_i2c_release
+#define i2c_read_reg        fake_i2c_read_reg
+#define i2c_read_regs       fake_i2c_read_regs
+#define i2c_write_reg       fake_i2c_write_reg
+#define i2c_write_regs      fake_i2c_write_regs
+#define i2c_read_byte       fake_i2c_read_byte
+#define i2c_read_bytes      fake_i2c_read_bytes
+#define i2c_write_byte      fake_i2c_write_byte
+#define i2c_write_bytes     fake_i2c_write_bytes
+#define gpio_init_int       fake_gpio_init_int
+#define gpio_irq_enable     fake_gpio_irq_enable
+#define gpio_irq_disable    fake_gpio_irq_disable
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "periph/i2c.h"
+#include "periph/gpio.h"
+
+#define FAKE_I2C_NOREG      (0xffff)    /* transfer without register address */
+
+typedef struct {
+    uint16_t addr;          /* 7 bit address the device answers on */
+    /* reg is FAKE_I2C_NOREG for plain byte transfers, return <0 to NACK */
+    int (*read)(uint16_t reg, uint8_t *data, size_t len);
+    int (*write)(uint16_t reg, const uint8_t *data, size_t len);
+} fake_i2c_dev_t;
+
+typedef struct {
+    unsigned transfers;     /* transfers answered by the device */
+    unsigned nacks;         /* transfers refused, wrong address included */
+    int acquired;           /* acquire minus release, 0 between calls */
+} fake_i2c_stats_t;
+
+int fake_i2c_acquire(i2c_t dev);
+void fake_i2c_release(i2c_t dev);
+int fake_i2c_read_reg(i2c_t dev, uint16_t addr, uint16_t reg, void *data, uint8_t flags);
+int fake_i2c_read_regs(i2c_t dev, uint16_t addr, uint16_t reg, void *data, size_t len,
+                       uint8_t flags);
+int fake_i2c_write_reg(i2c_t dev, uint16_t addr, uint16_t reg, uint8_t data, uint8_t flags);
+int fake_i2c_write_regs(i2c_t dev, uint16_t addr, uint16_t reg, const void *data,
+                        size_t len, uint8_t flags);
+int fake_i2c_read_byte(i2c_t dev, uint16_t addr, void *data, uint8_t flags);
+int fake_i2c_read_bytes(i2c_t dev, uint16_t addr, void *data, size_t len, uint8_t flags);
+int fake_i2c_write_byte(i2c_t dev, uint16_t addr, uint8_t data, uint8_t flags);
+int fake_i2c_write_bytes(i2c_t dev, uint16_t addr, const void *data, size_t len,
+                         uint8_t flags);
+int fake_gpio_init_int(gpio_t pin, gpio_mode_t mode, gpio_flank_t flank, gpio_cb_t cb,
+                       void *arg);
+void fake_gpio_irq_enable(gpio_t pin);
+void fake_gpio_irq_disable(gpio_t pin);
+
+void fake_i2c_attach(const fake_i2c_dev_t *dev);
+const fake_i2c_stats_t *fake_i2c_stats(void);
+
+/* fail the next n transfers, as a device that does not answer */
+void fake_i2c_fail(unsigned n);
+
+/* drive an input, calls the callback on the configured edge if enabled */
+void fake_gpio_set(gpio_t pin, int level);
+
+/* the configuration of the last fake_gpio_init_int() */
+typedef struct {
+    gpio_t pin;
+    gpio_mode_t mode;
+    gpio_flank_t flank;
+    bool enabled;
+} fake_gpio_int_t;
+
+const fake_gpio_int_t *fake_gpio_int(void);
+
+#endif
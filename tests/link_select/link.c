@@ -0,0 +1,2 @@
+/* link selection under test */
+#include "link_select.c"
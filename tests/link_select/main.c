@@ -0,0 +1,183 @@
+/*
+ * Link selection replayed over days of indoor and outdoor stays.
+ *
+ * Every send period the test does what the measurement loop does: probe
+ * DASH7 when a probe is due, choose the link and send the reading on it. The
+ * outcome of each uplink depends on where the device is: indoors both links
+ * work, outdoors DASH7 times out. Failed uplinks are wasted transmissions,
+ * they are counted per day and printed next to what the former poll on
+ * every send period wasted outdoors. A reading that fails is retried by the
+ * queue, which is not part of this test.
+ */
+#include <stdio.h>
+
+#include "embUnit.h"
+
+#include "link_select.h"
+#include "tx_queue.h"
+#include "timebase.h"
+
+#define SEND_PERIOD_MS      (5 * 60 * 1000U)
+#define DAY_MS              (24 * 3600 * 1000U)
+#define DAYS                (7)
+#define D7_LATENCY_MS       (300)
+#define D7_TIMEOUT_MS       (10000)
+#define LORA_LATENCY_MS     (2100)
+#define D7_LEN              (6)
+#define LORA_LEN            (14)
+
+typedef bool (*indoor_fn_t)(uint32_t ms_of_day);
+
+static uint32_t _now;
+
+typedef struct {
+    uint32_t sends;
+    uint32_t delivered;     /* at the first attempt */
+    uint32_t d7;
+    uint32_t polls;         /* what polling every send period would waste */
+} run_t;
+
+uint32_t time_now_ms(void)
+{
+    return _now;
+}
+
+void time_set_msg(ztimer_t* timer, uint32_t ms, msg_t* msg, kernel_pid_t pid)
+{
+    (void)timer; (void)ms; (void)msg; (void)pid;
+}
+
+/* the estimate of the queue, the test does not need the queue itself */
+uint32_t tx_queue_airtime_us(alp_itf_id_t itf, uint8_t len)
+{
+    if (itf == ALP_ITF_ID_D7ASP) {
+        return (len + 25) * 144;
+    }
+    return 144384 + (len / 5) * 20480;  /* SF9, steps of 5 symbols */
+}
+
+static bool _uplink(alp_itf_id_t itf, bool indoor)
+{
+    bool ok = (itf != ALP_ITF_ID_D7ASP) || indoor;
+    uint32_t latency = (itf != ALP_ITF_ID_D7ASP) ? LORA_LATENCY_MS :
+                       ok ? D7_LATENCY_MS : D7_TIMEOUT_MS;
+    link_select_report(itf, ok ? MODEM_STATUS_COMMAND_COMPLETED_SUCCESS :
+                                 MODEM_STATUS_COMMAND_TIMEOUT, latency);
+    _now += latency;
+    return ok;
+}
+
+static void _run(const char* name, indoor_fn_t indoor_at, run_t* run)
+{
+    _now = 0;
+    link_select_init();
+    run->sends = run->delivered = run->d7 = run->polls = 0;
+
+    while (_now < DAYS * DAY_MS) {
+        uint32_t start = _now;
+        bool indoor = indoor_at(_now % DAY_MS);
+        if (link_select_probe_due()) {
+            _uplink(ALP_ITF_ID_D7ASP, indoor);
+        }
+        alp_itf_id_t itf = link_select_choose(D7_LEN, LORA_LEN);
+        run->delivered += _uplink(itf, indoor);
+        run->d7 += (itf == ALP_ITF_ID_D7ASP);
+        run->polls += !indoor;
+        run->sends++;
+        _now = start + SEND_PERIOD_MS;
+    }
+
+    printf("%s: wasted TX per day DASH7 %" PRIu32 " LoRaWAN %" PRIu32
+           ", polling every send %" PRIu32 ", first attempt delivered %" PRIu32 "/%" PRIu32
+           ", %" PRIu32 " on DASH7\n", name,
+           link_select_wasted(ALP_ITF_ID_D7ASP) / DAYS,
+           link_select_wasted(ALP_ITF_ID_LORAWAN_ABP) / DAYS,
+           run->polls / DAYS, run->delivered, run->sends, run->d7);
+}
+
+static bool _indoor(uint32_t ms)
+{
+    (void)ms;
+    return true;
+}
+
+static bool _outdoor(uint32_t ms)
+{
+    (void)ms;
+    return false;
+}
+
+/* inside from 8:00 to 18:00, out otherwise */
+static bool _workday(uint32_t ms)
+{
+    return ms >= 8 * 3600000U && ms < 18 * 3600000U;
+}
+
+/* in and out every 45 minutes */
+static bool _errands(uint32_t ms)
+{
+    return (ms / (45 * 60000U)) & 1;
+}
+
+static void test_link_select_indoor(void)
+{
+    run_t run;
+    _run("indoor", _indoor, &run);
+    TEST_ASSERT_EQUAL_INT(0, link_select_wasted(ALP_ITF_ID_D7ASP));
+    TEST_ASSERT_EQUAL_INT(run.sends, run.delivered);
+    TEST_ASSERT_EQUAL_INT(run.sends, run.d7);
+}
+
+static void test_link_select_outdoor(void)
+{
+    run_t run;
+    _run("outdoor", _outdoor, &run);
+    TEST_ASSERT_EQUAL_INT(run.sends, run.delivered);
+    TEST_ASSERT_EQUAL_INT(0, run.d7);
+    /* the probe interval backs off to LINK_PROBE_MAX_MS */
+    TEST_ASSERT(link_select_wasted(ALP_ITF_ID_D7ASP) <=
+                (DAYS * DAY_MS) / LINK_PROBE_MAX_MS + 8);
+}
+
+static void test_link_select_workday(void)
+{
+    run_t run;
+    _run("workday", _workday, &run);
+    /* at most one reading lost on each move outdoors */
+    TEST_ASSERT(run.sends - run.delivered <= DAYS);
+    TEST_ASSERT(link_select_wasted(ALP_ITF_ID_D7ASP) * 4 < run.polls);
+    TEST_ASSERT_EQUAL_INT(0, link_select_wasted(ALP_ITF_ID_LORAWAN_ABP));
+}
+
+static void test_link_select_errands(void)
+{
+    run_t run;
+    _run("errands", _errands, &run);
+    TEST_ASSERT(run.sends - run.delivered <= (DAYS * DAY_MS) / (90 * 60000U) + 1);
+    TEST_ASSERT(link_select_wasted(ALP_ITF_ID_D7ASP) < run.polls);
+    /* back on DASH7 after the first probe indoors */
+    TEST_ASSERT(run.d7 * 5 > run.sends * 2);
+}
+
+Test *tests_link_select(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_link_select_indoor),
+        new_TestFixture(test_link_select_outdoor),
+        new_TestFixture(test_link_select_workday),
+        new_TestFixture(test_link_select_errands),
+    };
+
+    EMB_UNIT_TESTCALLER(link_select_tests, NULL, NULL, fixtures);
+
+    return (Test *)&link_select_tests;
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_link_select());
+    TESTS_END();
+
+    return 0;
+}
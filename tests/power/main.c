@@ -0,0 +1,157 @@
+/*
+ * Idle mode of the MCU through a measurement loop.
+ *
+ * The test runs the sequence of power_block() and power_unblock() calls the
+ * main and TX threads make in one loop: the main thread wakes for the
+ * period, hands an uplink to the TX thread and waits, the modem completes
+ * later. After each call the idle mode and the MCU current reported to the
+ * charge estimate are compared with the expected trace. The period timer is
+ * checked on the test clock, with a late and an overrun period.
+ */
+#include <stdio.h>
+
+#include "embUnit.h"
+#include "sched.h"
+
+#include "power.h"
+#include "energy.h"
+#include "timebase.h"
+
+#define PERIOD_MS       (1000U)
+
+typedef enum {
+    BLOCK,
+    UNBLOCK,
+} action_t;
+
+typedef struct {
+    action_t action;
+    power_user_t user;
+    power_idle_t mode;      /* idle mode afterwards */
+    uint32_t mcu_ua;        /* MCU current afterwards */
+} step_t;
+
+static uint32_t _now;
+static uint32_t _timer_ms;
+static unsigned _timers;
+static uint32_t _mcu_ua;
+
+uint32_t time_now_ms(void)
+{
+    return _now;
+}
+
+void time_set_msg(ztimer_t* timer, uint32_t ms, msg_t* msg, kernel_pid_t pid)
+{
+    (void)timer; (void)msg; (void)pid;
+    _timer_ms = ms;
+    _timers++;
+}
+
+void energy_set(energy_part_t part, uint32_t ua)
+{
+    if (part == ENERGY_MCU) {
+        _mcu_ua = ua;
+    }
+}
+
+void energy_add(energy_part_t part, uint64_t ua_ms)
+{
+    (void)part; (void)ua_ms;
+}
+
+static const step_t _loop[] = {
+    /* boot done, waiting for the first period */
+    { UNBLOCK, POWER_MAIN,  POWER_IDLE_STOP2, ENERGY_MCU_STOP_UA },
+    /* period: measure, queue an uplink, wait for the modem */
+    { BLOCK,   POWER_MAIN,  POWER_IDLE_SLEEP, ENERGY_MCU_RUN_UA },
+    { BLOCK,   POWER_MODEM, POWER_IDLE_SLEEP, ENERGY_MCU_RUN_UA },
+    { UNBLOCK, POWER_MAIN,  POWER_IDLE_SLEEP, ENERGY_MCU_SLEEP_UA },
+    /* the uplink completes */
+    { BLOCK,   POWER_MAIN,  POWER_IDLE_SLEEP, ENERGY_MCU_RUN_UA },
+    { UNBLOCK, POWER_MODEM, POWER_IDLE_SLEEP, ENERGY_MCU_RUN_UA },
+    { UNBLOCK, POWER_MAIN,  POWER_IDLE_STOP2, ENERGY_MCU_STOP_UA },
+    /* the modem user done twice changes nothing */
+    { UNBLOCK, POWER_MODEM, POWER_IDLE_STOP2, ENERGY_MCU_STOP_UA },
+    /* and busy twice neither */
+    { BLOCK,   POWER_MODEM, POWER_IDLE_SLEEP, ENERGY_MCU_SLEEP_UA },
+    { BLOCK,   POWER_MODEM, POWER_IDLE_SLEEP, ENERGY_MCU_SLEEP_UA },
+    { UNBLOCK, POWER_MODEM, POWER_IDLE_STOP2, ENERGY_MCU_STOP_UA },
+};
+
+#define LOOP_NUMOF      (sizeof(_loop) / sizeof(_loop[0]))
+
+static void set_up(void)
+{
+    _now = 0;
+    _timers = 0;
+    power_init(KERNEL_PID_UNDEF, 0);
+}
+
+static void test_power_init(void)
+{
+    /* the main thread is busy until it waits for the first event */
+    TEST_ASSERT_EQUAL_INT(POWER_IDLE_SLEEP, power_idle_mode());
+    TEST_ASSERT_EQUAL_INT(ENERGY_MCU_RUN_UA, _mcu_ua);
+}
+
+static void test_power_trace(void)
+{
+    for (unsigned i = 0; i < LOOP_NUMOF; i++) {
+        const step_t *s = &_loop[i];
+        if (s->action == BLOCK) {
+            power_block(s->user);
+        }
+        else {
+            power_unblock(s->user);
+        }
+        if (power_idle_mode() != s->mode || _mcu_ua != s->mcu_ua) {
+            printf("step %u: mode %d, MCU %lu uA\n", i, power_idle_mode(),
+                   (unsigned long)_mcu_ua);
+        }
+        TEST_ASSERT_EQUAL_INT(s->mode, power_idle_mode());
+        TEST_ASSERT_EQUAL_INT(s->mcu_ua, _mcu_ua);
+    }
+}
+
+static void test_power_period(void)
+{
+    power_wakeup(PERIOD_MS);
+    TEST_ASSERT_EQUAL_INT(PERIOD_MS, _timer_ms);
+
+    /* handled 200 ms late, the next period still ends on time */
+    _now = PERIOD_MS + 200;
+    power_wakeup(PERIOD_MS);
+    TEST_ASSERT_EQUAL_INT(PERIOD_MS - 200, _timer_ms);
+
+    /* overrun by more than a period, start over from now */
+    _now = 2 * PERIOD_MS + 1500;
+    power_wakeup(PERIOD_MS);
+    TEST_ASSERT_EQUAL_INT(PERIOD_MS, _timer_ms);
+    _now += PERIOD_MS + 10;
+    power_wakeup(PERIOD_MS);
+    TEST_ASSERT_EQUAL_INT(PERIOD_MS - 10, _timer_ms);
+    TEST_ASSERT_EQUAL_INT(4, _timers);
+}
+
+Test *tests_power(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_power_init),
+        new_TestFixture(test_power_trace),
+        new_TestFixture(test_power_period),
+    };
+
+    EMB_UNIT_TESTCALLER(power_tests, set_up, NULL, fixtures);
+
+    return (Test *)&power_tests;
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_power());
+    TESTS_END();
+
+    return 0;
+}
@@ -0,0 +1,2 @@
+/* the idle mode bookkeeping under test */
+#include "power.c"
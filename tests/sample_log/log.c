@@ -0,0 +1,8 @@
+/* the sample log under test, on the RAM flash of the test */
+#include "sample_log.c"
+
+//next slot written to flash
+uint32_t sample_log_head(void)
+{
+    return _head;
+}
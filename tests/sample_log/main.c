@@ -0,0 +1,233 @@
+/*
+ * Sample log on a simulated flash.
+ *
+ * The flash is a RAM array behind the mtd functions: erasing sets whole
+ * sectors to 0xff and writing can only clear bits, as on NOR flash. The log
+ * is 4 sectors of 16 records. The tests write, replay and acknowledge
+ * readings, restart the log on what is left in flash and check that it
+ * continues at the right slot. One test leaves erased slots among old
+ * records, as a failed write or an interrupted erase does. The head then has
+ * to come from the newest checkpoint, not from the last erased slot.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "embUnit.h"
+
+#include "sample_log.h"
+
+#define SECTORS         (4)
+#define SECTOR_SIZE     (16 * SAMPLE_LOG_RECORD)
+#define SLOTS           (SECTORS * SECTOR_SIZE / SAMPLE_LOG_RECORD)
+#define READINGS_MAX    (64)
+
+uint32_t sample_log_head(void);
+
+static uint8_t _flash[SECTORS * SECTOR_SIZE];
+
+static mtd_dev_t _mtd = {
+    .sector_count = SECTORS,
+    .pages_per_sector = 1,
+    .page_size = SECTOR_SIZE,
+};
+
+int mtd_init(mtd_dev_t *mtd)
+{
+    (void)mtd;
+    return 0;
+}
+
+int mtd_read(mtd_dev_t *mtd, void *dest, uint32_t addr, uint32_t count)
+{
+    (void)mtd;
+    if (addr + count > sizeof(_flash)) {
+        return -EOVERFLOW;
+    }
+    memcpy(dest, &_flash[addr], count);
+    return 0;
+}
+
+int mtd_write(mtd_dev_t *mtd, const void *src, uint32_t addr, uint32_t count)
+{
+    const uint8_t *data = src;
+    (void)mtd;
+    if (addr + count > sizeof(_flash)) {
+        return -EOVERFLOW;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        _flash[addr + i] &= data[i];
+    }
+    return 0;
+}
+
+int mtd_erase(mtd_dev_t *mtd, uint32_t addr, uint32_t count)
+{
+    (void)mtd;
+    if (addr % SECTOR_SIZE || count % SECTOR_SIZE || addr + count > sizeof(_flash)) {
+        return -EOVERFLOW;
+    }
+    memset(&_flash[addr], 0xff, count);
+    return 0;
+}
+
+static void _append(uint16_t reading)
+{
+    uint8_t data[2] = { reading & 0xff, reading >> 8 };
+    TEST_ASSERT_EQUAL_INT(0, sample_log_append(data, sizeof(data), false, false));
+}
+
+//replay and acknowledge all pending readings, returns how many or
+//READINGS_MAX + 1 for a batch that does not add up
+static unsigned _drain(uint16_t *readings)
+{
+    uint8_t buf[TXQ_PAYLOAD_MAX];
+    unsigned n = 0;
+    uint8_t len;
+
+    while ((len = sample_log_batch(buf, sizeof(buf))) > 0) {
+        uint8_t pos = 1;
+        for (unsigned i = 0; i < (buf[0] & ~SAMPLE_LOG_BATCH); i++) {
+            if (n < READINGS_MAX) {
+                readings[n] = buf[pos + 1] | (buf[pos + 2] << 8);
+            }
+            n++;
+            pos += 1 + (buf[pos] & 0x0f);
+        }
+        if (pos != len) {
+            return READINGS_MAX + 1;
+        }
+        sample_log_ack();
+    }
+    return n;
+}
+
+//one round of the loop: a few readings, their replay and the flush
+static void _round(uint16_t *next)
+{
+    uint16_t readings[READINGS_MAX];
+
+    for (int i = 0; i < 3; i++) {
+        _append((*next)++);
+    }
+    TEST_ASSERT_EQUAL_INT(3, _drain(readings));
+    TEST_ASSERT_EQUAL_INT(*next - 1, readings[2]);
+    sample_log_flush();
+}
+
+static void set_up(void)
+{
+    memset(_flash, 0xff, sizeof(_flash));
+    TEST_ASSERT_EQUAL_INT(0, sample_log_init(&_mtd, 0, SECTORS));
+}
+
+static void test_sample_log_replay(void)
+{
+    uint16_t readings[READINGS_MAX];
+
+    for (uint16_t i = 0; i < 20; i++) {
+        _append(i);
+    }
+    TEST_ASSERT_EQUAL_INT(20, _drain(readings));
+    for (uint16_t i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL_INT(i, readings[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(0, _drain(readings));
+}
+
+static void test_sample_log_resume(void)
+{
+    uint16_t readings[READINGS_MAX];
+    uint8_t buf[1 + 5 * 3];
+
+    for (uint16_t i = 0; i < 12; i++) {
+        _append(i);
+    }
+    /* a batch of 5 is delivered, the rest is still in flash on restart */
+    TEST_ASSERT_EQUAL_INT(sizeof(buf), sample_log_batch(buf, sizeof(buf)));
+    sample_log_ack();
+    sample_log_flush();
+    uint32_t head = sample_log_head();
+
+    TEST_ASSERT_EQUAL_INT(0, sample_log_init(&_mtd, 0, SECTORS));
+    TEST_ASSERT_EQUAL_INT(head, sample_log_head());
+    TEST_ASSERT_EQUAL_INT(7, _drain(readings));
+    TEST_ASSERT_EQUAL_INT(5, readings[0]);
+    TEST_ASSERT_EQUAL_INT(11, readings[6]);
+}
+
+static void test_sample_log_wrap(void)
+{
+    uint16_t readings[READINGS_MAX];
+    uint16_t next = 0;
+
+    /* each round writes one buffer, 11 rounds go around the log once */
+    for (int i = 0; i < 11; i++) {
+        _round(&next);
+    }
+    TEST_ASSERT_EQUAL_INT(11 * SAMPLE_LOG_BUFFER - SLOTS, sample_log_head());
+    _append(1000);
+    _append(1001);
+    sample_log_flush();
+    uint32_t head = sample_log_head();
+
+    TEST_ASSERT_EQUAL_INT(0, sample_log_init(&_mtd, 0, SECTORS));
+    TEST_ASSERT_EQUAL_INT(head, sample_log_head());
+    TEST_ASSERT_EQUAL_INT(2, _drain(readings));
+    TEST_ASSERT_EQUAL_INT(1000, readings[0]);
+    TEST_ASSERT_EQUAL_INT(1001, readings[1]);
+}
+
+static void test_sample_log_hole(void)
+{
+    uint16_t readings[READINGS_MAX];
+    uint16_t next = 0;
+
+    for (int i = 0; i < 11; i++) {
+        _round(&next);
+    }
+    _append(1000);
+    _append(1001);
+    sample_log_flush();
+    uint32_t head = sample_log_head();
+
+    /* the last buffer of the log, written rounds ago, reads erased */
+    memset(&_flash[(SLOTS - SAMPLE_LOG_BUFFER) * SAMPLE_LOG_RECORD], 0xff,
+           SAMPLE_LOG_BUFFER * SAMPLE_LOG_RECORD);
+    TEST_ASSERT(SLOTS - SAMPLE_LOG_BUFFER > head);
+
+    TEST_ASSERT_EQUAL_INT(0, sample_log_init(&_mtd, 0, SECTORS));
+    TEST_ASSERT_EQUAL_INT(head, sample_log_head());
+    TEST_ASSERT_EQUAL_INT(2, _drain(readings));
+    TEST_ASSERT_EQUAL_INT(1000, readings[0]);
+
+    /* and new readings follow them */
+    _append(1002);
+    sample_log_flush();
+    TEST_ASSERT_EQUAL_INT(0, sample_log_init(&_mtd, 0, SECTORS));
+    TEST_ASSERT_EQUAL_INT(1, _drain(readings));
+    TEST_ASSERT_EQUAL_INT(1002, readings[0]);
+}
+
+Test *tests_sample_log(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_sample_log_replay),
+        new_TestFixture(test_sample_log_resume),
+        new_TestFixture(test_sample_log_wrap),
+        new_TestFixture(test_sample_log_hole),
+    };
+
+    EMB_UNIT_TESTCALLER(sample_log_tests, set_up, NULL, fixtures);
+
+    return (Test *)&sample_log_tests;
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_sample_log());
+    TESTS_END();
+
+    return 0;
+}
@@ -0,0 +1,266 @@
+/*
+ * Sampling policy, payload and sample cache of the sensor table.
+ *
+ * The sensors are fake SAUL drivers that count their reads and writes and
+ * return a value set by the test, or an error. The table has a sensor read
+ * every loop, one every third loop and on alerts, and one only on alerts,
+ * laid out one after the other in the payload. The cache runs on a test
+ * clock.
+ */
+#include <errno.h>
+#include <string.h>
+
+#include "embUnit.h"
+
+#include "sensor_table.h"
+#include "saul_reg.h"
+#include "timebase.h"
+
+#define TTL_MS          (1000)
+
+typedef struct {
+    int16_t value;
+    int error;              /* returned instead of a reading when < 0 */
+    unsigned reads;
+    unsigned writes;
+} fake_sensor_t;
+
+static uint32_t _now;
+static fake_sensor_t _fakes[3];
+static uint8_t _payload[8];
+
+uint32_t time_now_ms(void)
+{
+    return _now;
+}
+
+void time_set_msg(ztimer_t* timer, uint32_t ms, msg_t* msg, kernel_pid_t pid)
+{
+    (void)timer; (void)ms; (void)msg; (void)pid;
+}
+
+static int _read(const void* dev, phydat_t* res)
+{
+    fake_sensor_t* f = (fake_sensor_t*)dev;
+    f->reads++;
+    if (f->error < 0) {
+        return f->error;
+    }
+    memset(res, 0, sizeof(*res));
+    res->val[0] = f->value;
+    res->unit = UNIT_TEMP_C;
+    res->scale = -2;
+    return 1;
+}
+
+static int _write(const void* dev, phydat_t* data)
+{
+    fake_sensor_t* f = (fake_sensor_t*)dev;
+    f->writes++;
+    f->value = data->val[0];
+    return 1;
+}
+
+static const saul_driver_t _driver = {
+    .read = _read,
+    .write = _write,
+    .type = SAUL_SENSE_TEMP,
+};
+
+//one byte, the low byte of the reading
+static int _pack_byte(sensor_entry_t* s, uint8_t* payload)
+{
+    payload[s->offset] = s->value.val[0] & 0xFF;
+    return 1;
+}
+
+enum { EVERY, THIRD, ALERT, NUMOF };
+static sensor_entry_t _table[NUMOF];
+
+static const sensor_entry_t _template[NUMOF] = {
+    [EVERY] = { .reg = { .name = "every", .dev = &_fakes[EVERY], .driver = &_driver },
+                .period = 1, .offset = 1, .pack = sensor_pack_int16 },
+    [THIRD] = { .reg = { .name = "third", .dev = &_fakes[THIRD], .driver = &_driver },
+                .period = 3, .on_alert = true, .offset = 3, .pack = sensor_pack_int16 },
+    [ALERT] = { .reg = { .name = "alert", .dev = &_fakes[ALERT], .driver = &_driver },
+                .on_alert = true, .offset = 5, .pack = _pack_byte },
+};
+
+static void set_up(void)
+{
+    _now = 0;
+    memset(_fakes, 0, sizeof(_fakes));
+    memcpy(_table, _template, sizeof(_table));
+    sensors_register(_table, NUMOF);
+}
+
+static void tear_down(void)
+{
+    for (unsigned i = 0; i < NUMOF; i++) {
+        saul_reg_rm(&_table[i].reg);
+    }
+}
+
+//a measurement loop as main.c runs it, alert loops sample a second time
+static void _loop(uint8_t loop, bool alert)
+{
+    sensors_begin(_table, NUMOF);
+    sensors_sample(_table, NUMOF, loop, false, _payload);
+    if (alert) {
+        sensors_sample(_table, NUMOF, loop, true, _payload);
+    }
+}
+
+static void test_due(void)
+{
+    _loop(0, false);
+    TEST_ASSERT_EQUAL_INT(1, _fakes[EVERY].reads);
+    TEST_ASSERT_EQUAL_INT(0, _fakes[THIRD].reads);
+    TEST_ASSERT_EQUAL_INT(0, _fakes[ALERT].reads);
+
+    _loop(2, false);
+    TEST_ASSERT_EQUAL_INT(2, _fakes[EVERY].reads);
+    TEST_ASSERT_EQUAL_INT(1, _fakes[THIRD].reads);
+    TEST_ASSERT_EQUAL_INT(0, _fakes[ALERT].reads);
+
+    /* an alert loop samples twice, every sensor is still read once */
+    _loop(3, true);
+    TEST_ASSERT_EQUAL_INT(3, _fakes[EVERY].reads);
+    TEST_ASSERT_EQUAL_INT(2, _fakes[THIRD].reads);
+    TEST_ASSERT_EQUAL_INT(1, _fakes[ALERT].reads);
+
+    /* the due loop of the third sensor with an alert */
+    _loop(5, true);
+    TEST_ASSERT_EQUAL_INT(3, _fakes[THIRD].reads);
+    TEST_ASSERT_EQUAL_INT(2, _fakes[ALERT].reads);
+
+    /* a disabled sensor is skipped */
+    _table[EVERY].disabled = true;
+    _loop(6, true);
+    TEST_ASSERT_EQUAL_INT(4, _fakes[EVERY].reads);
+    TEST_ASSERT(!_table[EVERY].fresh);
+}
+
+static void test_payload_len(void)
+{
+    _fakes[EVERY].value = 0x1234;
+    _fakes[THIRD].value = 0x5678;
+    _fakes[ALERT].value = 0x9a;
+
+    _loop(0, false);
+    TEST_ASSERT_EQUAL_INT(3, sensors_payload_len(_table, NUMOF));
+    TEST_ASSERT_EQUAL_INT(0x34, _payload[1]);
+    TEST_ASSERT_EQUAL_INT(0x12, _payload[2]);
+
+    _loop(2, false);
+    TEST_ASSERT_EQUAL_INT(5, sensors_payload_len(_table, NUMOF));
+    TEST_ASSERT_EQUAL_INT(0x78, _payload[3]);
+    TEST_ASSERT_EQUAL_INT(0x56, _payload[4]);
+
+    _loop(3, true);
+    TEST_ASSERT_EQUAL_INT(6, sensors_payload_len(_table, NUMOF));
+    TEST_ASSERT_EQUAL_INT(0x9a, _payload[5]);
+
+    /* a failed read writes nothing */
+    _fakes[ALERT].error = -ECANCELED;
+    _loop(3, true);
+    TEST_ASSERT_EQUAL_INT(5, sensors_payload_len(_table, NUMOF));
+
+    sensors_begin(_table, NUMOF);
+    TEST_ASSERT_EQUAL_INT(0, sensors_payload_len(_table, NUMOF));
+}
+
+static void test_cache_ttl(void)
+{
+    saul_reg_t* reg = &_table[EVERY].reg;
+    phydat_t res;
+
+    _table[EVERY].ttl = TTL_MS;
+    _fakes[EVERY].value = 2100;
+    TEST_ASSERT_EQUAL_INT(1, saul_reg_read(reg, &res));
+    TEST_ASSERT_EQUAL_INT(2100, res.val[0]);
+
+    /* within the TTL the reading comes from the cache, even if it changed */
+    _fakes[EVERY].value = 2200;
+    _now += TTL_MS - 1;
+    TEST_ASSERT_EQUAL_INT(1, saul_reg_read(reg, &res));
+    TEST_ASSERT_EQUAL_INT(2100, res.val[0]);
+    TEST_ASSERT_EQUAL_INT(1, _fakes[EVERY].reads);
+    TEST_ASSERT_EQUAL_INT(1, _table[EVERY].hits);
+    TEST_ASSERT_EQUAL_INT(1, _table[EVERY].misses);
+
+    /* after it the driver is read again */
+    _now += 1;
+    TEST_ASSERT_EQUAL_INT(1, saul_reg_read(reg, &res));
+    TEST_ASSERT_EQUAL_INT(2200, res.val[0]);
+    TEST_ASSERT_EQUAL_INT(2, _fakes[EVERY].reads);
+    TEST_ASSERT_EQUAL_INT(1, _table[EVERY].hits);
+    TEST_ASSERT_EQUAL_INT(2, _table[EVERY].misses);
+
+    /* the measurement loop reads through the same cache */
+    _loop(0, false);
+    TEST_ASSERT_EQUAL_INT(2, _fakes[EVERY].reads);
+    TEST_ASSERT_EQUAL_INT(2, _table[EVERY].hits);
+    TEST_ASSERT_EQUAL_INT(2200, _table[EVERY].value.val[0]);
+}
+
+static void test_cache_error(void)
+{
+    saul_reg_t* reg = &_table[EVERY].reg;
+    phydat_t res;
+
+    _table[EVERY].ttl = TTL_MS;
+    _fakes[EVERY].error = -ECANCELED;
+    TEST_ASSERT_EQUAL_INT(-ECANCELED, saul_reg_read(reg, &res));
+
+    /* an error is not cached, the next read goes to the driver */
+    _fakes[EVERY].error = 0;
+    _fakes[EVERY].value = 1900;
+    TEST_ASSERT_EQUAL_INT(1, saul_reg_read(reg, &res));
+    TEST_ASSERT_EQUAL_INT(1900, res.val[0]);
+    TEST_ASSERT_EQUAL_INT(2, _fakes[EVERY].reads);
+    TEST_ASSERT_EQUAL_INT(0, _table[EVERY].hits);
+    TEST_ASSERT_EQUAL_INT(2, _table[EVERY].misses);
+}
+
+static void test_cache_write(void)
+{
+    saul_reg_t* reg = &_table[EVERY].reg;
+    phydat_t res;
+    phydat_t data = { .val = { 2500 } };
+
+    _table[EVERY].ttl = TTL_MS;
+    saul_reg_read(reg, &res);
+
+    /* a write goes to the driver and drops the cached reading */
+    TEST_ASSERT_EQUAL_INT(1, saul_reg_write(reg, &data));
+    TEST_ASSERT_EQUAL_INT(1, _fakes[EVERY].writes);
+    TEST_ASSERT_EQUAL_INT(1, saul_reg_read(reg, &res));
+    TEST_ASSERT_EQUAL_INT(2500, res.val[0]);
+    TEST_ASSERT_EQUAL_INT(2, _fakes[EVERY].reads);
+    TEST_ASSERT_EQUAL_INT(0, _table[EVERY].hits);
+}
+
+Test *tests_sensor_table(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_due),
+        new_TestFixture(test_payload_len),
+        new_TestFixture(test_cache_ttl),
+        new_TestFixture(test_cache_error),
+        new_TestFixture(test_cache_write),
+    };
+
+    EMB_UNIT_TESTCALLER(sensor_table_tests, set_up, tear_down, fixtures);
+
+    return (Test *)&sensor_table_tests;
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_sensor_table());
+    TESTS_END();
+
+    return 0;
+}
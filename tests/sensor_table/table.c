@@ -0,0 +1,2 @@
+/* sensor table under test */
+#include "sensor_table.c"
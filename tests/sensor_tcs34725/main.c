@@ -0,0 +1,263 @@
+/*
+ * Light encoding of the uplink payload and the calibration record.
+ *
+ * Every deci-lux value the driver can report is encoded and decoded again.
+ * The largest relative error per decade is printed in the format of the
+ * table in sensor_tcs34725.h, which is copied from this output, and compared
+ * with the values of that table.
+ *
+ * Calibration records are read from a fake modem file. Every word is tried
+ * just inside and just outside its range, and the worst case sums of the
+ * driver are checked against int32 for the ranges.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "embUnit.h"
+
+#include "sensor_tcs34725.h"
+#include "tcs34725-internal.h"
+#include "modem.h"
+
+/* the table in sensor_tcs34725.h, in 0.01 % */
+static const struct {
+    uint32_t from;          /* deci-lux */
+    uint32_t to;            /* deci-lux, 0 for the largest code */
+    uint32_t error;
+} _table[] = {
+    {      1,     10,   0 },
+    {     10,    100, 417 },
+    {    100,   1000, 284 },
+    {   1000,  10000, 271 },
+    {  10000, 100000, 271 },
+    { 100000,      0, 271 },
+};
+
+static uint8_t _file[CALIB_TCS34725_SIZE];
+static bool _file_present;
+static tcs34725_calib_t _applied;
+static unsigned _applies;
+
+/* the DN40 defaults of the driver, as a record */
+static const int16_t _dn40[] = {
+    TCS34725_CALIB_ONE,
+    TCS34725_CALIB_ONE, TCS34725_CALIB_ONE, TCS34725_CALIB_ONE, TCS34725_CALIB_ONE,
+    0, 0, 0, 0,
+    DGF_IF, R_COEF_IF, G_COEF_IF, B_COEF_IF, CT_COEF_IF, CT_OFFSET_IF,
+};
+
+/* range of each word, as documented in sensor_tcs34725.h */
+static const int32_t _bounds[][2] = {
+    { CALIB_TCS34725_GA_MIN, CALIB_TCS34725_GA_MAX },
+    { CALIB_TCS34725_GAIN_MIN, CALIB_TCS34725_GAIN_MAX },
+    { CALIB_TCS34725_GAIN_MIN, CALIB_TCS34725_GAIN_MAX },
+    { CALIB_TCS34725_GAIN_MIN, CALIB_TCS34725_GAIN_MAX },
+    { CALIB_TCS34725_GAIN_MIN, CALIB_TCS34725_GAIN_MAX },
+    { 0, CALIB_TCS34725_DARK_MAX },
+    { 0, CALIB_TCS34725_DARK_MAX },
+    { 0, CALIB_TCS34725_DARK_MAX },
+    { 0, CALIB_TCS34725_DARK_MAX },
+    { CALIB_TCS34725_DGF_MIN, CALIB_TCS34725_DGF_MAX },
+    { -CALIB_TCS34725_RB_COEF_MAX, CALIB_TCS34725_RB_COEF_MAX },
+    { CALIB_TCS34725_G_COEF_MIN, CALIB_TCS34725_G_COEF_MAX },
+    { -CALIB_TCS34725_RB_COEF_MAX, CALIB_TCS34725_RB_COEF_MAX },
+    { CALIB_TCS34725_CT_COEF_MIN, CALIB_TCS34725_CT_COEF_MAX },
+    { -CALIB_TCS34725_CT_OFFSET_MAX, CALIB_TCS34725_CT_OFFSET_MAX },
+};
+
+#define WORDS   (sizeof(_dn40) / sizeof(_dn40[0]))
+
+modem_status_t modem_read_file(uint8_t file_id, uint32_t offset, uint32_t size,
+                               uint8_t* buffer)
+{
+    if (!_file_present || file_id != LIGHT_CALIB_FILE_ID ||
+        offset + size > sizeof(_file)) {
+        return MODEM_STATUS_COMMAND_COMPLETED_ERROR;
+    }
+    memcpy(buffer, &_file[offset], size);
+    return MODEM_STATUS_COMMAND_COMPLETED_SUCCESS;
+}
+
+void tcs34725_set_calib(tcs34725_t *dev, const tcs34725_calib_t *calib)
+{
+    (void)dev;
+    _applied = *calib;
+    _applies++;
+}
+
+static void _record(const int16_t *words)
+{
+    _file[0] = CALIB_TCS34725_MAGIC;
+    _file[1] = CALIB_TCS34725_VERSION;
+    for (unsigned i = 0; i < WORDS; i++) {
+        _file[2 + 2 * i] = (uint16_t)words[i] & 0xff;
+        _file[3 + 2 * i] = (uint16_t)words[i] >> 8;
+    }
+    _file_present = true;
+}
+
+/* try one word of the DN40 record at the given value */
+static int _load_with(unsigned word, int32_t val)
+{
+    int16_t words[WORDS];
+    tcs34725_t dev;
+
+    memcpy(words, _dn40, sizeof(words));
+    words[word] = val;
+    _record(words);
+    return load_calib_tcs34725(&dev);
+}
+
+static void set_up(void)
+{
+    memset(_file, 0, sizeof(_file));
+    _file_present = false;
+    _applies = 0;
+}
+
+static void _print_lux(char *buf, uint32_t dlux)
+{
+    if (dlux < 10) {
+        sprintf(buf, "0.%"PRIu32, dlux);
+    }
+    else {
+        sprintf(buf, "%"PRIu32, dlux / 10);
+    }
+}
+
+static void test_error_table(void)
+{
+    uint32_t max_dlux = decode_lux(255);
+    unsigned wrong = 0;
+
+    puts(" *     range [lux]     | max. rel. error");
+    puts(" *     ----------------+----------------");
+    for (unsigned i = 0; i < sizeof(_table) / sizeof(_table[0]); i++) {
+        uint32_t to = _table[i].to ? _table[i].to : max_dlux;
+        uint32_t error = 0;
+        for (uint32_t dlux = _table[i].from; dlux <= to; dlux++) {
+            uint32_t back = decode_lux(encode_lux(dlux));
+            uint32_t diff = (back > dlux) ? back - dlux : dlux - back;
+            /* rounded up to 0.01 % */
+            uint32_t e = (uint32_t)(((uint64_t)diff * 10000 + dlux - 1) / dlux);
+            if (e > error) {
+                error = e;
+            }
+        }
+        char range[24];
+        _print_lux(range, _table[i].from);
+        strcat(range, " - ");
+        _print_lux(range + strlen(range), to);
+        printf(" *     %-16s| %"PRIu32".%02"PRIu32" %%\n", range, error / 100, error % 100);
+        wrong += (error != _table[i].error);
+    }
+    TEST_ASSERT_MESSAGE(wrong == 0, "update the table in sensor_tcs34725.h");
+}
+
+static void test_monotonic(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, encode_lux(0));
+    TEST_ASSERT_EQUAL_INT(1, encode_lux(1));
+    TEST_ASSERT_EQUAL_INT(255, encode_lux(UINT32_MAX));
+    for (unsigned code = 1; code < 255; code++) {
+        TEST_ASSERT(decode_lux(code) <= decode_lux(code + 1));
+        /* above 10 lux each code decodes to a distinct value */
+        if (decode_lux(code) >= 100) {
+            TEST_ASSERT_EQUAL_INT(code, encode_lux(decode_lux(code)));
+        }
+    }
+}
+
+static void test_calib_dn40(void)
+{
+    tcs34725_t dev;
+
+    _record(_dn40);
+    TEST_ASSERT_EQUAL_INT(0, load_calib_tcs34725(&dev));
+    TEST_ASSERT_EQUAL_INT(1, _applies);
+    TEST_ASSERT_EQUAL_INT(TCS34725_CALIB_ONE, _applied.ga);
+    TEST_ASSERT_EQUAL_INT(TCS34725_CALIB_ONE, _applied.gain[3]);
+    TEST_ASSERT_EQUAL_INT(DGF_IF, _applied.dgf);
+    TEST_ASSERT_EQUAL_INT(B_COEF_IF, _applied.b_coef);
+    TEST_ASSERT_EQUAL_INT(CT_OFFSET_IF, _applied.ct_offset);
+}
+
+static void test_calib_missing(void)
+{
+    tcs34725_t dev;
+
+    TEST_ASSERT_EQUAL_INT(1, load_calib_tcs34725(&dev));
+    _record(_dn40);
+    _file[0] = 0;
+    TEST_ASSERT_EQUAL_INT(1, load_calib_tcs34725(&dev));
+    _file[0] = CALIB_TCS34725_MAGIC;
+    _file[1] = CALIB_TCS34725_VERSION + 1;
+    TEST_ASSERT_EQUAL_INT(1, load_calib_tcs34725(&dev));
+    TEST_ASSERT_EQUAL_INT(0, _applies);
+}
+
+static void test_calib_bounds(void)
+{
+    for (unsigned i = 0; i < WORDS; i++) {
+        int32_t min = _bounds[i][0];
+        int32_t max = _bounds[i][1];
+        TEST_ASSERT_EQUAL_INT(0, _load_with(i, min));
+        TEST_ASSERT_EQUAL_INT(0, _load_with(i, max));
+        /* unsigned words are sent as 16 bit, the driver treats them so */
+        if (min > INT16_MIN) {
+            TEST_ASSERT_EQUAL_INT(1, _load_with(i, min - 1));
+        }
+        TEST_ASSERT_EQUAL_INT(1, _load_with(i, max + 1));
+    }
+    TEST_ASSERT_EQUAL_INT(2 * WORDS, _applies);
+
+    /* 0xffff as a gain, was accepted before */
+    TEST_ASSERT_EQUAL_INT(1, _load_with(1, -1));
+    TEST_ASSERT_EQUAL_INT(2 * WORDS, _applies);
+}
+
+static void test_calib_no_overflow(void)
+{
+    /* worst case of tcs34725_read(): every count at its maximum after the
+     * channel gain, the IR estimate (r + g + b - c) / 2 moves a channel by
+     * at most the full count, to 1.5 times the count at most */
+    int64_t dgf_ga = ((int64_t)CALIB_TCS34725_DGF_MAX * CALIB_TCS34725_GA_MAX) >>
+                     TCS34725_CALIB_SHIFT;
+    for (uint32_t cycles = 1; cycles <= 256; cycles++) {
+        int64_t count = ((int64_t)TCS34725_MAX_COUNT(cycles) * CALIB_TCS34725_GAIN_MAX) >>
+                        TCS34725_CALIB_SHIFT;
+        int64_t chan = (3 * count) / 2;
+        int64_t gi = (2 * CALIB_TCS34725_RB_COEF_MAX + CALIB_TCS34725_G_COEF_MAX) * chan;
+        int64_t ct = CALIB_TCS34725_CT_COEF_MAX * chan + CALIB_TCS34725_CT_OFFSET_MAX;
+        /* lowest gain, the largest 1/CPL */
+        int64_t dlux = (gi * 10 * dgf_ga) / (cycles * TCS34725_ATIME_MIN);
+        TEST_ASSERT(gi <= INT32_MAX);
+        TEST_ASSERT(ct <= INT32_MAX);
+        TEST_ASSERT(dlux <= INT32_MAX);
+    }
+}
+
+static Test *tests_sensor_tcs34725(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_error_table),
+        new_TestFixture(test_monotonic),
+        new_TestFixture(test_calib_dn40),
+        new_TestFixture(test_calib_missing),
+        new_TestFixture(test_calib_bounds),
+        new_TestFixture(test_calib_no_overflow),
+    };
+
+    EMB_UNIT_TESTCALLER(sensor_tcs34725_tests, set_up, NULL, fixtures);
+
+    return (Test *)&sensor_tcs34725_tests;
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_sensor_tcs34725());
+    TESTS_END();
+
+    return 0;
+}
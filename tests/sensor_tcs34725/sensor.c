@@ -0,0 +1,2 @@
+/* the sensor module under test, reading the calibration from the fake modem */
+#include "sensor_tcs34725.c"
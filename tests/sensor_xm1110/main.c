@@ -0,0 +1,446 @@
+/*
+ * Fix handling, RMC parser and assisted start of the GPS module.
+ *
+ * The xm1110 driver is replaced by the functions below: reads return the
+ * NMEA sentences queued by the test, the time and position injected for an
+ * assisted start are recorded. The module runs on a test clock.
+ *
+ * The RMC parser is checked against a corpus of sentences at and beyond the
+ * limits of every field, and fuzzed with random edits of the valid ones.
+ * The edited sentences mostly get a correct checksum, so that the field
+ * checks are reached.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "embUnit.h"
+
+#include "sensor_xm1110.h"
+#include "timebase.h"
+
+#define DAYS_INVALID    (UINT32_MAX)
+#define SENTENCE_MAX    (96)
+
+#ifndef FUZZ_RUNS
+#define FUZZ_RUNS       (50000)
+#endif
+
+void sensor_xm1110_reset(void);
+uint32_t sensor_xm1110_days(uint16_t year, uint8_t month, uint8_t day);
+void sensor_xm1110_to_time(uint32_t epoch, xm1110_time_t* time);
+
+static uint32_t _now;
+static xm1110_t _dev;
+static xm1110_data_t _buf;
+static char _nmea[XM1110_BUFFER_SIZE];  /* output of the next read */
+static size_t _nmea_len;
+static xm1110_time_t _seed_time;
+static unsigned _seeds;
+
+uint32_t time_now_ms(void)
+{
+    return _now;
+}
+
+void time_set_msg(ztimer_t* timer, uint32_t ms, msg_t* msg, kernel_pid_t pid)
+{
+    (void)timer; (void)ms; (void)msg; (void)pid;
+}
+
+int xm1110_read(const xm1110_t *dev, xm1110_data_t *xmdata)
+{
+    (void)dev;
+    memcpy(xmdata->data, _nmea, _nmea_len);
+    xmdata->len = _nmea_len;
+    _nmea_len = 0;
+    return 0;
+}
+
+int xm1110_set_gps_active(const xm1110_t *dev)
+{
+    (void)dev;
+    return XM1110_OK;
+}
+
+void xm1110_set_gps_standby(const xm1110_t *dev)
+{
+    (void)dev;
+}
+
+int xm1110_set_time(const xm1110_t *dev, const xm1110_time_t *time)
+{
+    (void)dev;
+    _seed_time = *time;
+    _seeds++;
+    return XM1110_OK;
+}
+
+int xm1110_set_ref_position(const xm1110_t *dev, int32_t latitude, int32_t longitude,
+                            int16_t altitude, const xm1110_time_t *time)
+{
+    (void)dev; (void)latitude; (void)longitude; (void)altitude; (void)time;
+    return XM1110_OK;
+}
+
+int xm1110_set_periodic(const xm1110_t *dev, uint32_t run_ms, uint32_t sleep_ms)
+{
+    (void)dev; (void)run_ms; (void)sleep_ms;
+    return XM1110_OK;
+}
+
+int xm1110_set_alwayslocate(const xm1110_t *dev)
+{
+    (void)dev;
+    return XM1110_OK;
+}
+
+int xm1110_set_normal(const xm1110_t *dev)
+{
+    (void)dev;
+    return XM1110_OK;
+}
+
+int xm1110_set_nmea_output(const xm1110_t *dev, uint8_t rmc, uint8_t gga)
+{
+    (void)dev; (void)rmc; (void)gga;
+    return XM1110_OK;
+}
+
+int xm1110_set_update_rate(const xm1110_t *dev, uint16_t interval_ms)
+{
+    (void)dev; (void)interval_ms;
+    return XM1110_OK;
+}
+
+int xm1110_get_epo_sets(const xm1110_t *dev)
+{
+    (void)dev;
+    return 0;
+}
+
+//queue body as a sentence with checksum and line ending for the next read
+static void _sentence(const char *body)
+{
+    uint8_t cs = 0;
+    for (const char *c = body; *c; c++) {
+        cs ^= (uint8_t)*c;
+    }
+    _nmea_len += snprintf(&_nmea[_nmea_len], sizeof(_nmea) - _nmea_len, "$%s*%02X\r\n",
+                          body, cs);
+}
+
+//an RMC and GGA pair of a good fix at hhmmss on ddmmyy, at ddmm.mmmm N and dddmm.mmmm E
+static void _fix_at_pos(const char *hhmmss, const char *ddmmyy, const char *lat, const char *lon)
+{
+    char body[96];
+    snprintf(body, sizeof(body), "GPRMC,%s.000,A,%s,N,%s,E,0.0,0.0,%s,,,A",
+             hhmmss, lat, lon, ddmmyy);
+    _sentence(body);
+    snprintf(body, sizeof(body), "GPGGA,%s.000,%s,N,%s,E,1,08,0.9,12.0,M,47.0,M,,",
+             hhmmss, lat, lon);
+    _sentence(body);
+    read_gps_xm1110(&_dev, &_buf);
+}
+
+static void _fix_at(const char *hhmmss, const char *ddmmyy)
+{
+    _fix_at_pos(hhmmss, ddmmyy, "5110.5000", "00342.7000");
+}
+
+/* RMC bodies and what the parser makes of them */
+static const struct {
+    const char *body;
+    bool ok;
+    uint32_t time;
+    uint32_t date;
+    int32_t latitude;
+    int32_t longitude;
+} _corpus[] = {
+    { "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W",
+      true, 45319, 230394, 48117300, 11516667 },
+    { "GNRMC,000000.000,A,0000.0000,S,00000.0000,W,0.0,0.0,010100,,,A",
+      true, 0, 10100, 0, 0 },
+    { "GPRMC,235959.99,A,9000.0000,N,18000.0000,W,,,311299,,,",
+      true, 86399, 311299, 90000000, -180000000 },
+    { "GPRMC,101010,A,5110.123456,S,00342.654321,E,0,0,290224,,",
+      true, 36610, 290224, -51168724, 3710905 },
+    { "GPRMC,101010,A,5110.5,N,00342.7,E,0,0,010124",
+      true, 36610, 10124, 51175000, 3711667 },
+    /* void fix, no time */
+    { "GPRMC,123519,V,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    /* time width and range */
+    { "GPRMC,12351,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,1235190,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519x,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,240000,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,126000,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123560,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    /* latitude width, range and hemisphere */
+    { "GPRMC,123519,A,487.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,04807.038,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807.,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807.0380000,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4860.000,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,9000.001,N,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,9100.000,S,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,E,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,NN,01131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,,01131.000,E,022.4,084.4,230394,003.1,W" },
+    /* longitude width, range and hemisphere */
+    { "GPRMC,123519,A,4807.038,N,1131.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,011310.000,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,18000.001,E,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,19000.000,W,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,01131.000,N,022.4,084.4,230394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,01131.000,EW,022.4,084.4,230394,003.1,W" },
+    /* date width and range */
+    { "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,23039,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,2303944,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394x,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,320394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,231394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,000394,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,290223,003.1,W" },
+    { "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,310494,003.1,W" },
+    /* cut off */
+    { "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4" },
+    { "GPRMC,123519,A,4807.038,N" },
+    { "GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,," },
+};
+
+#define CORPUS_NUMOF    (sizeof(_corpus) / sizeof(_corpus[0]))
+
+//body framed as "$<body>*<checksum>", without line ending, returns the length
+static size_t _frame(char *buf, const char *body, size_t len, uint8_t cs_xor)
+{
+    uint8_t cs = 0;
+    for (size_t i = 0; i < len; i++) {
+        cs ^= (uint8_t)body[i];
+    }
+    buf[0] = '$';
+    memcpy(&buf[1], body, len);
+    snprintf(&buf[1 + len], 4, "*%02X", cs ^ cs_xor);
+    return len + 4;
+}
+
+static uint32_t _random(void)
+{
+    /* xorshift32, the same sequence on every run */
+    static uint32_t x = 2463534242UL;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static void test_rmc_corpus(void)
+{
+    char s[SENTENCE_MAX];
+
+    for (unsigned i = 0; i < CORPUS_NUMOF; i++) {
+        gps_rmc_t rmc;
+        size_t len = _frame(s, _corpus[i].body, strlen(_corpus[i].body), 0);
+        bool ok = parse_rmc_xm1110(s, len, &rmc);
+        if (ok != _corpus[i].ok) {
+            printf("%s: %s\n", _corpus[i].body, ok ? "accepted" : "rejected");
+        }
+        TEST_ASSERT(ok == _corpus[i].ok);
+        if (ok) {
+            TEST_ASSERT_EQUAL_INT(_corpus[i].time, rmc.time);
+            TEST_ASSERT_EQUAL_INT(_corpus[i].date, rmc.date);
+            TEST_ASSERT_EQUAL_INT(_corpus[i].latitude, rmc.latitude);
+            TEST_ASSERT_EQUAL_INT(_corpus[i].longitude, rmc.longitude);
+            /* and never with a wrong checksum */
+            len = _frame(s, _corpus[i].body, strlen(_corpus[i].body), 0x01);
+            TEST_ASSERT(!parse_rmc_xm1110(s, len, &rmc));
+        }
+    }
+}
+
+static void test_rmc_fuzz(void)
+{
+    static const char chars[] = "0123456789.,-*$ANSEWV";
+    unsigned accepted = 0;
+
+    for (unsigned run = 0; run < FUZZ_RUNS; run++) {
+        char body[SENTENCE_MAX];
+        char s[SENTENCE_MAX];
+        const char *from;
+        do {
+            from = _corpus[_random() % CORPUS_NUMOF].body;
+        } while (!strstr(from, "RMC"));
+        size_t len = strlen(from);
+        memcpy(body, from, len);
+
+        for (unsigned edits = 1 + _random() % 3; edits > 0 && len > 1; edits--) {
+            size_t at = _random() % len;
+            char c = (_random() & 1) ? chars[_random() % (sizeof(chars) - 1)]
+                                     : (char)(_random() & 0xff);
+            switch (_random() % 4) {
+                case 0:
+                    body[at] = c;
+                    break;
+                case 1:
+                    memmove(&body[at], &body[at + 1], len - at - 1);
+                    len--;
+                    break;
+                case 2:
+                    if (len < SENTENCE_MAX - 8) {
+                        memmove(&body[at + 1], &body[at], len - at);
+                        body[at] = c;
+                        len++;
+                    }
+                    break;
+                default:
+                    len = at + 1;
+                    break;
+            }
+        }
+
+        gps_rmc_t rmc;
+        size_t slen = _frame(s, body, len, (_random() % 8) ? 0 : 1 + _random() % 255);
+        if (!parse_rmc_xm1110(s, slen, &rmc)) {
+            continue;
+        }
+        accepted++;
+        TEST_ASSERT(rmc.time < 86400);
+        TEST_ASSERT(rmc.latitude >= -90000000 && rmc.latitude <= 90000000);
+        TEST_ASSERT(rmc.longitude >= -180000000 && rmc.longitude <= 180000000);
+        TEST_ASSERT(sensor_xm1110_days(2000 + rmc.date % 100, (rmc.date / 100) % 100,
+                                       rmc.date / 10000) != DAYS_INVALID);
+    }
+    printf("%u of %u edited sentences accepted\n", accepted, FUZZ_RUNS);
+}
+
+static void set_up(void)
+{
+    _now = 1000;
+    _nmea_len = 0;
+    _seeds = 0;
+    memset(&_seed_time, 0, sizeof(_seed_time));
+    sensor_xm1110_reset();
+}
+
+static void test_days(void)
+{
+    TEST_ASSERT_EQUAL_INT(10957, sensor_xm1110_days(2000, 1, 1));
+    TEST_ASSERT_EQUAL_INT(11016, sensor_xm1110_days(2000, 2, 29));
+    TEST_ASSERT_EQUAL_INT(19722, sensor_xm1110_days(2023, 12, 31));
+    TEST_ASSERT_EQUAL_INT(19782, sensor_xm1110_days(2024, 2, 29));
+    TEST_ASSERT_EQUAL_INT(47481, sensor_xm1110_days(2099, 12, 31));
+
+    TEST_ASSERT_EQUAL_INT(DAYS_INVALID, sensor_xm1110_days(2024, 0, 1));
+    TEST_ASSERT_EQUAL_INT(DAYS_INVALID, sensor_xm1110_days(2024, 13, 1));
+    TEST_ASSERT_EQUAL_INT(DAYS_INVALID, sensor_xm1110_days(2024, 99, 1));
+    TEST_ASSERT_EQUAL_INT(DAYS_INVALID, sensor_xm1110_days(2024, 1, 0));
+    TEST_ASSERT_EQUAL_INT(DAYS_INVALID, sensor_xm1110_days(2024, 1, 32));
+    TEST_ASSERT_EQUAL_INT(DAYS_INVALID, sensor_xm1110_days(2024, 4, 31));
+    TEST_ASSERT_EQUAL_INT(DAYS_INVALID, sensor_xm1110_days(2023, 2, 29));
+    TEST_ASSERT_EQUAL_INT(DAYS_INVALID, sensor_xm1110_days(2024, 2, 30));
+}
+
+static void test_to_time(void)
+{
+    uint32_t first = sensor_xm1110_days(2000, 1, 1);
+    uint32_t last = sensor_xm1110_days(2099, 12, 31);
+
+    for (uint32_t days = first; days <= last; days++) {
+        xm1110_time_t t;
+        sensor_xm1110_to_time(days * 86400UL + 86399, &t);
+        TEST_ASSERT_EQUAL_INT(days, sensor_xm1110_days(t.year, t.month, t.day));
+        TEST_ASSERT_EQUAL_INT(23, t.hour);
+        TEST_ASSERT_EQUAL_INT(59, t.minute);
+        TEST_ASSERT_EQUAL_INT(59, t.second);
+    }
+}
+
+static void test_seed_new_year(void)
+{
+    _fix_at("235950", "311223");
+    TEST_ASSERT(get_fix_xm1110()->valid);
+
+    /* 70 s later, past the reuse time of the fix */
+    _now += 70000;
+    TEST_ASSERT_EQUAL_INT(0, start_fix_xm1110(&_dev));
+    TEST_ASSERT_EQUAL_INT(1, _seeds);
+    TEST_ASSERT_EQUAL_INT(2024, _seed_time.year);
+    TEST_ASSERT_EQUAL_INT(1, _seed_time.month);
+    TEST_ASSERT_EQUAL_INT(1, _seed_time.day);
+    TEST_ASSERT_EQUAL_INT(0, _seed_time.hour);
+    TEST_ASSERT_EQUAL_INT(1, _seed_time.minute);
+    TEST_ASSERT_EQUAL_INT(0, _seed_time.second);
+}
+
+static void test_seed_leap_day(void)
+{
+    _fix_at("235830", "280224");
+    _now += 90000;
+    TEST_ASSERT_EQUAL_INT(0, start_fix_xm1110(&_dev));
+    TEST_ASSERT_EQUAL_INT(1, _seeds);
+    TEST_ASSERT_EQUAL_INT(2, _seed_time.month);
+    TEST_ASSERT_EQUAL_INT(29, _seed_time.day);
+    TEST_ASSERT_EQUAL_INT(0, _seed_time.hour);
+    TEST_ASSERT_EQUAL_INT(0, _seed_time.minute);
+}
+
+static void test_seed_invalid_date(void)
+{
+    static const char *dates[] = { "011323", "010023", "000123", "320123", "300223" };
+
+    for (unsigned i = 0; i < sizeof(dates) / sizeof(dates[0]); i++) {
+        set_up();
+        _fix_at("120000", dates[i]);
+        _now += 70000;
+        start_fix_xm1110(&_dev);
+        TEST_ASSERT_EQUAL_INT(0, _seeds);
+    }
+}
+
+static void test_moving(void)
+{
+    /* at 51.2 N a degree of longitude is 69.7 km, one of latitude 111.2 km */
+    _fix_at_pos("120000", "010624", "5110.5000", "00342.7000");
+    TEST_ASSERT(!get_fix_xm1110()->moving);
+    _fix_at_pos("120010", "010624", "5110.5000", "00342.7350");    /* 41 m east */
+    TEST_ASSERT(!get_fix_xm1110()->moving);
+    _fix_at_pos("120020", "010624", "5110.5000", "00342.7900");    /* 64 m east */
+    TEST_ASSERT(get_fix_xm1110()->moving);
+    _fix_at_pos("120030", "010624", "5110.5240", "00342.7900");    /* 44 m north */
+    TEST_ASSERT(!get_fix_xm1110()->moving);
+    _fix_at_pos("120040", "010624", "5110.4900", "00342.7900");    /* 63 m south */
+    TEST_ASSERT(get_fix_xm1110()->moving);
+    _fix_at_pos("120050", "010624", "5110.4900", "00342.7900");
+    TEST_ASSERT(!get_fix_xm1110()->moving);
+    /* 300 m, which the old sum of micro-degrees took for standing still */
+    _fix_at_pos("120100", "010624", "5110.3400", "00342.8900");
+    TEST_ASSERT(get_fix_xm1110()->moving);
+}
+
+Test *tests_sensor_xm1110(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_days),
+        new_TestFixture(test_to_time),
+        new_TestFixture(test_seed_new_year),
+        new_TestFixture(test_seed_leap_day),
+        new_TestFixture(test_seed_invalid_date),
+        new_TestFixture(test_moving),
+        new_TestFixture(test_rmc_corpus),
+        new_TestFixture(test_rmc_fuzz),
+    };
+
+    EMB_UNIT_TESTCALLER(sensor_xm1110_tests, set_up, NULL, fixtures);
+
+    return (Test *)&sensor_xm1110_tests;
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_sensor_xm1110());
+    TESTS_END();
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+/* the GPS module under test, on the fake driver of the test */
+#include "sensor_xm1110.c"
+
+/* forget the cached fix and statistics between tests */
+void sensor_xm1110_reset(void)
+{
+    memset(&_fix, 0, sizeof(_fix));
+    memset(&_stats, 0, sizeof(_stats));
+    _have_rmc = false;
+    _have_gga = false;
+    _on = false;
+    _mode = GPS_MODE_STANDBY;
+    _sleep = 0;
+}
+
+uint32_t sensor_xm1110_days(uint16_t year, uint8_t month, uint8_t day)
+{
+    return _days(year, month, day);
+}
+
+void sensor_xm1110_to_time(uint32_t epoch, xm1110_time_t* time)
+{
+    _to_time(epoch, time);
+}
@@ -0,0 +1,2 @@
+/* charge estimate of the application, scored by the simulation */
+#include "energy.c"
@@ -0,0 +1,11 @@
+/* the application with the octa wiring, its main() is started by the
+ * simulation and the interrupt lines are driven by the sensor models */
+#include "sim.h"
+
+#define TCS34725_PARAM_INT_PIN  GPIO_PIN(PORT_B, 14)
+#define gpio_init_int           sim_gpio_init_int
+#define gpio_irq_enable         sim_gpio_irq_enable
+#define main                    eguard_main
+
+#include "main.c"
+#include "settings.c"
@@ -0,0 +1,2 @@
+/* idle mode bookkeeping of the application */
+#include "power.c"
@@ -0,0 +1,5 @@
+/* the sensor table, GPS fix handling and lux encoding of the application,
+ * the drivers below them are the models of the simulation */
+#include "sensor_table.c"
+#include "sensor_xm1110.c"
+#include "sensor_tcs34725.c"
@@ -0,0 +1,177 @@
+/*
+ * GPS module model of the simulation, below the GPS module of the
+ * application.
+ *
+ * Woken from standby, the module outputs RMC and GGA once a second, void
+ * until it has a fix. Under the sky it gets one SIM_TTFF_MS after waking,
+ * or SIM_TTFF_SEEDED_MS with time and position injected, never indoors. In
+ * periodic and AlwaysLocate mode it keeps tracking by itself, so the fix is
+ * there right away under the sky. The clock starts on 1 June 2024, 00:00 UTC;
+ * in transport the device drives east.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "xm1110.h"
+
+#include "timebase.h"
+#include "sim.h"
+
+#ifndef SIM_TTFF_MS
+#define SIM_TTFF_MS         (35000U)    /* warm start */
+#endif
+#ifndef SIM_TTFF_SEEDED_MS
+#define SIM_TTFF_SEEDED_MS  (8000U)     /* time and position injected */
+#endif
+
+#define LATITUDE            (50 * 600000L + 527880L)    /* 1e-4 minutes, 50°52.788' N */
+#define LONGITUDE           (4 * 600000L + 421380L)     /* 1e-4 minutes, 4°42.138' E */
+#define SPEED               (50)        /* 1e-4 minutes per second, about 30 km/h */
+
+static bool _awake;
+static bool _tracking;      /* periodic or AlwaysLocate */
+static bool _seeded;
+static uint32_t _woken;
+
+int xm1110_init(xm1110_t* dev, const xm1110_params_t* params)
+{
+    dev->p = *params;
+    _awake = true;
+    _tracking = false;
+    _woken = time_now_ms();
+    return XM1110_OK;
+}
+
+int xm1110_set_gps_active(const xm1110_t* dev)
+{
+    (void)dev;
+    if (!_awake) {
+        _awake = true;
+        _seeded = false;
+        _woken = time_now_ms();
+    }
+    return XM1110_OK;
+}
+
+void xm1110_set_gps_standby(const xm1110_t* dev)
+{
+    (void)dev;
+    _awake = false;
+}
+
+int xm1110_set_time(const xm1110_t* dev, const xm1110_time_t* time)
+{
+    (void)dev; (void)time;
+    _seeded = true;
+    return XM1110_OK;
+}
+
+int xm1110_set_ref_position(const xm1110_t* dev, int32_t latitude, int32_t longitude,
+                            int16_t altitude, const xm1110_time_t* time)
+{
+    (void)dev; (void)latitude; (void)longitude; (void)altitude; (void)time;
+    return XM1110_OK;
+}
+
+int xm1110_set_periodic(const xm1110_t* dev, uint32_t run_ms, uint32_t sleep_ms)
+{
+    (void)dev; (void)run_ms; (void)sleep_ms;
+    _tracking = true;
+    return XM1110_OK;
+}
+
+int xm1110_set_alwayslocate(const xm1110_t* dev)
+{
+    (void)dev;
+    _tracking = true;
+    return XM1110_OK;
+}
+
+int xm1110_set_normal(const xm1110_t* dev)
+{
+    (void)dev;
+    _tracking = false;
+    return XM1110_OK;
+}
+
+int xm1110_set_nmea_output(const xm1110_t* dev, uint8_t rmc, uint8_t gga)
+{
+    (void)dev; (void)rmc; (void)gga;
+    return XM1110_OK;
+}
+
+int xm1110_set_update_rate(const xm1110_t* dev, uint16_t interval_ms)
+{
+    (void)dev; (void)interval_ms;
+    return XM1110_OK;
+}
+
+int xm1110_get_epo_sets(const xm1110_t* dev)
+{
+    (void)dev;
+    return 0;
+}
+
+//ddmmyy of a day since 1 June 2024
+static uint32_t _date(uint32_t day)
+{
+    static const uint8_t days[] = { 30, 31, 31, 30, 31, 30, 31 };
+    unsigned month = 0;
+
+    while (month < sizeof(days) - 1 && day >= days[month]) {
+        day -= days[month++];
+    }
+    return (day + 1) * 10000UL + (month + 6) * 100UL + 24;
+}
+
+//append body as a sentence with checksum and line ending
+static void _sentence(xm1110_data_t* xmdata, const char* body)
+{
+    uint8_t cs = 0;
+    for (const char* c = body; *c; c++) {
+        cs ^= (uint8_t)*c;
+    }
+    xmdata->len += snprintf(&xmdata->data[xmdata->len], sizeof(xmdata->data) - xmdata->len,
+                            "$%s*%02X\r\n", body, cs);
+}
+
+int xm1110_read(const xm1110_t* dev, xm1110_data_t* xmdata)
+{
+    (void)dev;
+    uint32_t now = time_now_ms();
+    uint32_t s = now / 1000;
+    uint32_t hhmmss = ((s / 3600) % 24) * 10000 + ((s / 60) % 60) * 100 + s % 60;
+    uint32_t date = _date(s / 86400);
+    sim_env_t env;
+    char body[96];
+
+    sim_env(&env);
+    xmdata->len = 0;
+    if (!_awake && !_tracking) {
+        return XM1110_OK;
+    }
+    uint32_t ttff = _seeded ? SIM_TTFF_SEEDED_MS : SIM_TTFF_MS;
+    if (!env.sky || (!_tracking && now - _woken < ttff)) {
+        snprintf(body, sizeof(body), "GPRMC,%06lu.000,V,,,,,0.00,0.00,%06lu,,,N",
+                 (unsigned long)hhmmss, (unsigned long)date);
+        _sentence(xmdata, body);
+        snprintf(body, sizeof(body), "GPGGA,%06lu.000,,,,,0,00,99.9,,M,,M,,",
+                 (unsigned long)hhmmss);
+        _sentence(xmdata, body);
+        return XM1110_OK;
+    }
+
+    int32_t lat = LATITUDE;
+    int32_t lon = LONGITUDE + (env.moving ? (int32_t)((s * SPEED) % 600000) : 0);
+    char pos[40];
+    snprintf(pos, sizeof(pos), "%02ld%02ld.%04ld,N,%03ld%02ld.%04ld,E",
+             (long)(lat / 600000), (long)((lat / 10000) % 60), (long)(lat % 10000),
+             (long)(lon / 600000), (long)((lon / 10000) % 60), (long)(lon % 10000));
+    snprintf(body, sizeof(body), "GPRMC,%06lu.000,A,%s,0.00,0.00,%06lu,,,A",
+             (unsigned long)hhmmss, pos, (unsigned long)date);
+    _sentence(xmdata, body);
+    snprintf(body, sizeof(body), "GPGGA,%06lu.000,%s,1,08,0.9,30.0,M,47.0,M,,",
+             (unsigned long)hhmmss, pos);
+    _sentence(xmdata, body);
+    return XM1110_OK;
+}
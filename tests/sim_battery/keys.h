@@ -0,0 +1,2 @@
+/* the simulation sends nothing, the template keys do */
+#include "template_keys.h"
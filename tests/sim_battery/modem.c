@@ -0,0 +1,70 @@
+/*
+ * Modem model of the simulation.
+ *
+ * An uplink gets through with the chance the present place gives its
+ * interface. A D7 uplink is answered by a gateway after SIM_D7_RESPONSE_MS,
+ * or times out after SIM_D7_TIMEOUT_MS. A LoRaWAN uplink takes its time on
+ * air and the two receive windows, a failed one is reported as an error.
+ * The outcomes come from a fixed random sequence, the same on every run.
+ */
+#include <string.h>
+
+#include "modem.h"
+#include "comm/tx_queue.h"
+
+#include "sim.h"
+
+#ifndef SIM_D7_RESPONSE_MS
+#define SIM_D7_RESPONSE_MS  (300U)
+#endif
+#ifndef SIM_D7_TIMEOUT_MS
+#define SIM_D7_TIMEOUT_MS   (3000U)
+#endif
+#ifndef SIM_LORA_RX_MS
+#define SIM_LORA_RX_MS      (2100U)     /* RX1 after 1 s, RX2 after 2 s */
+#endif
+
+static uint32_t _random(void)
+{
+    /* xorshift32 */
+    static uint32_t x = 2463534242UL;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+void modem_init(uart_t uart, modem_callbacks_t* cbs)
+{
+    (void)uart; (void)cbs;
+}
+
+//the UID file only, there is no light sensor calibration on the modem
+modem_status_t modem_read_file(uint8_t file_id, uint32_t offset, uint32_t size, uint8_t* buffer)
+{
+    (void)offset;
+    if (file_id != D7A_FILE_UID_FILE_ID) {
+        return MODEM_STATUS_COMMAND_COMPLETED_ERROR;
+    }
+    memset(buffer, 0x5a, size);
+    return MODEM_STATUS_COMMAND_COMPLETED_SUCCESS;
+}
+
+//runs on the TX thread of the uplink queue, which waits for the outcome
+modem_status_t modem_send_unsolicited_response(uint8_t file_id, uint32_t offset,
+                                               uint32_t length, uint8_t* data,
+                                               alp_itf_id_t itf, void* interface_config)
+{
+    (void)file_id; (void)offset; (void)data; (void)interface_config;
+    sim_env_t env;
+    sim_env(&env);
+    bool d7 = (itf == ALP_ITF_ID_D7ASP);
+    bool ok = _random() % 100 < (d7 ? env.d7 : env.lora);
+
+    if (d7) {
+        sim_wait(ok ? SIM_D7_RESPONSE_MS : SIM_D7_TIMEOUT_MS);
+        return ok ? MODEM_STATUS_COMMAND_COMPLETED_SUCCESS : MODEM_STATUS_COMMAND_TIMEOUT;
+    }
+    sim_wait(tx_queue_airtime_us(itf, length) / 1000 + SIM_LORA_RX_MS);
+    return ok ? MODEM_STATUS_COMMAND_COMPLETED_SUCCESS : MODEM_STATUS_COMMAND_COMPLETED_ERROR;
+}
@@ -0,0 +1,141 @@
+/*
+ * Scripted environments of the simulation, one day each.
+ *
+ * Climate points are linear in between, a step takes two points one minute
+ * apart. Coverage is given as the percentage of uplinks that get through:
+ * D7 needs a gateway in the building, LoRaWAN reaches most places outdoors
+ * and fewer indoors. Places and falls end with an entry at minute END.
+ */
+#include "sim.h"
+
+#define END                 (1440)
+
+/* indoors without and with a D7 gateway, outdoors standing and in transport */
+#define HOME                .d7 = 0, .lora = 40
+#define OFFICE              .d7 = 95, .lora = 60
+#define YARD                .sky = true, .d7 = 0, .lora = 95
+#define ROAD                .sky = true, .moving = true, .d7 = 0, .lora = 90
+#define GLASS               .sky = true, .d7 = 90, .lora = 80
+
+/* heated office, lights on during office hours */
+static const sim_point_t _office_climate[] = {
+    {    0, 1900, 2900,      0 },
+    {  420, 1900, 2900,      0 },
+    {  479, 2100, 2700,      0 },
+    {  480, 2100, 2700,   3000 },
+    {  900, 2300, 2500,   3000 },
+    { 1080, 2200, 2600,   3000 },
+    { 1081, 2200, 2600,      0 },
+    { 1320, 1900, 2900,      0 },
+    {  END, 1900, 2900,      0 },
+};
+
+static const sim_place_t _office_places[] = {
+    { 0, OFFICE },
+    { .minute = END },
+};
+
+/* a container in the open, in the sun from dawn to dusk */
+static const sim_point_t _yard_climate[] = {
+    {    0, 1200, 8500,      0 },
+    {  330, 1000, 9000,      0 },
+    {  360, 1100, 8800,    100 },
+    {  480, 1600, 7500,  80000 },
+    {  840, 2600, 5000, 300000 },
+    { 1080, 2200, 6000,  60000 },
+    { 1260, 1600, 7500,    100 },
+    { 1290, 1500, 8000,      0 },
+    {  END, 1200, 8500,      0 },
+};
+
+static const sim_place_t _yard_places[] = {
+    { 0, YARD },
+    { .minute = END },
+};
+
+/* carried to the office and back, dropped now and then */
+static const sim_point_t _commute_climate[] = {
+    {    0, 1800, 2800,      0 },
+    {  419, 1800, 2800,      0 },
+    {  420, 1900, 2800,   2000 },
+    {  449, 1900, 2800,   2000 },
+    {  450, 1100, 7000,  50000 },
+    {  494, 1200, 6800,  60000 },
+    {  495, 2100, 2700,   3000 },
+    { 1019, 2300, 2500,   3000 },
+    { 1020, 1700, 6000,  30000 },
+    { 1064, 1600, 6200,  20000 },
+    { 1065, 2000, 2800,   2000 },
+    { 1380, 1900, 2800,   2000 },
+    { 1381, 1900, 2800,      0 },
+    {  END, 1800, 2800,      0 },
+};
+
+static const sim_place_t _commute_places[] = {
+    {    0, HOME },
+    {  450, ROAD },
+    {  495, OFFICE },
+    { 1020, ROAD },
+    { 1065, HOME },
+    { .minute = END },
+};
+
+static const uint16_t _commute_falls[] = { 455, 730, 1060, END };
+
+/* under glass with a D7 gateway, too hot at noon */
+static const sim_point_t _greenhouse_climate[] = {
+    {    0, 1600, 8000,      0 },
+    {  360, 1500, 8500,    200 },
+    {  600, 2700, 7000, 150000 },
+    {  720, 3300, 6000, 250000 },
+    {  900, 3200, 6000, 200000 },
+    { 1020, 2600, 7000,  60000 },
+    { 1260, 1800, 8000,    200 },
+    { 1290, 1700, 8000,      0 },
+    {  END, 1600, 8000,      0 },
+};
+
+static const sim_place_t _greenhouse_places[] = {
+    { 0, GLASS },
+    { .minute = END },
+};
+
+static const uint16_t _no_falls[] = { END };
+
+const sim_scenario_t sim_scenarios[] = {
+    { "office", _office_climate, _office_places, _no_falls },
+    { "yard", _yard_climate, _yard_places, _no_falls },
+    { "commute", _commute_climate, _commute_places, _commute_falls },
+    { "greenhouse", _greenhouse_climate, _greenhouse_places, _no_falls },
+};
+
+const unsigned sim_scenarios_numof = sizeof(sim_scenarios) / sizeof(sim_scenarios[0]);
+
+static int32_t _lerp(int32_t a, int32_t b, uint32_t t, uint32_t span)
+{
+    return a + (int32_t)(((int64_t)(b - a) * t) / span);
+}
+
+void sim_env_at(const sim_scenario_t* sc, uint32_t ms, sim_env_t* env)
+{
+    const sim_point_t* p = sc->climate;
+    uint16_t minute = ms / 60000;
+
+    while (p[1].minute <= minute) {
+        p++;
+    }
+    uint32_t t = ms - p[0].minute * 60000UL;
+    uint32_t span = (p[1].minute - p[0].minute) * 60000UL;
+    env->temp = _lerp(p[0].temp, p[1].temp, t, span);
+    env->hum = _lerp(p[0].hum, p[1].hum, t, span);
+    env->dlux = _lerp(p[0].dlux, p[1].dlux, t, span);
+
+    const sim_place_t* place = sc->places;
+    while (place[1].minute <= minute) {
+        place++;
+    }
+    env->sky = place->sky;
+    env->moving = place->moving;
+    env->d7 = place->d7;
+    env->lora = place->lora;
+}
@@ -0,0 +1,250 @@
+/*
+ * Sensor models of the simulation.
+ *
+ * The SHT3x and TCS34725 are read through SAUL drivers that return the
+ * scripted climate. A temperature read starts a measurement of both values
+ * and takes SIM_SHT3X_MS, the humidity read after it gets the same pair, as
+ * the real SAUL driver does. The light sensor runs its cycles with the wait
+ * time main.c configured and raises its interrupt once the clear channel
+ * stays above the threshold for the persistence cycles. Clear counts are
+ * taken as SIM_COUNTS_PER_LUX per lux. The accelerometer raises its
+ * interrupt on the scripted falls.
+ */
+#include <errno.h>
+#include <stdio.h>
+
+#include "saul.h"
+#include "sht3x.h"
+#include "tcs34725.h"
+#include "LSM303AGR.h"
+
+#include "sensors/sensor_sht3x.h"
+#include "sensors/sensor_lsm303agr.h"
+#include "timebase.h"
+#include "sim.h"
+
+#ifndef SIM_SHT3X_MS
+#define SIM_SHT3X_MS        (5)     /* single shot, low repeatability */
+#endif
+#ifndef SIM_COUNTS_PER_LUX
+#define SIM_COUNTS_PER_LUX  (2)     /* 154 ms integration at 4x gain */
+#endif
+
+#define LSM303AGR_INT_PIN   GPIO_PIN(PORT_B, 13)
+#define INTS_MAX            (2)
+
+static struct {
+    gpio_t pin;
+    gpio_cb_t cb;
+    void* arg;
+    bool enabled;
+} _ints[INTS_MAX];
+
+static int16_t _temp;
+static int16_t _hum;
+static uint32_t _measured;
+static bool _pair;
+
+static gpio_cb_t _light_cb;
+static void* _light_arg;
+static uint16_t _light_high;
+static uint8_t _light_persistence;
+static uint32_t _light_wait_ms;
+static uint8_t _light_above;
+static bool _light_latched;
+
+int sim_gpio_init_int(gpio_t pin, gpio_mode_t mode, gpio_flank_t flank, gpio_cb_t cb,
+                      void* arg)
+{
+    (void)mode; (void)flank;
+    for (int i = 0; i < INTS_MAX; i++) {
+        if (!_ints[i].cb || _ints[i].pin == pin) {
+            _ints[i].pin = pin;
+            _ints[i].cb = cb;
+            _ints[i].arg = arg;
+            _ints[i].enabled = false;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void sim_gpio_irq_enable(gpio_t pin)
+{
+    for (int i = 0; i < INTS_MAX; i++) {
+        if (_ints[i].cb && _ints[i].pin == pin) {
+            _ints[i].enabled = true;
+        }
+    }
+}
+
+void sim_fall(void)
+{
+    for (int i = 0; i < INTS_MAX; i++) {
+        if (_ints[i].enabled && _ints[i].pin == LSM303AGR_INT_PIN) {
+            _ints[i].cb(_ints[i].arg);
+        }
+    }
+}
+
+int init_sht3x(sht3x_dev_t* dev)
+{
+    (void)dev;
+    _pair = false;
+    return 0;
+}
+
+//a new pair after the TTL, measured now
+static int _sht3x_pair(void)
+{
+    if (_pair && time_now_ms() - _measured < SHT3X_SAUL_TTL_MS) {
+        return 0;
+    }
+    sim_wait(SIM_SHT3X_MS);
+    sim_env_t env;
+    sim_env(&env);
+    _temp = env.temp;
+    _hum = env.hum;
+    _measured = time_now_ms();
+    _pair = true;
+    return 0;
+}
+
+static int _read_temp(const void* dev, phydat_t* res)
+{
+    (void)dev;
+    _sht3x_pair();
+    res->val[0] = _temp;
+    res->unit = UNIT_TEMP_C;
+    res->scale = -2;
+    return 1;
+}
+
+static int _read_hum(const void* dev, phydat_t* res)
+{
+    (void)dev;
+    _sht3x_pair();
+    res->val[0] = _hum;
+    res->unit = UNIT_PERCENT;
+    res->scale = -2;
+    return 1;
+}
+
+const saul_driver_t sht3x_saul_driver_temperature = {
+    .read = _read_temp,
+    .write = saul_notsup,
+    .type = SAUL_SENSE_TEMP,
+};
+
+const saul_driver_t sht3x_saul_driver_humidity = {
+    .read = _read_hum,
+    .write = saul_notsup,
+    .type = SAUL_SENSE_HUM,
+};
+
+int init_lsm303agr(LSM303AGR_t* dev, uint8_t ths, uint8_t dur)
+{
+    (void)dev; (void)ths; (void)dur;
+    return 0;
+}
+
+int LSM303AGR_set_freefall(const LSM303AGR_t* dev, uint8_t ths, uint8_t dur)
+{
+    (void)dev; (void)ths; (void)dur;
+    return 0;
+}
+
+int tcs34725_init(tcs34725_t* dev, const tcs34725_params_t* params)
+{
+    dev->p = *params;
+    _light_wait_ms = 0;
+    _light_cb = NULL;
+    return TCS34725_OK;
+}
+
+void tcs34725_set_calib(tcs34725_t* dev, const tcs34725_calib_t* calib)
+{
+    (void)dev; (void)calib;
+}
+
+void tcs34725_set_rgbc_standby(const tcs34725_t* dev)
+{
+    (void)dev;
+}
+
+int tcs34725_set_wait(const tcs34725_t* dev, uint32_t wtime)
+{
+    (void)dev;
+    _light_wait_ms = wtime / 1000;
+    return TCS34725_OK;
+}
+
+int tcs34725_set_threshold(tcs34725_t* dev, uint16_t low, uint16_t high, uint8_t persistence)
+{
+    (void)dev; (void)low;
+    _light_high = high;
+    _light_persistence = persistence;
+    return TCS34725_OK;
+}
+
+int tcs34725_enable_int(const tcs34725_t* dev, gpio_cb_t cb, void* arg)
+{
+    (void)dev;
+    _light_cb = cb;
+    _light_arg = arg;
+    _light_above = 0;
+    _light_latched = false;
+    return TCS34725_OK;
+}
+
+int tcs34725_clear_int(const tcs34725_t* dev)
+{
+    (void)dev;
+    _light_latched = false;
+    return TCS34725_OK;
+}
+
+uint32_t sim_light_cycle(void)
+{
+    sim_env_t env;
+
+    if (!_light_cb || _light_wait_ms == 0) {
+        return 0;
+    }
+    sim_env(&env);
+    if ((env.dlux * SIM_COUNTS_PER_LUX) / 10 <= _light_high) {
+        _light_above = 0;
+        return _light_wait_ms;
+    }
+    if (_light_above < _light_persistence) {
+        _light_above++;
+    }
+    if (_light_above >= _light_persistence && !_light_latched) {
+        _light_latched = true;
+        _light_cb(_light_arg);
+    }
+    return _light_wait_ms;
+}
+
+static int _read_light(const void* dev, phydat_t* res)
+{
+    (void)dev;
+    sim_env_t env;
+    sim_env(&env);
+
+    /* deci-lux, daylight exceeds the 16 bit range */
+    res->scale = -1;
+    while (env.dlux > INT16_MAX) {
+        env.dlux /= 10;
+        res->scale++;
+    }
+    res->val[0] = (int16_t)env.dlux;
+    res->unit = UNIT_LUX;
+    return 1;
+}
+
+const saul_driver_t tcs34725_saul_driver_light = {
+    .read = _read_light,
+    .write = saul_notsup,
+    .type = SAUL_SENSE_LIGHT,
+};
@@ -0,0 +1,243 @@
+/*
+ * Battery life of the application in scripted environments.
+ *
+ * main.c of the application runs against the sensor, GPS and modem models
+ * of this simulation on a virtual clock (see sim.h). Each scenario of
+ * scenarios.c is played for SIM_DAYS days, one after the other on the same
+ * device, as it would move from one place to the next. After each scenario
+ * the charge the current model of energy.h integrated over it is printed
+ * per part and as mAh per day. The score is the mean over all scenarios,
+ * lower is better. It only depends on the code and the scenarios, so two
+ * versions of the application can be compared by their score.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "thread.h"
+#include "msg.h"
+#include "mtd.h"
+#include "board.h"
+
+#include "timebase.h"
+#include "energy.h"
+#include "sim.h"
+
+#ifndef SIM_DAYS
+#define SIM_DAYS        (1)
+#endif
+
+#define TIMERS_MAX      (4)
+#define SLEEPERS_MAX    (4)
+
+int eguard_main(void);
+
+static const char* const _parts[ENERGY_PART_NUMOF] = { "mcu", "modem", "gps", "sensors" };
+
+static uint32_t _now;
+static const sim_scenario_t* _scenario;
+static uint32_t _start;             /* when the running scenario started */
+
+static struct {
+    ztimer_t* timer;                /* NULL when the slot is free */
+    uint32_t at;
+    msg_t* msg;
+    kernel_pid_t pid;
+} _timers[TIMERS_MAX];
+
+static struct {
+    kernel_pid_t pid;               /* KERNEL_PID_UNDEF when the slot is free */
+    uint32_t at;
+} _sleepers[SLEEPERS_MAX];
+
+static char _clock_stack[THREAD_STACKSIZE_DEFAULT + THREAD_EXTRA_STACKSIZE_PRINTF];
+
+uint32_t time_now_ms(void)
+{
+    return _now;
+}
+
+//set or move the timer, as ztimer_set_msg() does
+void time_set_msg(ztimer_t* timer, uint32_t ms, msg_t* msg, kernel_pid_t pid)
+{
+    int slot = -1;
+    for (int i = 0; i < TIMERS_MAX; i++) {
+        if (_timers[i].timer == timer) {
+            slot = i;
+            break;
+        }
+        if (!_timers[i].timer && slot < 0) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        puts("sim: out of timers");
+        return;
+    }
+    _timers[slot].timer = timer;
+    _timers[slot].at = _now + ms;
+    _timers[slot].msg = msg;
+    _timers[slot].pid = pid;
+}
+
+void sim_wait(uint32_t ms)
+{
+    for (int i = 0; i < SLEEPERS_MAX; i++) {
+        if (_sleepers[i].pid == KERNEL_PID_UNDEF) {
+            _sleepers[i].pid = thread_getpid();
+            _sleepers[i].at = _now + ms;
+            /* the clock only runs once this thread sleeps */
+            thread_sleep();
+            return;
+        }
+    }
+    puts("sim: out of sleepers");
+}
+
+void sim_env(sim_env_t* env)
+{
+    sim_env_at(_scenario, (_now - _start) % SIM_DAY_MS, env);
+}
+
+//uAh per day of a charge in uA * ms over ms
+static uint32_t _per_day(uint64_t charge, uint64_t ms)
+{
+    return (charge * (SIM_DAY_MS / 3600000)) / ms;
+}
+
+//charge of a scenario per part and in total, returns the total in uA * ms
+static uint64_t _score(const uint64_t* charge, uint64_t ms)
+{
+    uint64_t total = 0;
+
+    printf("%s:", _scenario->name);
+    for (int i = 0; i < ENERGY_PART_NUMOF; i++) {
+        uint32_t uah = _per_day(charge[i], ms);
+        printf(" %s %lu.%03lu,", _parts[i], (unsigned long)(uah / 1000),
+               (unsigned long)(uah % 1000));
+        total += charge[i];
+    }
+    uint32_t uah = _per_day(total, ms);
+    printf(" total %lu.%03lu mAh/day\n", (unsigned long)(uah / 1000),
+           (unsigned long)(uah % 1000));
+    return total;
+}
+
+//play one scenario from now on, returns its charge in uA * ms
+static uint64_t _play(const sim_scenario_t* sc)
+{
+    uint64_t before[ENERGY_PART_NUMOF];
+    uint64_t after[ENERGY_PART_NUMOF];
+    uint32_t end = _now + SIM_DAYS * SIM_DAY_MS;
+    uint32_t light = _now;
+    bool light_on = true;
+    unsigned day = 0;
+    unsigned fall = 0;
+
+    _scenario = sc;
+    _start = _now;
+    energy_charge(before);
+    printf("sim: scenario %s for %u days\n", sc->name, SIM_DAYS);
+
+    while (1) {
+        /* the next event, the end of a wait before a timer at the same time */
+        uint32_t next = end - _now;
+        int sleeper = -1;
+        int timer = -1;
+        bool is_light = false;
+        bool is_fall = false;
+        for (int i = 0; i < SLEEPERS_MAX; i++) {
+            if (_sleepers[i].pid != KERNEL_PID_UNDEF && _sleepers[i].at - _now < next) {
+                next = _sleepers[i].at - _now;
+                sleeper = i;
+            }
+        }
+        for (int i = 0; i < TIMERS_MAX; i++) {
+            if (_timers[i].timer && _timers[i].at - _now < next) {
+                next = _timers[i].at - _now;
+                sleeper = -1;
+                timer = i;
+            }
+        }
+        if (light_on && light - _now < next) {
+            next = light - _now;
+            sleeper = -1;
+            timer = -1;
+            is_light = true;
+        }
+        uint32_t fall_at = _start + day * SIM_DAY_MS + sc->falls[fall] * 60000UL;
+        if (sc->falls[fall] < 1440 && fall_at - _now < next) {
+            next = fall_at - _now;
+            sleeper = -1;
+            timer = -1;
+            is_light = false;
+            is_fall = true;
+        }
+        _now += next;
+
+        if (sleeper >= 0) {
+            kernel_pid_t pid = _sleepers[sleeper].pid;
+            _sleepers[sleeper].pid = KERNEL_PID_UNDEF;
+            thread_wakeup(pid);
+        } else if (timer >= 0) {
+            /* free before sending, the receiver may set it again */
+            msg_t msg = *_timers[timer].msg;
+            _timers[timer].timer = NULL;
+            msg_send(&msg, _timers[timer].pid);
+        } else if (is_light) {
+            uint32_t wait = sim_light_cycle();
+            light = _now + wait;
+            light_on = (wait > 0);
+        } else if (is_fall) {
+            printf("sim: fall at %02u:%02u\n", sc->falls[fall] / 60, sc->falls[fall] % 60);
+            sim_fall();
+            if (sc->falls[++fall] >= 1440 && day + 1 < SIM_DAYS) {
+                fall = 0;
+                day++;
+            }
+        } else {
+            break;
+        }
+    }
+
+    energy_charge(after);
+    for (int i = 0; i < ENERGY_PART_NUMOF; i++) {
+        after[i] -= before[i];
+    }
+    return _score(after, (uint64_t)SIM_DAYS * SIM_DAY_MS);
+}
+
+static void* _clock(void* arg)
+{
+    (void)arg;
+    uint64_t total = 0;
+
+    for (unsigned i = 0; i < sim_scenarios_numof; i++) {
+        total += _play(&sim_scenarios[i]);
+    }
+    uint32_t uah = _per_day(total, (uint64_t)sim_scenarios_numof * SIM_DAYS * SIM_DAY_MS);
+    printf("score: %lu.%03lu mAh/day over %u scenarios", (unsigned long)(uah / 1000),
+           (unsigned long)(uah % 1000), sim_scenarios_numof);
+    if (uah) {
+        printf(", %lu days on %u mAh", (unsigned long)((uint64_t)ENERGY_BATTERY_MAH * 1000 / uah),
+               ENERGY_BATTERY_MAH);
+    }
+    printf("\n");
+    puts("[SUCCESS]");
+    return NULL;
+}
+
+int main(void)
+{
+    /* start from an empty sample log, the file of the native flash stays */
+    mtd_dev_t* mtd = MTD_0;
+    uint32_t sector_size = mtd->pages_per_sector * mtd->page_size;
+    if (mtd_init(mtd) == 0) {
+        mtd_erase(mtd, (mtd->sector_count - SAMPLE_LOG_SECTORS) * sector_size,
+                  SAMPLE_LOG_SECTORS * sector_size);
+    }
+
+    /* the clock only runs while the application waits */
+    thread_create(_clock_stack, sizeof(_clock_stack), THREAD_PRIORITY_IDLE - 1,
+                  THREAD_CREATE_STACKTEST, _clock, NULL, "sim_clock");
+    return eguard_main();
+}
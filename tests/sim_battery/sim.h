@@ -0,0 +1,87 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "periph/gpio.h"
+
+/*
+ * Battery simulation of the application on the native board.
+ *
+ * main.c runs unchanged on a virtual clock. The clock is a thread just above
+ * idle: it only runs when the application threads all wait, and then moves
+ * time to the next event, a timer, the end of a sensor read or uplink, a
+ * light sensor cycle or a scripted fall. A simulated day takes seconds.
+ *
+ * The sensors behind SAUL, the GPS module and the modem are replaced by
+ * models of the scripted environment of a scenario: temperature, humidity
+ * and light as curves over the day, and whether the device is indoors, in
+ * D7 coverage, or outdoors, in LoRaWAN coverage and under the sky.
+ */
+#define SIM_DAY_MS          (86400000UL)
+
+/* ports of the octa pins main.c uses */
+#define PORT_B              (1)
+#define PORT_G              (6)
+
+typedef struct {
+    int16_t temp;           /**< centi-degrees Celsius */
+    int16_t hum;            /**< centi-percent RH */
+    uint32_t dlux;          /**< deci-lux at the light sensor */
+    bool sky;               /**< GPS satellites in view */
+    bool moving;            /**< position changes, in transport */
+    uint8_t d7;             /**< percent of D7 uplinks answered */
+    uint8_t lora;           /**< percent of LoRaWAN uplinks delivered */
+} sim_env_t;
+
+/* climate at a minute of the day, linear in between */
+typedef struct {
+    uint16_t minute;
+    int16_t temp;
+    int16_t hum;
+    uint32_t dlux;
+} sim_point_t;
+
+/* where the device is from a minute of the day on */
+typedef struct {
+    uint16_t minute;
+    bool sky;
+    bool moving;
+    uint8_t d7;
+    uint8_t lora;
+} sim_place_t;
+
+typedef struct {
+    const char* name;
+    const sim_point_t* climate;     /**< from minute 0 to 1440 */
+    const sim_place_t* places;      /**< from minute 0 on, up to a minute 1440 */
+    const uint16_t* falls;          /**< minutes of the day, up to 1440 */
+} sim_scenario_t;
+
+extern const sim_scenario_t sim_scenarios[];
+extern const unsigned sim_scenarios_numof;
+
+/* environment of a scenario at ms into the day */
+void sim_env_at(const sim_scenario_t* sc, uint32_t ms, sim_env_t* env);
+
+/* environment now, in the running scenario */
+void sim_env(sim_env_t* env);
+
+/* block the calling thread for ms of virtual time, as a driver waiting for
+ * its device */
+void sim_wait(uint32_t ms);
+
+/* light sensor cycle, raises its interrupt once the light stays above the
+ * threshold, returns the ms to the next cycle or 0 while it is disabled */
+uint32_t sim_light_cycle(void);
+
+/* the accelerometer detects a free fall */
+void sim_fall(void);
+
+/* GPIO interrupts of main.c */
+int sim_gpio_init_int(gpio_t pin, gpio_mode_t mode, gpio_flank_t flank, gpio_cb_t cb,
+                      void* arg);
+void sim_gpio_irq_enable(gpio_t pin);
+
+#endif
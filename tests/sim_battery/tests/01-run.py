@@ -0,0 +1,19 @@
+#!/usr/bin/env python3
+
+import sys
+from testrunner import run
+
+# a simulated day takes a few seconds of printing
+SCENARIO_TIMEOUT = 120
+
+
+def testfunc(child):
+    for _ in range(4):
+        child.expect(r'\w+: mcu \d+\.\d{3}, .* total \d+\.\d{3} mAh/day',
+                     timeout=SCENARIO_TIMEOUT)
+    child.expect(r'score: \d+\.\d{3} mAh/day')
+    child.expect_exact('[SUCCESS]')
+
+
+if __name__ == "__main__":
+    sys.exit(run(testfunc))
@@ -0,0 +1,463 @@
+/*
+ * Uplink queue against a fake modem.
+ *
+ * The modem answers each uplink with the next status of a script and keeps
+ * the payloads it was given. The queue runs on a test clock that only moves
+ * when a test advances it, so backoffs and duty-cycle budgets are checked to
+ * the ms. Readings the queue gives up on are collected from the fake sample
+ * log.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "embUnit.h"
+
+#include "tx_queue.h"
+#include "link_select.h"
+#include "sample_log.h"
+#include "power.h"
+#include "energy.h"
+#include "timebase.h"
+
+#define SENT_MAX        (16)
+#define SCRIPT_MAX      (16)
+
+void tx_queue_reset(void);
+
+static uint32_t _now;
+
+static modem_status_t _script[SCRIPT_MAX];
+static unsigned _script_len;
+static unsigned _sent;
+static struct {
+    uint8_t data[TXQ_PAYLOAD_MAX];
+    uint8_t len;
+    alp_itf_id_t itf;
+    bool modem_blocked;
+} _uplink[SENT_MAX];
+
+static uint8_t _logged[SENT_MAX][TXQ_PAYLOAD_MAX];
+static unsigned _logged_num;
+static uint32_t _log_pending;
+static uint32_t _log_batch;
+static unsigned _log_acks;
+static unsigned _reports;
+static bool _modem_blocked;
+static modem_status_t _probe_status;
+static unsigned _probe_done;
+
+uint32_t time_now_ms(void)
+{
+    return _now;
+}
+
+void time_set_msg(ztimer_t* timer, uint32_t ms, msg_t* msg, kernel_pid_t pid)
+{
+    (void)timer; (void)ms; (void)msg; (void)pid;
+}
+
+/* runs on the TX thread, the main thread waits in _step() meanwhile */
+modem_status_t modem_send_unsolicited_response(uint8_t file_id, uint32_t offset,
+                                               uint32_t length, uint8_t* data,
+                                               alp_itf_id_t itf, void* interface_config)
+{
+    (void)file_id; (void)offset; (void)interface_config;
+    unsigned i = _sent++;
+    if (i < SENT_MAX) {
+        memcpy(_uplink[i].data, data, length);
+        _uplink[i].len = length;
+        _uplink[i].itf = itf;
+        _uplink[i].modem_blocked = _modem_blocked;
+    }
+    return (i < _script_len) ? _script[i] : MODEM_STATUS_COMMAND_COMPLETED_SUCCESS;
+}
+
+void link_select_report(alp_itf_id_t itf, modem_status_t status, uint32_t latency_ms)
+{
+    (void)itf; (void)status; (void)latency_ms;
+    _reports++;
+}
+
+int sample_log_append(const uint8_t* data, uint8_t len, bool lora, bool alarm)
+{
+    (void)lora; (void)alarm;
+    if (_logged_num < SENT_MAX) {
+        memcpy(_logged[_logged_num], data, len);
+    }
+    _logged_num++;
+    return 0;
+}
+
+uint32_t sample_log_pending(void)
+{
+    return _log_pending;
+}
+
+/* as many pending readings as fit, as single byte records */
+uint8_t sample_log_batch(uint8_t* buf, uint8_t max)
+{
+    _log_batch = (_log_pending < max - 1U) ? _log_pending : max - 1U;
+    if (_log_batch == 0) {
+        return 0;
+    }
+    buf[0] = SAMPLE_LOG_BATCH | _log_batch;
+    for (uint32_t i = 0; i < _log_batch; i++) {
+        buf[1 + i] = 0xb0 + i;
+    }
+    return _log_batch + 1;
+}
+
+void sample_log_ack(void)
+{
+    _log_pending -= _log_batch;
+    _log_acks++;
+}
+
+void power_block(power_user_t user)
+{
+    if (user == POWER_MODEM) {
+        _modem_blocked = true;
+    }
+}
+
+void power_unblock(power_user_t user)
+{
+    if (user == POWER_MODEM) {
+        _modem_blocked = false;
+    }
+}
+
+void energy_set(energy_part_t part, uint32_t ua)
+{
+    (void)part; (void)ua;
+}
+
+void energy_add(energy_part_t part, uint64_t ua_ms)
+{
+    (void)part; (void)ua_ms;
+}
+
+static void _probe_cb(modem_status_t status)
+{
+    _probe_status = status;
+    _probe_done++;
+}
+
+//one round of the main loop: start the next uplink and wait for its result
+static int _step(void)
+{
+    if (!tx_queue_process()) {
+        return 0;
+    }
+    msg_t msg;
+    msg_receive(&msg);
+    if (msg.type != MSG_TYPE_TX_DONE) {
+        return -1;
+    }
+    tx_queue_done(&msg);
+    return 1;
+}
+
+static void _push(uint8_t tag, alp_itf_id_t itf, bool alarm)
+{
+    uint8_t data[10] = { tag };
+    TEST_ASSERT_EQUAL_INT(0, tx_queue_push(data, sizeof(data), itf, NULL, alarm));
+}
+
+static void set_up(void)
+{
+    _now = 1000;
+    _script_len = 0;
+    _sent = 0;
+    _logged_num = 0;
+    _log_pending = 0;
+    _log_acks = 0;
+    _reports = 0;
+    _probe_done = 0;
+    tx_queue_reset();
+}
+
+static void test_tx_queue_order(void)
+{
+    _push(1, ALP_ITF_ID_LORAWAN_OTAA, false);
+    _push(2, ALP_ITF_ID_D7ASP, false);
+    _push(3, ALP_ITF_ID_LORAWAN_OTAA, true);
+    TEST_ASSERT_EQUAL_INT(3, tx_queue_pending());
+
+    while (_step() == 1) {}
+    TEST_ASSERT_EQUAL_INT(3, _sent);
+    TEST_ASSERT_EQUAL_INT(3, _uplink[0].data[0]);
+    TEST_ASSERT_EQUAL_INT(1, _uplink[1].data[0]);
+    TEST_ASSERT_EQUAL_INT(2, _uplink[2].data[0]);
+    TEST_ASSERT_EQUAL_INT(ALP_ITF_ID_D7ASP, _uplink[2].itf);
+    TEST_ASSERT_EQUAL_INT(0, tx_queue_pending());
+    TEST_ASSERT_EQUAL_INT(3, _reports);
+}
+
+static void test_tx_queue_coalesce(void)
+{
+    _push(1, ALP_ITF_ID_LORAWAN_OTAA, false);
+    _push(2, ALP_ITF_ID_LORAWAN_OTAA, false);
+    _push(3, ALP_ITF_ID_LORAWAN_OTAA, true);
+    _push(4, ALP_ITF_ID_LORAWAN_OTAA, true);
+    TEST_ASSERT_EQUAL_INT(3, tx_queue_pending());
+    /* the superseded reading is kept in the log */
+    TEST_ASSERT_EQUAL_INT(1, _logged_num);
+    TEST_ASSERT_EQUAL_INT(1, _logged[0][0]);
+
+    while (_step() == 1) {}
+    TEST_ASSERT_EQUAL_INT(3, _sent);
+    TEST_ASSERT_EQUAL_INT(3, _uplink[0].data[0]);
+    TEST_ASSERT_EQUAL_INT(4, _uplink[1].data[0]);
+    TEST_ASSERT_EQUAL_INT(2, _uplink[2].data[0]);
+}
+
+static void test_tx_queue_retry(void)
+{
+    uint32_t backoff = TXQ_BACKOFF_BASE_MS;
+
+    for (int i = 0; i < TXQ_MAX_RETRIES; i++) {
+        _script[i] = MODEM_STATUS_COMMAND_COMPLETED_ERROR;
+    }
+    _script_len = TXQ_MAX_RETRIES;
+    _push(1, ALP_ITF_ID_LORAWAN_OTAA, false);
+
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    for (int i = 1; i < TXQ_MAX_RETRIES; i++) {
+        _now += backoff - 1;
+        TEST_ASSERT_EQUAL_INT(0, _step());
+        _now += 1;
+        TEST_ASSERT_EQUAL_INT(1, _step());
+        backoff = (backoff * 2 > TXQ_BACKOFF_MAX_MS) ? TXQ_BACKOFF_MAX_MS : backoff * 2;
+    }
+    TEST_ASSERT_EQUAL_INT(TXQ_MAX_RETRIES, _sent);
+    TEST_ASSERT_EQUAL_INT(0, tx_queue_pending());
+    TEST_ASSERT_EQUAL_INT(1, _logged_num);
+    TEST_ASSERT_EQUAL_INT(1, _logged[0][0]);
+}
+
+static void test_tx_queue_budget(void)
+{
+    uint32_t airtime = tx_queue_airtime_us(ALP_ITF_ID_LORAWAN_OTAA, 10);
+    /* 1% of an hour of airtime in sub-band G */
+    uint32_t budget = 3600000U * 10;
+    unsigned sent = 0;
+
+    _push(1, ALP_ITF_ID_LORAWAN_OTAA, true);
+    while (_step() == 1) {
+        _sent = 0;
+        sent++;
+        _push(1, ALP_ITF_ID_LORAWAN_OTAA, true);
+    }
+    TEST_ASSERT_EQUAL_INT(budget / airtime, sent);
+    TEST_ASSERT_EQUAL_INT(1, tx_queue_pending());
+
+    /* every ms earns 10 us of airtime */
+    uint32_t left = budget - sent * airtime;
+    _now += (airtime - left + 9) / 10 - 1;
+    TEST_ASSERT_EQUAL_INT(0, _step());
+    _now += 1;
+    TEST_ASSERT_EQUAL_INT(1, _step());
+}
+
+static void test_tx_queue_probe(void)
+{
+    uint8_t probe[1] = { 9 };
+
+    _script[0] = MODEM_STATUS_COMMAND_TIMEOUT;
+    _script_len = 1;
+    _push(1, ALP_ITF_ID_LORAWAN_OTAA, true);
+    TEST_ASSERT_EQUAL_INT(0, tx_queue_probe(probe, sizeof(probe), ALP_ITF_ID_D7ASP,
+                                            NULL, _probe_cb));
+    TEST_ASSERT_EQUAL_INT(-1, tx_queue_probe(probe, sizeof(probe), ALP_ITF_ID_D7ASP,
+                                             NULL, _probe_cb));
+
+    /* the reading goes first */
+    _script[0] = MODEM_STATUS_COMMAND_COMPLETED_SUCCESS;
+    _script[1] = MODEM_STATUS_COMMAND_TIMEOUT;
+    _script_len = 2;
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(1, _uplink[0].data[0]);
+    TEST_ASSERT_EQUAL_INT(0, _probe_done);
+
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(9, _uplink[1].data[0]);
+    TEST_ASSERT_EQUAL_INT(1, _probe_done);
+    TEST_ASSERT_EQUAL_INT(MODEM_STATUS_COMMAND_TIMEOUT, _probe_status);
+    /* a failed probe is neither retried nor logged */
+    TEST_ASSERT_EQUAL_INT(0, tx_queue_pending());
+    TEST_ASSERT_EQUAL_INT(0, _logged_num);
+    TEST_ASSERT_EQUAL_INT(0, _step());
+}
+
+static void test_tx_queue_probe_room(void)
+{
+    uint8_t probe[1] = { 9 };
+
+    for (int i = 0; i < TXQ_SIZE; i++) {
+        _push(10 + i, ALP_ITF_ID_LORAWAN_OTAA, true);
+    }
+    /* a probe never takes the place of a reading */
+    TEST_ASSERT_EQUAL_INT(-1, tx_queue_probe(probe, sizeof(probe), ALP_ITF_ID_D7ASP,
+                                             NULL, _probe_cb));
+    TEST_ASSERT_EQUAL_INT(0, _logged_num);
+
+    /* and is the first to make room for an alarm */
+    set_up();
+    _push(1, ALP_ITF_ID_LORAWAN_OTAA, false);
+    TEST_ASSERT_EQUAL_INT(0, tx_queue_probe(probe, sizeof(probe), ALP_ITF_ID_D7ASP,
+                                            NULL, _probe_cb));
+    for (int i = 2; i < TXQ_SIZE; i++) {
+        _push(10 + i, ALP_ITF_ID_LORAWAN_OTAA, true);
+    }
+    _push(20, ALP_ITF_ID_LORAWAN_OTAA, true);
+    TEST_ASSERT_EQUAL_INT(0, _logged_num);
+    TEST_ASSERT_EQUAL_INT(TXQ_SIZE, tx_queue_pending());
+    while (_step() == 1) {}
+    TEST_ASSERT_EQUAL_INT(TXQ_SIZE, _sent);
+    TEST_ASSERT_EQUAL_INT(1, _uplink[TXQ_SIZE - 1].data[0]);
+    TEST_ASSERT_EQUAL_INT(0, _probe_done);
+}
+
+static void test_tx_queue_link(void)
+{
+    int d7_cfg, lora_cfg;
+
+    tx_queue_set_link(ALP_ITF_ID_LORAWAN_ABP, &lora_cfg);
+    _script[0] = MODEM_STATUS_COMMAND_COMPLETED_ERROR;
+    _script[1] = MODEM_STATUS_COMMAND_COMPLETED_ERROR;
+    _script_len = 2;
+    _push(1, ALP_ITF_ID_LORAWAN_ABP, false);
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(0, _step());
+
+    /* the queued retry moves to the new link and is due right away */
+    tx_queue_set_link(ALP_ITF_ID_D7ASP, &d7_cfg);
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(ALP_ITF_ID_D7ASP, _uplink[1].itf);
+
+    /* and follows the link back after failing there */
+    tx_queue_set_link(ALP_ITF_ID_LORAWAN_ABP, &lora_cfg);
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(ALP_ITF_ID_LORAWAN_ABP, _uplink[2].itf);
+    TEST_ASSERT_EQUAL_INT(0, tx_queue_pending());
+}
+
+static void test_tx_queue_replay(void)
+{
+    _log_pending = 3;
+    _script[0] = MODEM_STATUS_COMMAND_COMPLETED_SUCCESS;
+    _script[1] = MODEM_STATUS_COMMAND_COMPLETED_ERROR;
+    _script_len = 2;
+    _push(1, ALP_ITF_ID_D7ASP, false);
+
+    /* the batch follows a successful uplink on the same interface */
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(1, tx_queue_pending());
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(ALP_ITF_ID_D7ASP, _uplink[1].itf);
+    TEST_ASSERT_EQUAL_INT(4, _uplink[1].len);
+    TEST_ASSERT_EQUAL_INT(SAMPLE_LOG_BATCH | 3, _uplink[1].data[0]);
+
+    /* a failed batch stays in the log and is not retried */
+    TEST_ASSERT_EQUAL_INT(0, _log_acks);
+    TEST_ASSERT_EQUAL_INT(0, tx_queue_pending());
+    TEST_ASSERT_EQUAL_INT(0, _logged_num);
+
+    _push(2, ALP_ITF_ID_D7ASP, false);
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(1, _log_acks);
+    TEST_ASSERT_EQUAL_INT(0, _step());
+}
+
+static void test_tx_queue_replay_size(void)
+{
+    _log_pending = 200;
+    _push(1, ALP_ITF_ID_LORAWAN_ABP, false);
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    /* at SF10 an EU868 uplink carries 51 bytes */
+    TEST_ASSERT_EQUAL_INT(51, tx_queue_payload_max(ALP_ITF_ID_LORAWAN_ABP));
+    TEST_ASSERT_EQUAL_INT(51, _uplink[1].len);
+    TEST_ASSERT_EQUAL_INT(SAMPLE_LOG_BATCH | 50, _uplink[1].data[0]);
+
+    /* DASH7 takes full batches */
+    tx_queue_reset();
+    _sent = 0;
+    _push(2, ALP_ITF_ID_D7ASP, false);
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    TEST_ASSERT_EQUAL_INT(ALP_ITF_ID_D7ASP, _uplink[1].itf);
+    TEST_ASSERT_EQUAL_INT(TXQ_PAYLOAD_MAX, _uplink[1].len);
+    TEST_ASSERT_EQUAL_INT(200 - 50 - (TXQ_PAYLOAD_MAX - 1), _log_pending);
+    tx_queue_reset();
+
+    /* a live reading longer than a LoRaWAN uplink is refused */
+    uint8_t big[TXQ_PAYLOAD_MAX] = { 0 };
+    TEST_ASSERT_EQUAL_INT(-1, tx_queue_push(big, 52, ALP_ITF_ID_LORAWAN_ABP, NULL, false));
+    TEST_ASSERT_EQUAL_INT(0, tx_queue_push(big, 52, ALP_ITF_ID_D7ASP, NULL, false));
+}
+
+static void test_tx_queue_full(void)
+{
+    _push(1, ALP_ITF_ID_LORAWAN_OTAA, false);
+    for (int i = 1; i < TXQ_SIZE; i++) {
+        _push(10 + i, ALP_ITF_ID_LORAWAN_OTAA, true);
+    }
+    /* an alarm evicts the routine reading to the log */
+    _push(20, ALP_ITF_ID_LORAWAN_OTAA, true);
+    TEST_ASSERT_EQUAL_INT(1, _logged_num);
+    TEST_ASSERT_EQUAL_INT(1, _logged[0][0]);
+
+    /* with only alarms queued, the next one goes to the log */
+    uint8_t data[10] = { 21 };
+    TEST_ASSERT_EQUAL_INT(-1, tx_queue_push(data, sizeof(data),
+                                            ALP_ITF_ID_LORAWAN_OTAA, NULL, true));
+    TEST_ASSERT_EQUAL_INT(2, _logged_num);
+    TEST_ASSERT_EQUAL_INT(21, _logged[1][0]);
+    TEST_ASSERT_EQUAL_INT(TXQ_SIZE, tx_queue_pending());
+}
+
+static void test_tx_queue_power(void)
+{
+    _push(1, ALP_ITF_ID_LORAWAN_OTAA, false);
+    TEST_ASSERT(!tx_queue_busy());
+    TEST_ASSERT_EQUAL_INT(1, _step());
+    /* STOP2 was blocked while the modem command ran */
+    TEST_ASSERT(_uplink[0].modem_blocked);
+    TEST_ASSERT(!_modem_blocked);
+    TEST_ASSERT(!tx_queue_busy());
+}
+
+Test *tests_tx_queue(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_tx_queue_order),
+        new_TestFixture(test_tx_queue_coalesce),
+        new_TestFixture(test_tx_queue_retry),
+        new_TestFixture(test_tx_queue_budget),
+        new_TestFixture(test_tx_queue_probe),
+        new_TestFixture(test_tx_queue_probe_room),
+        new_TestFixture(test_tx_queue_link),
+        new_TestFixture(test_tx_queue_replay),
+        new_TestFixture(test_tx_queue_replay_size),
+        new_TestFixture(test_tx_queue_full),
+        new_TestFixture(test_tx_queue_power),
+    };
+
+    EMB_UNIT_TESTCALLER(tx_queue_tests, set_up, NULL, fixtures);
+
+    return (Test *)&tx_queue_tests;
+}
+
+int main(void)
+{
+    tx_queue_init();
+
+    TESTS_START();
+    TESTS_RUN(tests_tx_queue());
+    TESTS_END();
+
+    return 0;
+}
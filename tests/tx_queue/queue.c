@@ -0,0 +1,14 @@
+/* the queue under test */
+#include "tx_queue.c"
+
+/* start a test from an empty queue with full budgets, on the same TX thread */
+void tx_queue_reset(void)
+{
+    memset(_queue, 0, sizeof(_queue));
+    _inflight = NULL;
+    _link_set = false;
+    _budget_time = time_now_ms();
+    for (int i = 0; i < EU868_SUBBAND_NUMOF; i++) {
+        _budget_us[i] = BUDGET_WINDOW_MS * _duty[i];
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+
+#include "msg.h"
+#include "ztimer.h"
+
+#include "config.h"
+
+/*
+ * Clock of the application.
+ *
+ * The measurement period, the GPS polls, uplink backoffs, caches and budgets
+ * are timed in ms with the functions below. They use ZTIMER_MSEC, which runs
+ * from the RTT on the board and keeps running in STOP2. The drivers wait on
+ * ZTIMER_MSEC as well and use ZTIMER_USEC only around I2C transfers, for
+ * delays of a few ms at most. A timer set on ZTIMER_USEC blocks STOP2 until
+ * it fires.
+ *
+ * With VIRTUAL_TIME on the native board, these functions are only declared
+ * here. The test or simulation linked with the application implements them
+ * and decides how time advances (see tests/).
+ */
+#if VIRTUAL_TIME
+#ifndef BOARD_NATIVE
+#error "VIRTUAL_TIME is only supported on the native board"
+#endif
+uint32_t time_now_ms(void);
+void time_set_msg(ztimer_t* timer, uint32_t ms, msg_t* msg, kernel_pid_t pid);
+#else
+static inline uint32_t time_now_ms(void)
+{
+    return ztimer_now(ZTIMER_MSEC);
+}
+
+static inline void time_set_msg(ztimer_t* timer, uint32_t ms, msg_t* msg, kernel_pid_t pid)
+{
+    ztimer_set_msg(ZTIMER_MSEC, timer, ms, msg, pid);
+}
+#endif
+
+#endif